@@ -20,7 +20,7 @@ struct {
 	__u64 cpus[1];
 	__u64 rcpus[1];
 	__u64 fpga_regions[1];
-	struct jailhouse_memory mem_regions[4];
+	struct jailhouse_memory mem_regions[5];
 	union jailhouse_stream_id stream_ids[1];
 	struct jailhouse_rcpu_device rcpu_devices[1];
 	struct jailhouse_fpga_device fpga_devices[1];
@@ -80,10 +80,18 @@ struct {
 		/* SHM */ {
 			.phys_start = 0x46d00000,
 			.virt_start = 0x46d00000,
-			.size = 0x10000,
+			.size = 0xd000,
 			.flags = JAILHOUSE_MEM_READ | JAILHOUSE_MEM_WRITE |
 				JAILHOUSE_MEM_ROOTSHARED, 
 		},
+		/* telemetry */ {
+			.phys_start = 0x46d0f000,
+			.virt_start = 0x46d0f000,
+			.size = 0x1000,
+			.flags = JAILHOUSE_MEM_READ | JAILHOUSE_MEM_WRITE |
+				JAILHOUSE_MEM_ROOTSHARED |
+				JAILHOUSE_MEM_RCPU_TELEMETRY,
+		},
 		/* communication region */ {
 			.virt_start = 0x80000000,
 			.size = 0x00001000,
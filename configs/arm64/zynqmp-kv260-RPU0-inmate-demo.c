@@ -20,7 +20,7 @@ struct {
 	struct jailhouse_cell_desc cell;
 	__u64 cpus[1];
 	__u64 rcpus[1];
-	struct jailhouse_memory mem_regions[7];
+	struct jailhouse_memory mem_regions[8];
 } __attribute__((packed)) config = {
 	.cell = {
 		.signature = JAILHOUSE_CELL_DESC_SIGNATURE,
@@ -91,10 +91,18 @@ struct {
 		/* SHM */ {
 			.phys_start = 0x46d00000,
 			.virt_start = 0x46d00000,
-			.size = 0x10000,
+			.size = 0xd000,
 			.flags = JAILHOUSE_MEM_READ | JAILHOUSE_MEM_WRITE |
 				JAILHOUSE_MEM_ROOTSHARED, 
 		},
+		/* telemetry */ {
+			.phys_start = 0x46d0d000,
+			.virt_start = 0x46d0d000,
+			.size = 0x1000,
+			.flags = JAILHOUSE_MEM_READ | JAILHOUSE_MEM_WRITE |
+				JAILHOUSE_MEM_ROOTSHARED |
+				JAILHOUSE_MEM_RCPU_TELEMETRY,
+		},
 		/* communication region */ {
 			.virt_start = 0x80000000,
 			.size = 0x00001000,
@@ -19,8 +19,11 @@
 
 #include <linux/bitops.h>
 #include <linux/cpu.h>
+#include <linux/delay.h>
+#include <linux/io.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/timex.h>
 #include <linux/vmalloc.h>
 #include <asm/cacheflush.h>
 
@@ -49,10 +52,93 @@ void jailhouse_cell_kobj_release(struct kobject *kobj)
 	struct cell *cell = container_of(kobj, struct cell, kobj);
 
 	jailhouse_pci_cell_cleanup(cell);
+	if (cell->rcpu_telemetry)
+		memunmap(cell->rcpu_telemetry);
 	vfree(cell->memory_regions);
 	kfree(cell);
 }
 
+/* Map the telemetry page of an rCPU cell, if its configuration has one */
+static void map_rcpu_telemetry(struct cell *cell)
+{
+	const struct jailhouse_memory *mem;
+	unsigned int n;
+
+	for (n = 0; n < cell->num_memory_regions; n++) {
+		mem = &cell->memory_regions[n];
+		if (!(mem->flags & JAILHOUSE_MEM_RCPU_TELEMETRY))
+			continue;
+
+		if (mem->size < sizeof(struct rcpu_telemetry)) {
+			pr_warn("jailhouse: rCPU telemetry region too small\n");
+			return;
+		}
+		/* The rCPUs write it uncached */
+		cell->rcpu_telemetry = memremap(mem->phys_start,
+						sizeof(struct rcpu_telemetry),
+						MEMREMAP_WC);
+		if (!cell->rcpu_telemetry)
+			pr_warn("jailhouse: Unable to map rCPU telemetry at "
+				"%08llx\n", mem->phys_start);
+		return;
+	}
+}
+
+/**
+ * rcpu_shutdown_ok - Asks the rCPU firmware of a cell to shut down.
+ * @cell: Cell whose rCPUs are about to be stopped.
+ *
+ * The rCPUs cannot reach the comm region of their cell, so the shutdown
+ * request is sent through the telemetry page instead, if the firmware
+ * announced that it answers messages there. A firmware that does not reply
+ * before it would be reported as stalled is stopped anyway, like the
+ * hypervisor does on a reply timeout.
+ *
+ * An approving firmware keeps running until the driver stops its rCPUs, so
+ * that it is still alive if the hypervisor refuses the request afterwards.
+ *
+ * Return: 0 if the rCPUs may be stopped, -EPERM if the firmware denied it.
+ */
+static int rcpu_shutdown_ok(struct cell *cell)
+{
+	struct rcpu_telemetry *page = cell->rcpu_telemetry;
+	u32 reply, state;
+	cycles_t deadline;
+
+	BUILD_BUG_ON(RCPU_TELEMETRY_MSG_SHUTDOWN_REQUEST !=
+		     JAILHOUSE_MSG_SHUTDOWN_REQUEST);
+	BUILD_BUG_ON(RCPU_TELEMETRY_MSG_REQUEST_APPROVED !=
+		     JAILHOUSE_MSG_REQUEST_APPROVED);
+	BUILD_BUG_ON(RCPU_TELEMETRY_SHUT_DOWN != JAILHOUSE_CELL_SHUT_DOWN);
+
+	if (!page || READ_ONCE(page->magic) != RCPU_TELEMETRY_MAGIC ||
+	    READ_ONCE(page->version) != RCPU_TELEMETRY_VERSION ||
+	    !(READ_ONCE(page->flags) & RCPU_TELEMETRY_FLAG_MSG) ||
+	    READ_ONCE(page->rcpu_state) != JAILHOUSE_CELL_RUNNING)
+		return 0;
+
+	WRITE_ONCE(page->reply_from_rcpu, JAILHOUSE_MSG_NONE);
+	wmb();
+	WRITE_ONCE(page->msg_to_rcpu, JAILHOUSE_MSG_SHUTDOWN_REQUEST);
+
+	deadline = get_cycles() + RCPU_TELEMETRY_STALL_PERIODS *
+		READ_ONCE(page->heartbeat_period);
+	do {
+		state = READ_ONCE(page->rcpu_state);
+		reply = READ_ONCE(page->reply_from_rcpu);
+		if (state == JAILHOUSE_CELL_SHUT_DOWN ||
+		    reply == JAILHOUSE_MSG_REQUEST_APPROVED)
+			return 0;
+		if (reply != JAILHOUSE_MSG_NONE)
+			return -EPERM;
+		usleep_range(500, 1000);
+	} while (get_cycles() < deadline);
+
+	pr_warn("jailhouse: no shutdown reply from the rCPUs of cell \"%s\"\n",
+		cell->name);
+	return 0;
+}
+
 static struct cell *cell_create(const struct jailhouse_cell_desc *cell_desc)
 {
 	struct cell *cell;
@@ -128,10 +214,15 @@ retry:
 	memcpy(cell->memory_regions, jailhouse_cell_mem_regions(cell_desc),
 	       sizeof(struct jailhouse_memory) * cell->num_memory_regions);
 
+	cell->rcpu_telemetry = NULL;
+	map_rcpu_telemetry(cell);
+
 	err = jailhouse_pci_cell_setup(cell, cell_desc);
 	if (err) {
 		jailhouse_rcpus_remove(cell);
 		jailhouse_fpga_regions_remove(cell);
+		if (cell->rcpu_telemetry)
+			memunmap(cell->rcpu_telemetry);
 		vfree(cell->memory_regions);
 		kfree(cell);
 		return ERR_PTR(err);
@@ -192,12 +283,14 @@ void jailhouse_cell_register_root(void)
 void jailhouse_cell_delete_root(void)
 {
 	jailhouse_root_rcpus_remove();
+	jailhouse_fpga_cache_flush();
 	cell_delete(root_cell);
 	root_cell = NULL;
 }
 
 int jailhouse_cmd_cell_create(struct jailhouse_cell_create __user *arg)
 {
+	cycles_t entry_stamp = get_cycles();
 	struct jailhouse_cell_create cell_params;
 	struct jailhouse_cell_desc *config;
 	struct jailhouse_cell_id cell_id;
@@ -266,6 +359,7 @@ int jailhouse_cmd_cell_create(struct jailhouse_cell_create __user *arg)
 	}
 
 	config->id = cell->id;
+	cell->boot_stamps[RCPU_STAMP_CREATE_IOCTL] = entry_stamp;
 
 	if (!cpumask_subset(&cell->cpus_assigned, &root_cell->cpus_assigned)) {
 		err = -EBUSY;
@@ -326,6 +420,7 @@ int jailhouse_cmd_cell_create(struct jailhouse_cell_create __user *arg)
 		goto error_cpu_online;
 
 	cell_register(cell);
+	jailhouse_param_page_refresh();
 
 	pr_info("Created Jailhouse cell \"%s\"\n", config->name);
 
@@ -461,8 +556,9 @@ static int load_image(struct cell *cell,
 
 int jailhouse_cmd_cell_load(struct jailhouse_cell_load __user *arg)
 {
+	cycles_t entry_stamp = get_cycles();
 	struct jailhouse_preload_image __user *image = arg->image;
-	struct jailhouse_preload_rcpu_image __user * rcpu_image = arg->rcpu_image;
+	struct jailhouse_preload_rcpu_image *rcpu_images;
 	struct jailhouse_cell_load cell_load;
 	struct cell *cell;
 	unsigned int n;
@@ -475,17 +571,33 @@ int jailhouse_cmd_cell_load(struct jailhouse_cell_load __user *arg)
 	if (err)
 		return err;
 
+	cell->boot_stamps[RCPU_STAMP_LOAD_IOCTL] = entry_stamp;
+
+	err = rcpu_shutdown_ok(cell);
+	if (err)
+		goto unlock_out;
+
 	err = jailhouse_call_arg1(JAILHOUSE_HC_CELL_SET_LOADABLE, cell->id);
 	if (err)
 		goto unlock_out;
 
-	// DEBUG PRINT
-	pr_info("Preparing to load %d images for Remote Processors...\n",cell_load.num_rcpu_images);
-	for (n = cell_load.num_rcpu_images; n > 0; n--, rcpu_image++) {
-		pr_info("Loading image: %s on rCPU: %d \n", rcpu_image->name, rcpu_image->rcpu_id);
-		err = jailhouse_load_rcpu_image(cell, rcpu_image);
-		if (err){
-			pr_err("Unable to load rcpu image %s\n",rcpu_image->name);
+	if (cell_load.num_rcpu_images > 0) {
+		pr_info("Preparing to load %d images for Remote Processors...\n",
+			cell_load.num_rcpu_images);
+		rcpu_images = memdup_user((void __user *)cell_load.rcpu_image,
+					  array_size(cell_load.num_rcpu_images,
+						     sizeof(*rcpu_images)));
+		if (IS_ERR(rcpu_images)) {
+			err = PTR_ERR(rcpu_images);
+			goto unlock_out;
+		}
+
+		/* All rCPU images are loaded concurrently */
+		err = jailhouse_load_rcpu_images(cell, rcpu_images,
+						 cell_load.num_rcpu_images);
+		kfree(rcpu_images);
+		if (err) {
+			pr_err("Unable to load rcpu images\n");
 			goto unlock_out;
 		}
 	}
@@ -506,6 +618,7 @@ unlock_out:
 
 int jailhouse_cmd_cell_start(const char __user *arg)
 {
+	cycles_t entry_stamp = get_cycles();
 	struct jailhouse_cell_id cell_id;
 	struct cell *cell;
 	int err;
@@ -517,7 +630,10 @@ int jailhouse_cmd_cell_start(const char __user *arg)
 	if (err)
 		return err;
 
+	cell->boot_stamps[RCPU_STAMP_START_IOCTL] = entry_stamp;
+
 	err = jailhouse_call_arg1(JAILHOUSE_HC_CELL_START, cell->id);
+	jailhouse_param_page_refresh();
 	
 	err = jailhouse_start_rcpu(cell);
 	if (err)
@@ -528,6 +644,75 @@ int jailhouse_cmd_cell_start(const char __user *arg)
 	return err;
 }
 
+int jailhouse_cmd_cell_restart(struct jailhouse_cell_restart __user *arg)
+{
+	struct jailhouse_cell_restart cell_restart;
+	struct cell *cell;
+	int err;
+
+	if (copy_from_user(&cell_restart, arg, sizeof(cell_restart)))
+		return -EFAULT;
+
+	err = cell_management_prologue(&cell_restart.cell_id, &cell);
+	if (err)
+		return err;
+
+	/* Warm restart is only supported for the rCPUs of a cell */
+	if (cpumask_empty(&cell->rcpus_assigned)) {
+		err = -EINVAL;
+		goto unlock_out;
+	}
+
+	err = rcpu_shutdown_ok(cell);
+	if (err)
+		goto unlock_out;
+
+	err = jailhouse_restart_rcpus(cell, cell_restart.flags);
+	if (err)
+		pr_err("Failed to restart rcpus\n");
+
+unlock_out:
+	mutex_unlock(&jailhouse_lock);
+
+	return err;
+}
+
+int jailhouse_cmd_cell_stage(struct jailhouse_cell_stage __user *arg)
+{
+	struct jailhouse_preload_rcpu_image *rcpu_images;
+	struct jailhouse_cell_stage cell_stage;
+	struct cell *cell;
+	int err;
+
+	if (copy_from_user(&cell_stage, arg, sizeof(cell_stage)))
+		return -EFAULT;
+
+	if (cell_stage.num_rcpu_images == 0)
+		return -EINVAL;
+
+	rcpu_images = memdup_user((void __user *)cell_stage.rcpu_image,
+				  array_size(cell_stage.num_rcpu_images,
+					     sizeof(*rcpu_images)));
+	if (IS_ERR(rcpu_images))
+		return PTR_ERR(rcpu_images);
+
+	err = cell_management_prologue(&cell_stage.cell_id, &cell);
+	if (err)
+		goto free_images;
+
+	/* The rCPUs of the cell keep running while their next images are staged */
+	err = jailhouse_stage_rcpu_images(cell, rcpu_images,
+					  cell_stage.num_rcpu_images);
+	if (err)
+		pr_err("Unable to stage rcpu images\n");
+
+	mutex_unlock(&jailhouse_lock);
+free_images:
+	kfree(rcpu_images);
+
+	return err;
+}
+
 static int cell_destroy(struct cell *cell)
 {
 	unsigned int cpu;
@@ -578,7 +763,9 @@ int jailhouse_cmd_cell_destroy(const char __user *arg)
 	if (err)
 		return err;
 
-	err = cell_destroy(cell);
+	err = rcpu_shutdown_ok(cell);
+	if (!err)
+		err = cell_destroy(cell);
 
 	mutex_unlock(&jailhouse_lock);
 
@@ -26,6 +26,27 @@
 
 #include <jailhouse/config.h>
 #include <jailhouse/cell-config.h>
+#include <jailhouse/rcpu-telemetry-common.h>
+
+/* Driver-side boot time stamps of the rCPUs of a cell, in system counter ticks */
+enum rcpu_boot_stamp {
+	RCPU_STAMP_CREATE_IOCTL,
+	RCPU_STAMP_LOAD_IOCTL,
+	RCPU_STAMP_FW_LOAD_BEGIN,
+	RCPU_STAMP_FW_LOAD_END,
+	RCPU_STAMP_START_IOCTL,
+	NUM_RCPU_STAMPS,
+};
+
+/* Phases of the FPGA regions setup of a cell, see jailhouse_fpga_regions_setup */
+enum fpga_setup_phase {
+	FPGA_PHASE_DECOUPLE,
+	FPGA_PHASE_BITSTREAM,
+	FPGA_PHASE_COUPLE,
+	FPGA_PHASE_OVERLAY,
+	FPGA_PHASE_TOTAL,
+	NUM_FPGA_PHASES,
+};
 
 struct cell {
 	struct kobject kobj;
@@ -39,7 +60,13 @@ struct cell {
 	cpumask_t fpga_regions_assigned;
 	u32 num_memory_regions;
 	struct rcpu_info **soft_rcpus_info;
+	u64 rcpu_start_skew_ns;
+	u64 boot_stamps[NUM_RCPU_STAMPS];
 	u32 *fpga_overlay_ids;
+	u32 num_fpga_overlays;
+	u64 fpga_setup_ns[NUM_FPGA_PHASES];
+	/* Telemetry page written by the rCPU firmware, NULL if none */
+	struct rcpu_telemetry *rcpu_telemetry;
 	struct jailhouse_memory *memory_regions;
 	u64 color_root_map_offset;
 #ifdef CONFIG_PCI
@@ -59,6 +86,8 @@ void jailhouse_cell_delete_root(void);
 int jailhouse_cmd_cell_create(struct jailhouse_cell_create __user *arg);
 int jailhouse_cmd_cell_load(struct jailhouse_cell_load __user *arg);
 int jailhouse_cmd_cell_start(const char __user *arg);
+int jailhouse_cmd_cell_restart(struct jailhouse_cell_restart __user *arg);
+int jailhouse_cmd_cell_stage(struct jailhouse_cell_stage __user *arg);
 int jailhouse_cmd_cell_destroy(const char __user *arg);
 int jailhouse_cmd_cell_memguard(struct jailhouse_memguard __user *arg);
 
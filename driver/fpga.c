@@ -15,17 +15,187 @@
 */
 
 #include "fpga.h"
+#include "main.h"
 
 #ifdef CONFIG_OMNV_FPGA
+#include <linux/firmware.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/fpga/fpga-region.h>
 #include <linux/of.h>
 #include <linux/of_fdt.h>
 #include <linux/vmalloc.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/workqueue.h>
+
+/* Bound of the DFX decoupler handshakes, polled every FPGA_DFX_POLL_US */
+#define FPGA_DFX_TIMEOUT_US	100000
+#define FPGA_DFX_POLL_US	10
+
+#define DFX_COUPLE		0
+#define DFX_DECOUPLE		1
 
 static long fpga_flags; 
 
+/*
+ * Bitstreams and device tree overlays preloaded with JAILHOUSE_FPGA_CACHE.
+ * The PCAP is fed from the cached copy and overlays are applied from it, so
+ * creating a cell with registered images does no file I/O beyond a path
+ * lookup. Only accessed under jailhouse_lock, like the cell setup using it.
+ */
+struct fpga_image_entry {
+	struct list_head entry;
+	char name[FPGA_BITSTREAM_NAMELEN + 1];
+	struct timespec64 mtime;
+	const struct firmware *fw;
+};
+
+static LIST_HEAD(fpga_image_cache);
+
+static struct fpga_image_entry *fpga_image_cache_lookup(const char *name)
+{
+	struct fpga_image_entry *image;
+
+	list_for_each_entry(image, &fpga_image_cache, entry)
+		if (strncmp(image->name, name, FPGA_BITSTREAM_NAMELEN) == 0)
+			return image;
+	return NULL;
+}
+
+static void fpga_image_cache_release(struct fpga_image_entry *image)
+{
+	list_del(&image->entry);
+	release_firmware(image->fw);
+	kfree(image);
+}
+
+/**
+ * fpga_image_cache_load - Pin an up-to-date copy of a bitstream or overlay
+ * @name: Name of the file in the firmware directory
+ *
+ * The file is read again only if it is not cached yet or if its
+ * modification time changed since it was cached.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+static int fpga_image_cache_load(const char *name)
+{
+	struct fpga_image_entry *image;
+	struct timespec64 mtime;
+	int err;
+
+	err = jailhouse_get_firmware_mtime(name, &mtime);
+	if (err < 0)
+		return err;
+
+	image = fpga_image_cache_lookup(name);
+	if (image) {
+		if (timespec64_equal(&image->mtime, &mtime))
+			return 0;
+		pr_info("FPGA image %s changed, reloading\n", image->name);
+		fpga_image_cache_release(image);
+	}
+
+	image = kzalloc(sizeof(*image), GFP_KERNEL);
+	if (!image)
+		return -ENOMEM;
+	strncpy(image->name, name, FPGA_BITSTREAM_NAMELEN);
+	image->mtime = mtime;
+
+	err = request_firmware(&image->fw, image->name, jailhouse_dev);
+	if (err < 0) {
+		pr_err("Failed to load FPGA image %s: %d\n", image->name, err);
+		kfree(image);
+		return err;
+	}
+
+	pr_info("Cached FPGA image %s: %zu bytes\n", image->name,
+		image->fw->size);
+	list_add(&image->entry, &fpga_image_cache);
+	return 0;
+}
+
+/**
+ * fpga_image_cache_get - Get the cached copy of a bitstream or overlay
+ * @name: Name of the file in the firmware directory
+ *
+ * Images that were not preloaded are not cached on the fly, the caller falls
+ * back to reading the file. A preloaded image that changed on disk is
+ * reloaded.
+ *
+ * Return: The cached firmware, or NULL if the image is not (or no longer)
+ * cached.
+ */
+static const struct firmware *fpga_image_cache_get(const char *name)
+{
+	struct fpga_image_entry *image;
+
+	if (!fpga_image_cache_lookup(name) || fpga_image_cache_load(name) < 0)
+		return NULL;
+
+	image = fpga_image_cache_lookup(name);
+	return image ? image->fw : NULL;
+}
+
+/**
+ * jailhouse_fpga_cache_flush - Drop all cached bitstreams and overlays
+ */
+void jailhouse_fpga_cache_flush(void)
+{
+	struct fpga_image_entry *image, *tmp;
+
+	list_for_each_entry_safe(image, tmp, &fpga_image_cache, entry)
+		fpga_image_cache_release(image);
+}
+
+/**
+ * jailhouse_cmd_fpga_cache - Preload or evict FPGA bitstreams and overlays
+ * @arg: User-space request
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+int jailhouse_cmd_fpga_cache(struct jailhouse_fpga_cache __user *arg)
+{
+	struct jailhouse_fpga_cache req;
+	struct fpga_image_entry *image;
+	int err = 0;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+	req.name[sizeof(req.name) - 1] = '\0';
+
+	if (mutex_lock_interruptible(&jailhouse_lock) != 0)
+		return -EINTR;
+
+	if (!jailhouse_enabled) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	switch (req.cmd) {
+	case JAILHOUSE_FPGA_CACHE_PRELOAD:
+		err = fpga_image_cache_load(req.name);
+		break;
+	case JAILHOUSE_FPGA_CACHE_EVICT:
+		if (req.name[0] == '\0') {
+			jailhouse_fpga_cache_flush();
+			break;
+		}
+		image = fpga_image_cache_lookup(req.name);
+		if (image)
+			fpga_image_cache_release(image);
+		else
+			err = -ENOENT;
+		break;
+	default:
+		err = -EINVAL;
+	}
+
+unlock:
+	mutex_unlock(&jailhouse_lock);
+	return err;
+}
+
 /**
  * setup_fpga_flags - Set up FPGA flags for loading bitstreams.
  * @flags: Flags for loading bitstreams (e.g., partial reconfiguration).
@@ -69,7 +239,8 @@ static void setup_fpga_flags(long flags)
  * This function loads a bitstream into the specified FPGA region by
  * finding the region device in sysfs, allocating memory for the
  * bitstream info structure, and programming the region with the
- * bitstream.
+ * bitstream. A preloaded bitstream is programmed from its cached copy,
+ * otherwise the FPGA manager reads it from the firmware directory.
  * 
  * Return: 0 on success, or a negative error code on failure.
  */
@@ -77,6 +248,7 @@ static int load_bitstream(unsigned int region_id, const char *bitstream_name, lo
 {
 	struct fpga_image_info *info = NULL;
 	struct fpga_region *fpga_region = NULL;
+	const struct firmware *cached;
 	char name[10];
 	unsigned int len;
 	int err = 0;
@@ -105,6 +277,13 @@ static int load_bitstream(unsigned int region_id, const char *bitstream_name, lo
 	info->flags = fpga_flags;
 	fpga_region->mgr->flags = fpga_flags;
 
+	cached = fpga_image_cache_get(bitstream_name);
+	if (cached) {
+		info->buf = (const char *)cached->data;
+		info->count = cached->size;
+		goto program;
+	}
+
 	/* Allocate space for the bitstream name and copy it */
 	info->firmware_name = devm_kstrdup(&fpga_region->dev, bitstream_name, GFP_KERNEL);
 	if (!info->firmware_name) {
@@ -118,6 +297,7 @@ static int load_bitstream(unsigned int region_id, const char *bitstream_name, lo
 	if (info->firmware_name[len - 1] == '\n') 
 		info->firmware_name[len - 1] = 0;
 
+program:
 	/* Add info to region and do the programming */
 	fpga_region->info = info;
 	err = fpga_region_program_fpga(fpga_region);
@@ -148,6 +328,7 @@ out:
  * apply_overlay - Apply a device tree overlay to the system.
  * @overlay_id: Pointer to store the overlay ID.
  * @dto_name: Name of the device tree overlay file.
+ * @cached: Preloaded copy of the overlay, or NULL to read the file.
  *
  * This function applies a device tree overlay to the system by reading
  * the specified file and applying it using the of_overlay_fdt_apply()
@@ -155,7 +336,8 @@ out:
  *
  * Return: 0 on success, or a negative error code on failure.
  */
-static int apply_overlay(unsigned int *overlay_id, const char *dto_name)
+static int apply_overlay(unsigned int *overlay_id, const char *dto_name,
+			 const struct firmware *cached)
 {
 	struct file *file;
 	char path[256];
@@ -167,6 +349,15 @@ static int apply_overlay(unsigned int *overlay_id, const char *dto_name)
 	/* Initialize the overlay id */
 	*overlay_id = -1;
 
+	if (cached) {
+		err = of_overlay_fdt_apply(cached->data, cached->size, overlay_id);
+		if (err) {
+			pr_err("Failed to apply device tree overlay\n");
+			err = -EINVAL;
+		}
+		return err;
+	}
+
 	/* Concatenate the dto_name to the path /lib/firmware/ */
 	snprintf(path, sizeof(path), "/lib/firmware/%s", dto_name);
 
@@ -246,6 +437,113 @@ int jailhouse_root_bitstream(char *bitstream_name, long flags)
 	return err;
 }
 
+/* Per-region state of a cell FPGA setup */
+struct fpga_region_work {
+	struct work_struct work;
+	const struct jailhouse_fpga_device *device;
+	unsigned int region_id;
+	void __iomem *decoupler;
+	u32 *overlay_id;
+	const struct firmware *overlay;
+	bool overlay_queued;
+	u64 overlay_ns;
+	int err;
+};
+
+static void dfx_request(struct fpga_region_work *region, u8 state)
+{
+	iowrite8(state, region->decoupler);
+}
+
+/**
+ * dfx_wait - Wait for the DFX decoupler of a region to acknowledge a request.
+ * @region: Region being (de)coupled.
+ * @state: Requested state, DFX_DECOUPLE or DFX_COUPLE.
+ *
+ * Return: 0 on success, -ETIMEDOUT if the decoupler did not acknowledge the
+ * request within FPGA_DFX_TIMEOUT_US.
+ */
+static int dfx_wait(struct fpga_region_work *region, u8 state)
+{
+	u8 val;
+	int err;
+
+	err = readb_poll_timeout(region->decoupler, val, val == state,
+				 FPGA_DFX_POLL_US, FPGA_DFX_TIMEOUT_US);
+	if (err)
+		pr_err("FPGA region %d: DFX %s handshake timed out\n",
+		       region->region_id,
+		       state == DFX_DECOUPLE ? "decouple" : "couple");
+	return err;
+}
+
+/* Best effort: give back the regions that were decoupled but not programmed */
+static void dfx_recouple(struct fpga_region_work *regions, unsigned int first,
+			 unsigned int num)
+{
+	unsigned int n;
+
+	for (n = first; n < num; n++)
+		dfx_request(&regions[n], DFX_COUPLE);
+	for (n = first; n < num; n++)
+		dfx_wait(&regions[n], DFX_COUPLE);
+}
+
+/**
+ * fpga_overlay_work - Apply the device tree overlay of a region.
+ * @work: Work item embedded in the fpga_region_work of the region.
+ *
+ * Runs while the bitstream of the next region is streamed through the PCAP.
+ */
+static void fpga_overlay_work(struct work_struct *work)
+{
+	struct fpga_region_work *region =
+		container_of(work, struct fpga_region_work, work);
+	u64 start = ktime_get_ns();
+
+	pr_info("Loading device tree overlay: %s\n", region->device->fpga_dto);
+	region->err = apply_overlay(region->overlay_id, region->device->fpga_dto,
+				    region->overlay);
+	if (region->err)
+		pr_err("Failed to apply device tree overlay %s\n",
+		       region->device->fpga_dto);
+	else
+		pr_info("Device tree overlay applied with ID: %d\n",
+			*region->overlay_id);
+	region->overlay_ns = ktime_get_ns() - start;
+}
+
+/**
+ * remove_overlays - Remove the device tree overlays applied for a cell.
+ * @cell: Cell whose overlays are removed.
+ *
+ * Return: 0 on success, -EINVAL if an overlay could not be removed.
+ */
+static int remove_overlays(struct cell *cell)
+{
+	unsigned int n;
+	int err = 0;
+
+	if (!cell->fpga_overlay_ids)
+		return 0;
+
+	for (n = 0; n < cell->num_fpga_overlays; n++) {
+		if (cell->fpga_overlay_ids[n] == -1)
+			continue;
+		/* TODO: Daniele Ottaviano
+		 * Solve the OF memory leak error
+		 */
+		pr_info("Removing device tree overlay with ID: %d\n", cell->fpga_overlay_ids[n]);
+		if (of_overlay_remove(&cell->fpga_overlay_ids[n])) {
+			pr_err("Failed to remove overlay\n");
+			err = -EINVAL;
+		}
+		cell->fpga_overlay_ids[n] = -1;
+	}
+
+	return err;
+}
+
 /**
  * jailhouse_fpga_regions_setup - Configures FPGA regions for a given cell
  *
@@ -254,128 +552,221 @@ int jailhouse_root_bitstream(char *bitstream_name, long flags)
  *          details for the cell
  *
  * This function sets up the FPGA regions for the specified Jailhouse cell
- * based on the provided configuration. It ensures that the FPGA regions
- * are properly initialized and mapped for the cell's use.
+ * based on the provided configuration. All regions are decoupled first, then
+ * their bitstreams are loaded back to back through the FPGA manager, each
+ * region being coupled again as soon as it is programmed. The device tree
+ * overlay of a programmed region is applied asynchronously while the next
+ * bitstream is loaded. The time spent in each phase is stored in
+ * cell->fpga_setup_ns.
  *
  * Return: 0 on success, or a negative error code on failure.
  */
 int jailhouse_fpga_regions_setup(struct cell *cell, const struct jailhouse_cell_desc *config)
 {
 	const struct jailhouse_fpga_device *devices;
-	volatile unsigned long __iomem *fpga_start;
+	struct fpga_region_work *regions, *region;
+	struct workqueue_struct *wq = NULL;
+	unsigned int num_regions = 0;
 	unsigned int region_id;
 	unsigned int device_id;
+	unsigned int n, m, recouple = 0;
+	u64 start, phase_start;
 	int err = 0;
-	int device_found = 0;
+
+	start = ktime_get_ns();
+	memset(cell->fpga_setup_ns, 0, sizeof(cell->fpga_setup_ns));
 
 	/* Allocate memory for the overlay ids */
-	cell->fpga_overlay_ids = kmalloc(sizeof(int) * config->num_fpga_devices, GFP_KERNEL);
+	cell->num_fpga_overlays = config->num_fpga_devices;
+	cell->fpga_overlay_ids = kmalloc_array(config->num_fpga_devices,
+					       sizeof(u32), GFP_KERNEL);
 	if (!cell->fpga_overlay_ids) {
 		pr_err("Failed to allocate memory for overlay ids\n");
+		return -ENOMEM;
+	}
+	for (n = 0; n < config->num_fpga_devices; n++)
+		cell->fpga_overlay_ids[n] = -1;
+
+	regions = kcalloc(cpumask_weight(&cell->fpga_regions_assigned),
+			  sizeof(*regions), GFP_KERNEL);
+	if (!regions) {
 		err = -ENOMEM;
-		goto out;
+		goto release_overlay_ids;
 	}
 
+	/* Match the regions with their devices before touching the hardware */
 	devices = jailhouse_cell_fpga_devices(config);
 	for_each_region(region_id, &cell->fpga_regions_assigned) {
-		
-		/* Check if there is one with fpga_region_id equal to region_id. */
-		device_found = 0;
-		for (device_id = 0; device_id < config->num_fpga_devices; device_id++) {
-			if (region_id == devices[device_id].fpga_region_id) {
-				device_found = 1;
+		for (device_id = 0; device_id < config->num_fpga_devices; device_id++)
+			if (region_id == devices[device_id].fpga_region_id)
 				break;
-			}
-		}
 
-		if (device_found) {
-			/* Check if the region is already assigned to a different cell */
-			if (!cpumask_test_cpu(region_id, &root_cell->fpga_regions_assigned)) {
-				pr_err("Region %d is already assigned to a different cell\n", region_id);
+		if (device_id == config->num_fpga_devices) {
+			if (cell->id != 0) {
+				pr_err("Assigned region %d doesn't match with any fpga_device. Check the cell configuration.\n", region_id);
 				err = -EINVAL;
-				goto release_overlay_ids;
+				goto free_regions;
 			}
+			continue;
+		}
 
-			pr_info("Loading bitstream %s in FPGA region %d.\n", devices[device_id].fpga_bitstream, region_id);
+		/* Check if the region is already assigned to a different cell */
+		if (!cpumask_test_cpu(region_id, &root_cell->fpga_regions_assigned)) {
+			pr_err("Region %d is already assigned to a different cell\n", region_id);
+			err = -EINVAL;
+			goto free_regions;
+		}
 
-			/* Map the physical FPGA configuration address to virtual address space */
-			fpga_start = ioremap(devices[device_id].fpga_conf_addr, sizeof(unsigned long));
-			if (!fpga_start) {
-				pr_err("Failed to map FPGA base address\n");
-				err = -ENOMEM;
-				goto release_overlay_ids;
-			}
+		region = &regions[num_regions++];
+		region->device = &devices[device_id];
+		region->region_id = region_id;
+		region->overlay_id = &cell->fpga_overlay_ids[device_id];
+		INIT_WORK(&region->work, fpga_overlay_work);
+	}
 
-			/* Initiate safe shutdown of the DFX region and wait for it to complete */
-			iowrite8(1, (uint8_t *)fpga_start);
-			while (true) {
-				if (ioread8(((uint8_t *)fpga_start)) == 0x01) {
-					break;
-				}
-			}
+	if (num_regions == 0)
+		goto reassign;
 
-			/* Load the bitstream of the region using dfx */
-			err = load_bitstream(region_id + 1, devices[device_id].fpga_bitstream, devices[device_id].fpga_flags);
-			if (err) {
-				pr_err("Failed to load bitstream %s in FPGA region %d\n", devices[device_id].fpga_bitstream, region_id);
-				goto unmap_fpga;
-			}
+	wq = alloc_workqueue("jailhouse-fpga", WQ_UNBOUND, num_regions);
+	if (!wq) {
+		err = -ENOMEM;
+		goto free_regions;
+	}
 
-			/* Initiate safe connection of the DFX region and wait for it to complete */
-			iowrite8(0, (uint8_t *)fpga_start);
-			while (true) {
-				if (ioread8(((uint8_t *)fpga_start)) == 0x0) {
-					break;
-				}
-			}
-			iounmap(fpga_start);
-
-			/* If needed, load the device tree overlay */
-			if (devices[device_id].fpga_dto[0] != '\0') {
-				pr_info("Loading device tree overlay: %s\n", devices[device_id].fpga_dto);
-				err = apply_overlay(&cell->fpga_overlay_ids[device_id], devices[device_id].fpga_dto);
-				if (err) {
-					pr_err("Failed to apply device tree overlay %s\n", devices[device_id].fpga_dto);
-					goto release_overlay_ids;
-				}
-				pr_info("Device tree overlay applied with ID: %d\n", cell->fpga_overlay_ids[device_id]);
-			} else {
-				cell->fpga_overlay_ids[device_id] = -1;
-			}
+	/* Map the physical FPGA configuration addresses to virtual address space */
+	for (n = 0; n < num_regions; n++) {
+		regions[n].decoupler =
+			ioremap(regions[n].device->fpga_conf_addr, sizeof(unsigned long));
+		if (!regions[n].decoupler) {
+			pr_err("Failed to map FPGA base address\n");
+			err = -ENOMEM;
+			goto unmap_fpga;
+		}
+	}
 
-			/* If needed and not already loaded, load the module and initialize it */
-			if (devices[device_id].fpga_module[0] != '\0') {
-				pr_info("Loading module: %s\n", devices[device_id].fpga_module);
-				err = __request_module(true, devices[device_id].fpga_module);
-				if (err) {
-					pr_err("Failed to load module %s\n", devices[device_id].fpga_module);
-					goto release_overlay_ids;
-				}
-			}
-		} else {
-			if (cell->id != 0) {
-				pr_err("Assigned region %d doesn't match with any fpga_device. Check the cell configuration.\n", region_id);
-				err = -EINVAL;
-				goto release_overlay_ids;
-			}
+	/* Initiate safe shutdown of all DFX regions, then wait for them */
+	phase_start = ktime_get_ns();
+	for (n = 0; n < num_regions; n++)
+		dfx_request(&regions[n], DFX_DECOUPLE);
+	for (n = 0; n < num_regions; n++) {
+		err = dfx_wait(&regions[n], DFX_DECOUPLE);
+		if (err) {
+			dfx_recouple(regions, 0, num_regions);
+			goto unmap_fpga;
+		}
+	}
+	cell->fpga_setup_ns[FPGA_PHASE_DECOUPLE] = ktime_get_ns() - phase_start;
+
+	for (n = 0; n < num_regions; n++) {
+		region = &regions[n];
+
+		pr_info("Loading bitstream %s in FPGA region %d.\n",
+			region->device->fpga_bitstream, region->region_id);
+
+		/* Load the bitstream of the region using dfx */
+		phase_start = ktime_get_ns();
+		err = load_bitstream(region->region_id + 1, region->device->fpga_bitstream,
+				     region->device->fpga_flags);
+		cell->fpga_setup_ns[FPGA_PHASE_BITSTREAM] += ktime_get_ns() - phase_start;
+		if (err) {
+			pr_err("Failed to load bitstream %s in FPGA region %d\n",
+			       region->device->fpga_bitstream, region->region_id);
+			/* Not programmed, but still decoupled */
+			recouple = n;
+			break;
 		}
 
-		/* If cell is not rootcell, remove the assigned regions from the rootcell */
-		if (cell->id != 0) {
-			pr_info("Removing FPGA region %d from rootcell.\n", region_id);
-			cpumask_clear_cpu(region_id, &root_cell->fpga_regions_assigned);
+		/* Initiate safe connection of the DFX region and wait for it to complete */
+		phase_start = ktime_get_ns();
+		dfx_request(region, DFX_COUPLE);
+		err = dfx_wait(region, DFX_COUPLE);
+		cell->fpga_setup_ns[FPGA_PHASE_COUPLE] += ktime_get_ns() - phase_start;
+		if (err) {
+			recouple = n + 1;
+			break;
+		}
+
+		/*
+		 * If needed, apply the overlay while the next bitstream streams.
+		 * The cache is looked up here, the work must not touch it.
+		 */
+		if (region->device->fpga_dto[0] != '\0') {
+			region->overlay =
+				fpga_image_cache_get(region->device->fpga_dto);
+			queue_work(wq, &region->work);
+			region->overlay_queued = true;
+		}
+	}
+
+	if (err)
+		dfx_recouple(regions, recouple, num_regions);
+
+	for (n = 0; n < num_regions; n++) {
+		region = &regions[n];
+		if (!region->overlay_queued)
+			continue;
+		flush_work(&region->work);
+		cell->fpga_setup_ns[FPGA_PHASE_OVERLAY] += region->overlay_ns;
+		if (region->err && !err)
+			err = region->err;
+	}
+	if (err)
+		goto unmap_fpga;
+
+	/* If needed and not already loaded, load the modules and initialize them */
+	for (n = 0; n < num_regions; n++) {
+		const char *module = regions[n].device->fpga_module;
+
+		if (module[0] == '\0')
+			continue;
+		for (m = 0; m < n; m++)
+			if (!strncmp(regions[m].device->fpga_module, module,
+				     FPGA_MODULE_NAMELEN))
+				break;
+		if (m < n)
+			continue;
+
+		pr_info("Loading module: %s\n", module);
+		err = __request_module(true, module);
+		if (err) {
+			pr_err("Failed to load module %s\n", module);
+			goto unmap_fpga;
 		}
 	}
 
 unmap_fpga:
-	if (err < 0)
-		iounmap(fpga_start);
+	for (n = 0; n < num_regions; n++)
+		if (regions[n].decoupler)
+			iounmap(regions[n].decoupler);
+	destroy_workqueue(wq);
+	if (err)
+		goto free_regions;
+
+reassign:
+	/* If cell is not rootcell, remove the assigned regions from the rootcell */
+	if (cell->id != 0)
+		for_each_region(region_id, &cell->fpga_regions_assigned) {
+			pr_info("Removing FPGA region %d from rootcell.\n", region_id);
+			cpumask_clear_cpu(region_id, &root_cell->fpga_regions_assigned);
+		}
+
+	cell->fpga_setup_ns[FPGA_PHASE_TOTAL] = ktime_get_ns() - start;
+	pr_info("FPGA setup: decouple %llu ns, bitstreams %llu ns, couple %llu ns, "
+		"overlays %llu ns, total %llu ns\n",
+		cell->fpga_setup_ns[FPGA_PHASE_DECOUPLE],
+		cell->fpga_setup_ns[FPGA_PHASE_BITSTREAM],
+		cell->fpga_setup_ns[FPGA_PHASE_COUPLE],
+		cell->fpga_setup_ns[FPGA_PHASE_OVERLAY],
+		cell->fpga_setup_ns[FPGA_PHASE_TOTAL]);
+
+free_regions:
+	kfree(regions);
 release_overlay_ids:
 	if (err < 0) {
+		remove_overlays(cell);
 		kfree(cell->fpga_overlay_ids);
 		cell->fpga_overlay_ids = NULL;
 	}
-out:
 	return err;
 }
 
@@ -394,25 +785,16 @@ out:
 int jailhouse_fpga_regions_remove(struct cell *cell)
 {
 	unsigned int region_id;
-	int err = 0;
+	int err;
 
-	for_each_region(region_id, &cell->fpga_regions_assigned) {
-		/* TODO: Daniele Ottaviano
-		 * remove the kernel module (not possible for security reason)
-		 */
+	/* TODO: Daniele Ottaviano
+	 * remove the kernel module (not possible for security reason)
+	 */
 
-		/* remove the device tree overlay (if needed) */
-		if(cell->fpga_overlay_ids[region_id] != -1){	
-			/* TODO: Daniele Ottaviano
-			 * Solve the OF memory leak error
-			 */
-			pr_info("Removing device tree overlay with ID: %d\n", cell->fpga_overlay_ids[region_id]);
-			if (of_overlay_remove(&cell->fpga_overlay_ids[region_id])) {
-				pr_err("Failed to remove overlay\n");
-				err = -EINVAL;
-			}
-		}
+	/* remove the device tree overlays (if needed) */
+	err = remove_overlays(cell);
 
+	for_each_region(region_id, &cell->fpga_regions_assigned) {
 		/* TODO: Daniele Ottaviano
 		 * The module stop the FPGA accelerator
 		 * but it would be safe to have here something that clear the FPGA region.
@@ -423,6 +805,7 @@ int jailhouse_fpga_regions_remove(struct cell *cell)
 	}
 
 	kfree(cell->fpga_overlay_ids);
+	cell->fpga_overlay_ids = NULL;
 
 	return err;
 }
@@ -28,6 +28,8 @@ int jailhouse_root_bitstream(char *bitstream_name, long flags);
 int jailhouse_fpga_regions_setup(struct cell *cell, 
 			const struct jailhouse_cell_desc *config);
 int jailhouse_fpga_regions_remove(struct cell *cell);
+int jailhouse_cmd_fpga_cache(struct jailhouse_fpga_cache __user *arg);
+void jailhouse_fpga_cache_flush(void);
 
 #else /* !CONFIG_OMNV_FPGA */
 
@@ -47,5 +49,14 @@ static inline int jailhouse_fpga_regions_remove(struct cell *cell)
 	return 0;
 }
 
+static inline int jailhouse_cmd_fpga_cache(struct jailhouse_fpga_cache __user *arg)
+{
+	return -ENOSYS;
+}
+
+static inline void jailhouse_fpga_cache_flush(void)
+{
+}
+
 #endif /* CONFIG_OMNV_FPGA */
 #endif /* _JAILHOUSE_FPGA_H */
\ No newline at end of file
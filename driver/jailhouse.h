@@ -49,6 +49,8 @@
 #include <linux/types.h>
 #include <jailhouse/qos-common.h>
 #include <jailhouse/memguard-common.h>
+#include <jailhouse/fpga-common.h>
+#include <jailhouse/trace-common.h>
 #include <jailhouse/config.h>
 
 #define JAILHOUSE_CELL_ID_NAMELEN	31
@@ -74,12 +76,41 @@ struct jailhouse_preload_rcpu_image {
 };
 
 
+#define JAILHOUSE_RCPU_FW_CACHE_PREWARM		0
+#define JAILHOUSE_RCPU_FW_CACHE_INVALIDATE	1
+
+struct jailhouse_rcpu_fw_cache {
+	__u32 cmd;
+	__u32 padding;
+	/* empty name with INVALIDATE drops all images */
+	char name[JAILHOUSE_RCPU_IMAGE_NAMELEN + 1];
+};
+
+#define JAILHOUSE_FPGA_CACHE_PRELOAD		0
+#define JAILHOUSE_FPGA_CACHE_EVICT		1
+
+struct jailhouse_fpga_cache {
+	__u32 cmd;
+	__u32 padding;
+	/* bitstream or overlay, empty name with EVICT drops all images */
+	char name[FPGA_BITSTREAM_NAMELEN + 1];
+};
+
 struct jailhouse_cell_id {
 	__s32 id;
 	__u32 padding;
 	char name[JAILHOUSE_CELL_ID_NAMELEN + 1];
 };
 
+#define JAILHOUSE_CELL_RESTART_RELOAD_DATA	0x00000001
+#define JAILHOUSE_CELL_RESTART_SWITCH_IMAGE	0x00000002
+
+struct jailhouse_cell_restart {
+	struct jailhouse_cell_id cell_id;
+	__u32 flags;
+	__u32 padding;
+};
+
 struct jailhouse_cell_load {
 	struct jailhouse_cell_id cell_id;
 	__u32 num_preload_images;
@@ -90,6 +121,13 @@ struct jailhouse_cell_load {
 	struct jailhouse_preload_image image[];
 };
 
+struct jailhouse_cell_stage {
+	struct jailhouse_cell_id cell_id;
+	__u32 num_rcpu_images;
+	__u32 padding;
+	struct jailhouse_preload_rcpu_image *rcpu_image;
+};
+
 struct jailhouse_memguard {
 	unsigned int cpu;
 	struct memguard_params params;
@@ -102,6 +140,14 @@ struct jailhouse_qos_args {
 
 #define JAILHOUSE_CELL_ID_UNUSED	(-1)
 
+/*
+ * Page offsets in the mmap space of the device: the statistics pages of the
+ * CPUs, one per CPU, start at 0, the trace rings at JAILHOUSE_MMAP_TRACE, with
+ * a stride of the ring size rounded up to pages.
+ */
+#define JAILHOUSE_MMAP_CPU_STATS	0
+#define JAILHOUSE_MMAP_TRACE		0x10000
+
 #define JAILHOUSE_ENABLE		_IOW(0, 0, void *)
 #define JAILHOUSE_DISABLE		_IO(0, 1)
 #define JAILHOUSE_CELL_CREATE		_IOW(0, 2, struct jailhouse_cell_create)
@@ -110,5 +156,9 @@ struct jailhouse_qos_args {
 #define JAILHOUSE_CELL_DESTROY		_IOW(0, 5, struct jailhouse_cell_id)
 #define JAILHOUSE_MEMGUARD		_IOW(0, 6, struct jailhouse_memguard)
 #define JAILHOUSE_QOS			_IOW(0, 7, struct jailhouse_qos_args)
+#define JAILHOUSE_RCPU_FW_CACHE		_IOW(0, 8, struct jailhouse_rcpu_fw_cache)
+#define JAILHOUSE_CELL_RESTART		_IOW(0, 9, struct jailhouse_cell_restart)
+#define JAILHOUSE_FPGA_CACHE		_IOW(0, 10, struct jailhouse_fpga_cache)
+#define JAILHOUSE_CELL_STAGE		_IOW(0, 11, struct jailhouse_cell_stage)
 
 #endif /* !_JAILHOUSE_DRIVER_H */
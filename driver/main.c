@@ -28,6 +28,7 @@
 #include <linux/miscdevice.h>
 #include <linux/firmware.h>
 #include <linux/mm.h>
+#include <linux/namei.h>
 #include <linux/kallsyms.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,11,0)
 #include <linux/sched/signal.h>
@@ -78,6 +79,10 @@
 	FEATURE_CONTROL_VMXON_ENABLED_OUTSIDE_SMX
 #endif
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+#define vm_flags_clear(vma, flags)	((vma)->vm_flags &= ~(flags))
+#endif
+
 #if JAILHOUSE_CELL_ID_NAMELEN != JAILHOUSE_CELL_NAME_MAXLEN
 # warning JAILHOUSE_CELL_ID_NAMELEN and JAILHOUSE_CELL_NAME_MAXLEN out of sync!
 #endif
@@ -110,13 +115,21 @@ DEFINE_MUTEX(jailhouse_lock);
 bool jailhouse_enabled;
 void *hypervisor_mem;
 
-static struct device *jailhouse_dev;
+struct device *jailhouse_dev;
 static unsigned long hv_core_and_percpu_size;
 static atomic_t call_done;
 static int error_code;
 static struct jailhouse_virt_console* volatile console_page;
 static bool console_available;
 static struct resource *hypervisor_mem_res;
+/* Pages of the per-CPU data exported via mmap */
+static phys_addr_t percpu_phys;
+static unsigned long percpu_size;
+static unsigned int percpu_count;
+static unsigned long percpu_stats_offset;
+static unsigned long percpu_trace_offset;
+/* Hypercall parameter page of the root cell, protected by jailhouse_lock */
+static void *param_page;
 
 static typeof(ioremap_page_range) *ioremap_page_range_sym;
 #ifdef CONFIG_X86
@@ -293,6 +306,39 @@ void *jailhouse_ioremap(phys_addr_t phys, unsigned long virt,
 	return vma->addr;
 }
 
+/**
+ * jailhouse_get_firmware_mtime - Get the modification time of a firmware file
+ * @name: Name of the file in the firmware directory
+ * @mtime: Where to store the modification time
+ *
+ * Used by the image caches to tell whether a cached copy is still current.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+int jailhouse_get_firmware_mtime(const char *name, struct timespec64 *mtime)
+{
+	char filepath[256];
+	struct kstat stat;
+	struct path path;
+	int err;
+
+	snprintf(filepath, sizeof(filepath), "/lib/firmware/%s", name);
+
+	err = kern_path(filepath, LOOKUP_FOLLOW, &path);
+	if (err < 0) {
+		pr_err("Failed to open Image file %s: %d\n", filepath, err);
+		return err;
+	}
+
+	err = vfs_getattr(&path, &stat, STATX_MTIME, AT_STATX_SYNC_AS_STAT);
+	path_put(&path);
+	if (err < 0)
+		return err;
+
+	*mtime = stat.mtime;
+	return 0;
+}
+
 /*
  * Called for each cpu by the JAILHOUSE_ENABLE ioctl.
  * It jumps to the entry point set in the header, reports the result and
@@ -593,6 +639,12 @@ static int jailhouse_cmd_enable(struct jailhouse_system __user *arg)
 	header = (struct jailhouse_header *)hypervisor_mem;
 	header->max_cpus = max_cpus;
 
+	percpu_phys = hv_mem->phys_start + header->core_size;
+	percpu_size = header->percpu_size;
+	percpu_count = max_cpus;
+	percpu_stats_offset = header->percpu_stats_page;
+	percpu_trace_offset = header->percpu_trace_page;
+
 #if defined(CONFIG_ARM) || defined(CONFIG_ARM64)
 	header->arm_linux_hyp_vectors = virt_to_phys(*__hyp_stub_vectors_sym);
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,12,0)
@@ -717,6 +769,10 @@ static int jailhouse_cmd_enable(struct jailhouse_system __user *arg)
 
 	jailhouse_enabled = true;
 
+	/* Optional, the parameters are passed by address without it. */
+	param_page = (void *)get_zeroed_page(GFP_KERNEL);
+	jailhouse_param_page_refresh();
+
 	mutex_unlock(&jailhouse_lock);
 
 	pr_info("The Jailhouse is opening.\n");
@@ -846,6 +902,11 @@ static int jailhouse_cmd_disable(void)
 	jailhouse_enabled = false;
 	module_put(THIS_MODULE);
 
+	if (param_page) {
+		free_page((unsigned long)param_page);
+		param_page = NULL;
+	}
+
 	pr_info("The Jailhouse was closed.\n");
 
 unlock_out:
@@ -854,15 +915,55 @@ unlock_out:
 	return err;
 }
 
+/**
+ * jailhouse_param_page_refresh() - Make sure the parameter page is registered
+ *
+ * The hypervisor drops the parameter page of the root cell when the memory
+ * backing it goes to another cell. Registering it again is a no-op while it is
+ * still registered, otherwise the parameters are passed by address from now
+ * on. Called with jailhouse_lock held after each cell creation and start.
+ */
+void jailhouse_param_page_refresh(void)
+{
+	if (param_page &&
+	    jailhouse_call_arg1(JAILHOUSE_HC_PARAM_PAGE_REGISTER,
+				__pa(param_page)) != 0) {
+		free_page((unsigned long)param_page);
+		param_page = NULL;
+	}
+}
+
+/**
+ * jailhouse_params_address() - Hypercall argument for a parameter structure
+ * @params:	Parameter structure
+ * @size:	Size of the structure
+ *
+ * Copies the structure into the parameter page, if registered, so that the
+ * hypervisor does not have to map it. Must be called with jailhouse_lock held,
+ * the page is only valid until the lock is dropped.
+ *
+ * Return: Reference to the parameter page or guest-physical address of
+ * @params.
+ */
+static unsigned long jailhouse_params_address(const void *params, size_t size)
+{
+	if (param_page && size <= PAGE_SIZE) {
+		memcpy(param_page, params, size);
+		return JAILHOUSE_PARAM_PAGE_REF;
+	}
+	return __pa(params);
+}
+
 static int memguard_call_one_cpu(void *par)
 {
-	struct memguard_params *params = (struct memguard_params *)(par);
-	return jailhouse_call_arg1(JAILHOUSE_HC_MEMGUARD_SET, __pa(params));
+	return jailhouse_call_arg1(JAILHOUSE_HC_MEMGUARD_SET,
+				   (unsigned long)par);
 }
 
 int jailhouse_cmd_memguard(struct jailhouse_memguard __user *arg)
 {
 	struct jailhouse_memguard *mg;
+	void *params;
 	int err;
 
 	mg = kmalloc(sizeof(struct jailhouse_memguard),
@@ -886,6 +987,8 @@ int jailhouse_cmd_memguard(struct jailhouse_memguard __user *arg)
 	}
 
 	err = 0;
+	params = (void *)jailhouse_params_address(&mg->params,
+						  sizeof(mg->params));
 	if (mg->cpu == -1) {
 		/* process all online CPUs:
 		 * implicitly, all CPUs visible by this cell.
@@ -895,11 +998,11 @@ int jailhouse_cmd_memguard(struct jailhouse_memguard __user *arg)
 			pr_info("[MG] Setup CPU %u\n", i);
 			mg->cpu = i;
 			err = smp_call_on_cpu(mg->cpu, memguard_call_one_cpu,
-					      &mg->params, true);
+					      params, true);
 		}
 	} else {
 		err = smp_call_on_cpu(mg->cpu, memguard_call_one_cpu,
-				      &mg->params, true);
+				      params, true);
 	}
 	if (err) {
 		pr_err("Jailhouse: unable to set memguard parameters "
@@ -942,8 +1045,17 @@ int jailhouse_cmd_qos(struct jailhouse_qos_args __user *arg)
 		return -EFAULT;
 	}
 
+	if (mutex_lock_interruptible(&jailhouse_lock) != 0) {
+		kfree(settings);
+		return -EINTR;
+	}
+
 	/* Invoke QoS hypercall */
-	err = jailhouse_call_arg2(JAILHOUSE_HC_QOS, count, __pa(settings));
+	err = jailhouse_call_arg2(JAILHOUSE_HC_QOS, count,
+				  jailhouse_params_address(settings,
+					count * sizeof(struct qos_setting)));
+
+	mutex_unlock(&jailhouse_lock);
 
 	/* Deallocate buffer */
 	kfree(settings);
@@ -980,6 +1092,14 @@ static long jailhouse_ioctl(struct file *file, unsigned int ioctl,
 	case JAILHOUSE_CELL_START:
 		err = jailhouse_cmd_cell_start((const char __user *)arg);
 		break;
+	case JAILHOUSE_CELL_RESTART:
+		err = jailhouse_cmd_cell_restart(
+				(struct jailhouse_cell_restart __user *)arg);
+		break;
+	case JAILHOUSE_CELL_STAGE:
+		err = jailhouse_cmd_cell_stage(
+				(struct jailhouse_cell_stage __user *)arg);
+		break;
 	case JAILHOUSE_CELL_DESTROY:
 		err = jailhouse_cmd_cell_destroy((const char __user *)arg);
 		break;
@@ -991,6 +1111,14 @@ static long jailhouse_ioctl(struct file *file, unsigned int ioctl,
 		err = jailhouse_cmd_qos(
 				(struct jailhouse_qos_args __user *)arg);
 	    break;
+	case JAILHOUSE_RCPU_FW_CACHE:
+		err = jailhouse_cmd_rcpu_fw_cache(
+				(struct jailhouse_rcpu_fw_cache __user *)arg);
+		break;
+	case JAILHOUSE_FPGA_CACHE:
+		err = jailhouse_cmd_fpga_cache(
+				(struct jailhouse_fpga_cache __user *)arg);
+		break;
 	default:
 		err = -EINVAL;
 		break;
@@ -1100,6 +1228,71 @@ console_free_out:
 	return ret;
 }
 
+/*
+ * Returns the physical address of the page at @pgoff in the mmap space of the
+ * device, see JAILHOUSE_MMAP_*, 0 if there is none.
+ */
+static phys_addr_t jailhouse_mmap_page(unsigned long pgoff)
+{
+	unsigned long ring_pages =
+		PAGE_ALIGN(sizeof(struct jailhouse_trace_ring)) >> PAGE_SHIFT;
+
+	if (pgoff - JAILHOUSE_MMAP_CPU_STATS < percpu_count)
+		return percpu_phys +
+			(pgoff - JAILHOUSE_MMAP_CPU_STATS) * percpu_size +
+			percpu_stats_offset;
+
+	pgoff -= JAILHOUSE_MMAP_TRACE;
+	if (percpu_trace_offset != 0 && pgoff < percpu_count * ring_pages)
+		return percpu_phys + (pgoff / ring_pages) * percpu_size +
+			percpu_trace_offset + (pgoff % ring_pages) * PAGE_SIZE;
+
+	return 0;
+}
+
+/*
+ * Maps the statistics pages or the trace rings of the CPUs read-only, the page
+ * offset selects the first page. Both can then be polled without any
+ * hypercall.
+ */
+static int jailhouse_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long pages = vma_pages(vma);
+	phys_addr_t phys;
+	unsigned long n;
+	int err = 0;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	if (mutex_lock_interruptible(&jailhouse_lock) != 0)
+		return -EINTR;
+
+	if (!jailhouse_enabled) {
+		err = -EINVAL;
+		goto unlock_out;
+	}
+
+	/* A mapping must not cross the end of its region */
+	for (n = 0; n < pages; n++)
+		if (jailhouse_mmap_page(vma->vm_pgoff + n) == 0) {
+			err = -EINVAL;
+			goto unlock_out;
+		}
+
+	vm_flags_clear(vma, VM_MAYWRITE);
+	for (n = 0; n < pages && !err; n++) {
+		phys = jailhouse_mmap_page(vma->vm_pgoff + n);
+		err = remap_pfn_range(vma, vma->vm_start + n * PAGE_SIZE,
+				      PHYS_PFN(phys), PAGE_SIZE,
+				      vma->vm_page_prot);
+	}
+
+unlock_out:
+	mutex_unlock(&jailhouse_lock);
+
+	return err;
+}
 
 static const struct file_operations jailhouse_fops = {
 	.owner = THIS_MODULE,
@@ -1109,6 +1302,7 @@ static const struct file_operations jailhouse_fops = {
 	.open = jailhouse_console_open,
 	.release = jailhouse_console_release,
 	.read = jailhouse_console_read,
+	.mmap = jailhouse_mmap,
 };
 
 static struct miscdevice jailhouse_misc_dev = {
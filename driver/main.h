@@ -14,6 +14,7 @@
 #define _JAILHOUSE_DRIVER_MAIN_H
 
 #include <linux/mutex.h>
+#include <linux/time64.h>
 
 #include "cell.h"
 
@@ -28,10 +29,13 @@
 extern struct mutex jailhouse_lock;
 extern bool jailhouse_enabled;
 extern void *hypervisor_mem;
+extern struct device *jailhouse_dev;
 
 void *jailhouse_ioremap(phys_addr_t phys, unsigned long virt,
 			unsigned long size);
 int jailhouse_console_dump_delta(char *dst, unsigned int head,
 				 unsigned int *miss);
+int jailhouse_get_firmware_mtime(const char *name, struct timespec64 *mtime);
+void jailhouse_param_page_refresh(void);
 
 #endif /* !_JAILHOUSE_DRIVER_MAIN_H */
@@ -14,16 +14,63 @@
 */
 
 #include "rcpu.h"
+#include "main.h"
+
+#include <jailhouse/hypercall.h>
 
 #ifdef CONFIG_OMNIVISOR
+#include <linux/elf.h>
+#include <linux/firmware.h>
+#include <linux/fs.h>
+#include <linux/list.h>
+#include <linux/namei.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/remoteproc.h>
 #include <linux/slab.h>
 #include <linux/remoteproc.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/timex.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 static struct rcpu_info **root_rcpus_info;
 static int num_root_rcpus;
+
+/*
+ * Pinned rCPU firmware images. Holding a reference on the firmware makes the
+ * request_firmware() issued by remoteproc on rproc_boot() reuse the buffer
+ * instead of reading the file again.
+ */
+struct rcpu_fw_entry {
+	struct list_head entry;
+	char name[JAILHOUSE_RCPU_IMAGE_NAMELEN + 1];
+	struct timespec64 mtime;
+	const struct firmware *fw;
+	u64 entry_point;
+	unsigned int num_segments;
+};
+
+static LIST_HEAD(rcpu_fw_cache);
+static DEFINE_MUTEX(rcpu_fw_cache_lock);
+
+/*
+ * Per-rCPU work item used to load and release the rCPUs of a cell in
+ * parallel. On release, all workers block on @release so that the actual
+ * start of the cores happens as close together as possible.
+ */
+struct rcpu_work {
+	struct work_struct work;
+	struct rcpu_info *rcpu;
+	unsigned int rcpu_id;
+	const char *image;
+	struct completion *release;
+	atomic_t *pending;
+	struct completion *ready;
+	ktime_t start_time;
+	int err;
+};
 /*
  * A state-to-string lookup table, for exposing a human readable state
  * via sysfs. Always keep in sync with enum rproc_state
@@ -39,30 +86,276 @@ static const char * const rproc_state_string[] = {
 	[RPROC_LAST]		= "invalid",
 };
 
+/* Class independent view of an ELF program header */
+struct rcpu_segment {
+	u32 type;
+	u32 flags;
+	u64 paddr;
+	u64 offset;
+	u64 filesz;
+	u64 memsz;
+};
+
+/**
+ * get_image_header - Validate the ELF header of an image
+ * @fw: Firmware holding the image
+ * @entry: Where to store the entry point
+ * @phnum: Where to store the number of program headers
+ *
+ * Return: 0 on success, -EINVAL if the image is not a valid ELF file.
+ */
+static int get_image_header(const struct firmware *fw, u64 *entry,
+			    unsigned int *phnum)
+{
+	const u8 *data = fw->data;
+	size_t size = fw->size;
+
+	if (size < EI_NIDENT || memcmp(data, ELFMAG, SELFMAG) != 0)
+		return -EINVAL;
+
+	if (data[EI_CLASS] == ELFCLASS32) {
+		const struct elf32_hdr *ehdr = (const void *)data;
+
+		if (size < sizeof(*ehdr) || ehdr->e_phoff > size ||
+		    ehdr->e_phnum > (size - ehdr->e_phoff) /
+				    sizeof(struct elf32_phdr))
+			return -EINVAL;
+		*entry = ehdr->e_entry;
+		*phnum = ehdr->e_phnum;
+	} else if (data[EI_CLASS] == ELFCLASS64) {
+		const struct elf64_hdr *ehdr = (const void *)data;
+
+		if (size < sizeof(*ehdr) || ehdr->e_phoff > size ||
+		    ehdr->e_phnum > (size - ehdr->e_phoff) /
+				    sizeof(struct elf64_phdr))
+			return -EINVAL;
+		*entry = ehdr->e_entry;
+		*phnum = ehdr->e_phnum;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 /**
- * check_image - Check if the image file exists in the firmware directory
- * @name: Name of the image file to check
+ * get_image_segment - Get a program header of an image
+ * @fw: Firmware holding the image, already validated by get_image_header()
+ * @n: Index of the program header
+ * @seg: Where to store the program header
  *
- * This function checks if the specified image file exists in the firmware
- * directory /lib/firmware. 
+ * Return: 0 on success, -EINVAL if the segment lies outside of the image.
+ */
+static int get_image_segment(const struct firmware *fw, unsigned int n,
+			     struct rcpu_segment *seg)
+{
+	const u8 *data = fw->data;
+
+	if (data[EI_CLASS] == ELFCLASS32) {
+		const struct elf32_hdr *ehdr = (const void *)data;
+		const struct elf32_phdr *phdr =
+			(const void *)(data + ehdr->e_phoff) + n * sizeof(*phdr);
+
+		seg->type = phdr->p_type;
+		seg->flags = phdr->p_flags;
+		seg->paddr = phdr->p_paddr;
+		seg->offset = phdr->p_offset;
+		seg->filesz = phdr->p_filesz;
+		seg->memsz = phdr->p_memsz;
+	} else {
+		const struct elf64_hdr *ehdr = (const void *)data;
+		const struct elf64_phdr *phdr =
+			(const void *)(data + ehdr->e_phoff) + n * sizeof(*phdr);
+
+		seg->type = phdr->p_type;
+		seg->flags = phdr->p_flags;
+		seg->paddr = phdr->p_paddr;
+		seg->offset = phdr->p_offset;
+		seg->filesz = phdr->p_filesz;
+		seg->memsz = phdr->p_memsz;
+	}
+
+	if (seg->type == PT_LOAD &&
+	    (seg->offset > fw->size || seg->filesz > fw->size - seg->offset ||
+	     seg->filesz > seg->memsz))
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * parse_image - Validate an ELF image and get its entry point and segments
+ * @fw_entry: Cache entry holding the firmware to parse
+ *
+ * Return: 0 on success, -EINVAL if the image is not a valid ELF file.
+ */
+static int parse_image(struct rcpu_fw_entry *fw_entry)
+{
+	struct rcpu_segment seg;
+	unsigned int phnum, n;
+	int err;
+
+	err = get_image_header(fw_entry->fw, &fw_entry->entry_point, &phnum);
+	if (err < 0)
+		return err;
+
+	fw_entry->num_segments = 0;
+	for (n = 0; n < phnum; n++) {
+		err = get_image_segment(fw_entry->fw, n, &seg);
+		if (err < 0)
+			return err;
+		if (seg.type == PT_LOAD)
+			fw_entry->num_segments++;
+	}
+
+	return fw_entry->num_segments > 0 ? 0 : -EINVAL;
+}
+
+static struct rcpu_fw_entry *rcpu_fw_cache_lookup(const char *name)
+{
+	struct rcpu_fw_entry *fw_entry;
+
+	list_for_each_entry(fw_entry, &rcpu_fw_cache, entry)
+		if (strcmp(fw_entry->name, name) == 0)
+			return fw_entry;
+	return NULL;
+}
+
+static void rcpu_fw_cache_release(struct rcpu_fw_entry *fw_entry)
+{
+	list_del(&fw_entry->entry);
+	release_firmware(fw_entry->fw);
+	kfree(fw_entry);
+}
+
+/**
+ * rcpu_fw_cache_get - Make sure an up-to-date copy of an image is pinned
+ * @name: Name of the image file in the firmware directory
+ *
+ * The image is (re)loaded from the firmware directory only if it is not
+ * cached yet or if its modification time changed since it was cached.
+ * A cache hit only costs a path lookup. The cache lock is not held while
+ * reading the file, so that different images can be loaded concurrently.
  *
  * Return: 0 on success, or a negative error code on failure.
  */
-static int check_image(const char *name)
+static int rcpu_fw_cache_get(const char *name)
 {
-	int err = 0;
-	struct file *file;
-	char filepath[256];
+	struct rcpu_fw_entry *fw_entry, *cached;
+	struct timespec64 mtime;
+	int err;
 
-	snprintf(filepath, sizeof(filepath), "/lib/firmware/%s", name);
+	mutex_lock(&rcpu_fw_cache_lock);
 
-	file = filp_open(filepath, O_RDONLY, 0);
-	if (IS_ERR(file)) {
-		err = PTR_ERR(file);
-		pr_err("Failed to open Image file %s: %d\n", filepath, err);
+	err = jailhouse_get_firmware_mtime(name, &mtime);
+	if (err < 0) {
+		mutex_unlock(&rcpu_fw_cache_lock);
 		return err;
 	}
-	filp_close(file, NULL);
+
+	fw_entry = rcpu_fw_cache_lookup(name);
+	if (fw_entry) {
+		if (timespec64_equal(&fw_entry->mtime, &mtime)) {
+			mutex_unlock(&rcpu_fw_cache_lock);
+			return 0;
+		}
+		pr_info("Image %s changed, reloading\n", name);
+		rcpu_fw_cache_release(fw_entry);
+	}
+
+	mutex_unlock(&rcpu_fw_cache_lock);
+
+	fw_entry = kzalloc(sizeof(*fw_entry), GFP_KERNEL);
+	if (!fw_entry)
+		return -ENOMEM;
+	strscpy(fw_entry->name, name, sizeof(fw_entry->name));
+	fw_entry->mtime = mtime;
+
+	err = request_firmware(&fw_entry->fw, name, jailhouse_dev);
+	if (err < 0) {
+		pr_err("Failed to load Image file %s: %d\n", name, err);
+		goto free_entry;
+	}
+
+	err = parse_image(fw_entry);
+	if (err < 0) {
+		pr_err("Image file %s is not a valid ELF file\n", name);
+		goto release_fw;
+	}
+
+	mutex_lock(&rcpu_fw_cache_lock);
+	cached = rcpu_fw_cache_lookup(name);
+	if (cached) {
+		/* Somebody else cached the same image in the meantime */
+		mutex_unlock(&rcpu_fw_cache_lock);
+		goto release_fw;
+	}
+	pr_info("Cached Image %s: %zu bytes, %u segments, entry 0x%llx\n",
+		name, fw_entry->fw->size, fw_entry->num_segments,
+		fw_entry->entry_point);
+	list_add(&fw_entry->entry, &rcpu_fw_cache);
+	mutex_unlock(&rcpu_fw_cache_lock);
+	return 0;
+
+release_fw:
+	release_firmware(fw_entry->fw);
+free_entry:
+	kfree(fw_entry);
+	return err;
+}
+
+/**
+ * rcpu_fw_cache_invalidate - Drop cached images
+ * @name: Name of the image to drop, NULL or empty to drop all of them
+ */
+static void rcpu_fw_cache_invalidate(const char *name)
+{
+	struct rcpu_fw_entry *fw_entry, *tmp;
+
+	mutex_lock(&rcpu_fw_cache_lock);
+	list_for_each_entry_safe(fw_entry, tmp, &rcpu_fw_cache, entry)
+		if (!name || name[0] == '\0' ||
+		    strcmp(fw_entry->name, name) == 0)
+			rcpu_fw_cache_release(fw_entry);
+	mutex_unlock(&rcpu_fw_cache_lock);
+}
+
+/**
+ * jailhouse_cmd_rcpu_fw_cache - Pre-warm or invalidate the rCPU image cache
+ * @arg: User-space request
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+int jailhouse_cmd_rcpu_fw_cache(struct jailhouse_rcpu_fw_cache __user *arg)
+{
+	struct jailhouse_rcpu_fw_cache req;
+	int err = 0;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+	req.name[sizeof(req.name) - 1] = '\0';
+
+	if (mutex_lock_interruptible(&jailhouse_lock) != 0)
+		return -EINTR;
+
+	if (!jailhouse_enabled) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	switch (req.cmd) {
+	case JAILHOUSE_RCPU_FW_CACHE_PREWARM:
+		err = rcpu_fw_cache_get(req.name);
+		break;
+	case JAILHOUSE_RCPU_FW_CACHE_INVALIDATE:
+		rcpu_fw_cache_invalidate(req.name);
+		break;
+	default:
+		err = -EINVAL;
+	}
+
+unlock:
+	mutex_unlock(&jailhouse_lock);
 	return err;
 }
 
@@ -384,6 +677,7 @@ static int setup_rcpu(struct rcpu_info **rcpu_array, unsigned int rcpu_id,
 	}
 
 	/* Load the ID, the name, and the compatible from the cell configuration */
+	rcpu_array[rcpu_id]->staged = NULL;
 	rcpu_array[rcpu_id]->id = rcpu_devices[rcpu_device_id].rcpu_id;
 	strncpy(rcpu_array[rcpu_id]->name, rcpu_devices[rcpu_device_id].name, JAILHOUSE_RCPU_IMAGE_NAMELEN);
 	strncpy(rcpu_array[rcpu_id]->compatible, rcpu_devices[rcpu_device_id].compatible, JAILHOUSE_RCPU_IMAGE_NAMELEN);
@@ -623,113 +917,671 @@ out:
 	return err;
 }
 
+static struct rcpu_info *get_rcpu_info(struct cell *cell, unsigned int rcpu_id)
+{
+	if (rcpu_id < num_root_rcpus)
+		return root_rcpus_info[rcpu_id];
+	return cell->soft_rcpus_info[rcpu_id - num_root_rcpus];
+}
+
 /**
- * jailhouse_load_rcpu_image - Load the firmware image for a remote CPU (rCPU).
- * @cell: Pointer to the cell structure where the rCPU is assigned.
- * @rcpu_uimage: Pointer to the user-space structure containing the rCPU image information.
+ * load_rcpu_image - Load a firmware image on a remote CPU (rCPU).
+ * @rcpu: Pointer to the rcpu_info structure of the target rCPU.
+ * @rcpu_id: ID of the target rCPU.
+ * @name: Name of the image in the firmware directory.
  *
- * This function loads the firmware image for a remote CPU (rCPU) specified in the
- * user-space structure. It checks if the rCPU ID is valid, verifies if the image file
- * exists, and then loads the firmware via remoteproc.
- *
- * Return:
- * 0 on success, or a negative error code on failure.
+ * Return: 0 on success, or a negative error code on failure.
  */
-int jailhouse_load_rcpu_image(struct cell *cell, struct jailhouse_preload_rcpu_image __user *rcpu_uimage){
-	struct jailhouse_preload_rcpu_image rcpu_image;
-	struct rcpu_info *rcpu;
-	int rcpu_id;
-	int err = 0;
-
-	if (copy_from_user(&rcpu_image, rcpu_uimage, sizeof(rcpu_image))) {
-		err = -EFAULT;
-		goto out;
-	}
-
-	rcpu_id = rcpu_image.rcpu_id; // starts from 0
-
-	/* Check if the rcpu id is in the assigned rcpus */
-	pr_info("Checking rcpu ID %d\n", rcpu_id);
-	if (!cpumask_test_cpu(rcpu_id, &cell->rcpus_assigned)) {
-		pr_err("rcpu ID %d not valid\n", rcpu_id);
-		err = -EINVAL;
-		goto out;
-	}
+static int load_rcpu_image(struct rcpu_info *rcpu, unsigned int rcpu_id,
+			   const char *name)
+{
+	int err;
 
-	/* Check if the image file exists */
-	pr_info("Checking Image file %s\n", rcpu_image.name);
-	err = check_image(rcpu_image.name);
+	/* Check if the image file exists and pin it for remoteproc */
+	pr_info("Checking Image file %s\n", name);
+	err = rcpu_fw_cache_get(name);
 	if (err < 0) {
-		pr_err("Image file %s not found\n", rcpu_image.name);
-		goto out;
+		pr_err("Image file %s not found\n", name);
+		return err;
 	}
 
-	if (rcpu_id < num_root_rcpus) {
-		rcpu = root_rcpus_info[rcpu_id];
-	} else {
-		rcpu = cell->soft_rcpus_info[rcpu_id - num_root_rcpus];
-	}
+	pr_info("Loading Firmware %s on rCPU %d\n", name, rcpu_id);
 
-	pr_info("Loading Firmware %s on rCPU %d\n", rcpu_image.name, rcpu_id);
-	
 	/* Set firmware name in the rproc struct */
-	err = rproc_set_firmware(rcpu->rproc, rcpu_image.name);
+	err = rproc_set_firmware(rcpu->rproc, name);
 	if (err < 0) {
 		pr_err("Failed to set firmware for rcpu %d\n", rcpu_id);
-		goto out;
+		return err;
 	}
 
 	/* Load the firmware via remoteproc */
 	err = load_rcpu_firmware(rcpu);
 	if (err < 0) {
 		pr_err("Failed to load firmware for rcpu %d\n", rcpu_id);
-		goto out;
+		return err;
 	}
 
-	pr_info("Loaded Firmware %s on rCPU %d\n", rcpu_image.name, rcpu_id);
+	pr_info("Loaded Firmware %s on rCPU %d\n", name, rcpu_id);
+	return 0;
+}
 
-out:
+static void rcpu_load_work(struct work_struct *work)
+{
+	struct rcpu_work *rw = container_of(work, struct rcpu_work, work);
+
+	rw->err = load_rcpu_image(rw->rcpu, rw->rcpu_id, rw->image);
+}
+
+static void rcpu_start_work(struct work_struct *work)
+{
+	struct rcpu_work *rw = container_of(work, struct rcpu_work, work);
+
+	/* Signal readiness and wait for the common release */
+	if (atomic_dec_and_test(rw->pending))
+		complete(rw->ready);
+	wait_for_completion(rw->release);
+
+	rw->start_time = ktime_get();
+	rw->err = start_rcpu_state(rw->rcpu);
+}
+
+/**
+ * jailhouse_load_rcpu_images - Load firmware images on several rCPUs at once.
+ * @cell: Pointer to the cell structure where the rCPUs are assigned.
+ * @images: Array of (rCPU ID, image name) pairs, in kernel memory.
+ * @num_images: Number of entries in @images.
+ *
+ * All IDs are validated first, then the images are loaded concurrently, one
+ * work item per rCPU. If any load fails, the rCPUs that were successfully
+ * loaded are shut down again.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+int jailhouse_load_rcpu_images(struct cell *cell,
+			       struct jailhouse_preload_rcpu_image *images,
+			       unsigned int num_images)
+{
+	struct workqueue_struct *wq;
+	struct rcpu_work *works;
+	cpumask_t requested;
+	unsigned int n;
+	int err = 0;
+
+	if (num_images == 0)
+		return 0;
+
+	/* Check if the rcpu ids are in the assigned rcpus, once each */
+	cpumask_clear(&requested);
+	for (n = 0; n < num_images; n++) {
+		images[n].name[JAILHOUSE_RCPU_IMAGE_NAMELEN] = '\0';
+		if (images[n].rcpu_id >= nr_cpumask_bits ||
+		    !cpumask_test_cpu(images[n].rcpu_id, &cell->rcpus_assigned) ||
+		    cpumask_test_and_set_cpu(images[n].rcpu_id, &requested)) {
+			pr_err("rcpu ID %d not valid\n", images[n].rcpu_id);
+			return -EINVAL;
+		}
+	}
+
+	works = kcalloc(num_images, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return -ENOMEM;
+
+	wq = alloc_workqueue("jailhouse-rcpu", WQ_UNBOUND, num_images);
+	if (!wq) {
+		err = -ENOMEM;
+		goto free_works;
+	}
+
+	cell->boot_stamps[RCPU_STAMP_FW_LOAD_BEGIN] = get_cycles();
+
+	for (n = 0; n < num_images; n++) {
+		works[n].rcpu_id = images[n].rcpu_id;
+		works[n].rcpu = get_rcpu_info(cell, images[n].rcpu_id);
+		works[n].image = images[n].name;
+		INIT_WORK(&works[n].work, rcpu_load_work);
+		queue_work(wq, &works[n].work);
+	}
+	flush_workqueue(wq);
+	destroy_workqueue(wq);
+
+	cell->boot_stamps[RCPU_STAMP_FW_LOAD_END] = get_cycles();
+
+	for (n = 0; n < num_images; n++)
+		if (works[n].err < 0)
+			err = works[n].err;
+
+	if (err < 0)
+		for (n = 0; n < num_images; n++)
+			if (works[n].err == 0)
+				rproc_shutdown(works[n].rcpu->rproc);
+
+free_works:
+	kfree(works);
+	return err;
+}
+
+/*
+ * Image staged for a running rCPU: its loadable segments, already laid out as
+ * they have to appear in the rCPU memory (bss included), so that switching to
+ * it only costs one copy per segment.
+ */
+struct rcpu_stage {
+	char name[JAILHOUSE_RCPU_IMAGE_NAMELEN + 1];
+	void *data;
+	unsigned int num_segments;
+	struct {
+		u64 da;
+		u64 size;
+		size_t offset;
+	} seg[];
+};
+
+static void rcpu_stage_free(struct rcpu_info *rcpu)
+{
+	if (!rcpu || !rcpu->staged)
+		return;
+
+	vfree(rcpu->staged->data);
+	kfree(rcpu->staged);
+	rcpu->staged = NULL;
+}
+
+/**
+ * stage_rcpu_image - Prepare the next image of a running rCPU.
+ * @rcpu: Pointer to the rcpu_info structure of the target rCPU.
+ * @name: Name of the image in the firmware directory.
+ *
+ * The image is pinned in the image cache and its PT_LOAD segments are copied
+ * into a staging buffer in root cell memory. The rCPU keeps running: every
+ * segment has to fall into the memory remoteproc already set up for the
+ * current image, which is only touched when the image is switched.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+static int stage_rcpu_image(struct rcpu_info *rcpu, const char *name)
+{
+	struct rcpu_fw_entry *fw_entry;
+	struct rcpu_stage *stage;
+	struct rcpu_segment seg;
+	unsigned int phnum, n;
+	size_t size = 0;
+	bool is_iomem;
+	u64 entry;
+	int err;
+
+	if (!rcpu || !rcpu->rproc || rcpu->rproc->state != RPROC_RUNNING) {
+		pr_err("rCPU is not running, load the image instead\n");
+		return -EINVAL;
+	}
+
+	err = rcpu_fw_cache_get(name);
+	if (err < 0)
+		return err;
+
+	mutex_lock(&rcpu_fw_cache_lock);
+
+	fw_entry = rcpu_fw_cache_lookup(name);
+	if (!fw_entry) {
+		err = -ENOENT;
+		goto unlock;
+	}
+
+	err = get_image_header(fw_entry->fw, &entry, &phnum);
+	if (err < 0)
+		goto unlock;
+
+	stage = kzalloc(struct_size(stage, seg, fw_entry->num_segments),
+			GFP_KERNEL);
+	if (!stage) {
+		err = -ENOMEM;
+		goto unlock;
+	}
+	strscpy(stage->name, name, sizeof(stage->name));
+
+	/* Lay the segments out and check them against the rCPU memory */
+	for (n = 0; n < phnum; n++) {
+		err = get_image_segment(fw_entry->fw, n, &seg);
+		if (err < 0)
+			goto free_stage;
+		if (seg.type != PT_LOAD || !seg.memsz)
+			continue;
+
+		if (seg.filesz > seg.memsz || seg.offset > fw_entry->fw->size ||
+		    seg.filesz > fw_entry->fw->size - seg.offset ||
+		    !rproc_da_to_va(rcpu->rproc, seg.paddr, seg.memsz,
+				    &is_iomem)) {
+			pr_err("Bad segment 0x%llx of %s for rCPU %s\n",
+			       seg.paddr, name, rcpu->name);
+			err = -EINVAL;
+			goto free_stage;
+		}
+
+		stage->seg[stage->num_segments].da = seg.paddr;
+		stage->seg[stage->num_segments].size = seg.memsz;
+		stage->seg[stage->num_segments].offset = size;
+		stage->num_segments++;
+		size += seg.memsz;
+	}
+
+	/* Zeroed, so the bss part of the segments is ready as well */
+	stage->data = vzalloc(size);
+	if (!stage->data) {
+		err = -ENOMEM;
+		goto free_stage;
+	}
+
+	for (n = 0, size = 0; n < phnum; n++) {
+		get_image_segment(fw_entry->fw, n, &seg);
+		if (seg.type != PT_LOAD || !seg.memsz)
+			continue;
+		memcpy(stage->data + size, fw_entry->fw->data + seg.offset,
+		       seg.filesz);
+		size += seg.memsz;
+	}
+
+	rcpu_stage_free(rcpu);
+	rcpu->staged = stage;
+	pr_info("Staged %s for rCPU %s: %u segments, %zu bytes\n", name,
+		rcpu->name, stage->num_segments, size);
+	goto unlock;
+
+free_stage:
+	kfree(stage);
+unlock:
+	mutex_unlock(&rcpu_fw_cache_lock);
 	return err;
 }
 
+/**
+ * jailhouse_stage_rcpu_images - Stage the next images of running rCPUs.
+ * @cell: Pointer to the cell structure where the rCPUs are assigned.
+ * @images: Array of (rCPU ID, image name) pairs, in kernel memory.
+ * @num_images: Number of entries in @images.
+ *
+ * Staging overlaps with the run of the current images. The staged images
+ * replace the current ones on the next jailhouse_restart_rcpus() with
+ * JAILHOUSE_CELL_RESTART_SWITCH_IMAGE. Staging again replaces the image
+ * staged before.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+int jailhouse_stage_rcpu_images(struct cell *cell,
+				struct jailhouse_preload_rcpu_image *images,
+				unsigned int num_images)
+{
+	unsigned int n;
+	int err;
+
+	for (n = 0; n < num_images; n++) {
+		images[n].name[JAILHOUSE_RCPU_IMAGE_NAMELEN] = '\0';
+		if (images[n].rcpu_id >= nr_cpumask_bits ||
+		    !cpumask_test_cpu(images[n].rcpu_id, &cell->rcpus_assigned)) {
+			pr_err("rcpu ID %d not valid\n", images[n].rcpu_id);
+			return -EINVAL;
+		}
+	}
+
+	for (n = 0; n < num_images; n++) {
+		err = stage_rcpu_image(get_rcpu_info(cell, images[n].rcpu_id),
+				       images[n].name);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+}
+
 /**
  * jailhouse_start_rcpu - Start the rCPUs assigned to a given cell.
  * 
  * @cell: Pointer to the cell structure containing the rCPUs to be started.
  * 
- * This function iterates over the rCPUs assigned to the specified cell and 
- * starts each of them. It distinguishes between ASIC rCPUs (root rCPUs) and 
- * soft-core rCPUs. For root rCPUs, it uses the global `root_rcpus_info` array, 
- * while for soft-core rCPUs, it uses the `soft_rcpus_info` array within the 
- * cell structure.
- * 
+ * This function starts all rCPUs assigned to the specified cell
+ * concurrently. One work item per rCPU is queued; all of them wait until
+ * every worker is running and are then released together, so the skew
+ * between the cores only depends on the scheduling of the workers. The
+ * measured skew is stored in the cell.
+ *
  * Return:
  *  0 on success, or a negative error code if starting any rCPU fails.
  */
 int jailhouse_start_rcpu(struct cell *cell) {
+	DECLARE_COMPLETION_ONSTACK(release);
+	DECLARE_COMPLETION_ONSTACK(ready);
+	ktime_t first = KTIME_MAX, last = 0;
+	struct workqueue_struct *wq;
+	unsigned int num_rcpus, n;
+	struct rcpu_work *works;
 	unsigned int rcpu_id;
-	unsigned int soft_rcpu_id;
+	atomic_t pending;
 	int err = 0;
 
+	num_rcpus = cpumask_weight(&cell->rcpus_assigned);
+	if (num_rcpus == 0)
+		return 0;
+
+	works = kcalloc(num_rcpus, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return -ENOMEM;
+
+	/* One worker per rCPU, they all have to run at the same time */
+	wq = alloc_workqueue("jailhouse-rcpu", WQ_UNBOUND | WQ_HIGHPRI,
+			     num_rcpus);
+	if (!wq) {
+		kfree(works);
+		return -ENOMEM;
+	}
+
+	atomic_set(&pending, num_rcpus);
+	n = 0;
 	for_each_rcpu(rcpu_id, &cell->rcpus_assigned) {
 		pr_info("Starting rcpus %d of cell %d\n", rcpu_id, cell->id);
+		works[n].rcpu_id = rcpu_id;
+		works[n].rcpu = get_rcpu_info(cell, rcpu_id);
+		works[n].release = &release;
+		works[n].ready = &ready;
+		works[n].pending = &pending;
+		INIT_WORK(&works[n].work, rcpu_start_work);
+		queue_work(wq, &works[n].work);
+		n++;
+	}
 
-		/* distinguish between asic rcpus and soft-core rcpus */
-		if (rcpu_id < num_root_rcpus) {
-			err = start_rcpu_state(root_rcpus_info[rcpu_id]);
-			if (err < 0)
-				pr_err("Failed to start rCPU %d\n", rcpu_id);
+	wait_for_completion(&ready);
+	complete_all(&release);
+	flush_workqueue(wq);
+	destroy_workqueue(wq);
+
+	for (n = 0; n < num_rcpus; n++) {
+		if (works[n].err < 0) {
+			pr_err("Failed to start rCPU %d\n", works[n].rcpu_id);
+			err = works[n].err;
+			continue;
+		}
+		first = min(first, works[n].start_time);
+		last = max(last, works[n].start_time);
+	}
+
+	if (last >= first) {
+		cell->rcpu_start_skew_ns = ktime_to_ns(ktime_sub(last, first));
+		pr_info("Started rcpus of cell %d, skew %llu ns\n", cell->id,
+			cell->rcpu_start_skew_ns);
+	}
+
+	kfree(works);
+	return err;
+}
+
+/**
+ * stop_subdevices - Stop all subdevices of a remote processor
+ * @rproc: Pointer to the remote processor structure
+ */
+static void stop_subdevices(struct rproc *rproc)
+{
+	struct rproc_subdev *subdev;
+
+	list_for_each_entry_reverse(subdev, &rproc->subdevs, node) {
+		if (subdev->stop)
+			subdev->stop(subdev, false);
+	}
+}
+
+/**
+ * halt_rcpu_state - Halt a running rCPU, keeping its remoteproc resources.
+ * @rcpu: Pointer to the rcpu_info structure representing the rCPU.
+ *
+ * Only the core and its subdevices are stopped: carveouts, the loaded image
+ * and the resource table stay in place so that start_rcpu_state() can
+ * release the core again. The rproc state is deliberately left to
+ * RPROC_RUNNING, so that a later rproc_shutdown() still releases everything.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+static int halt_rcpu_state(struct rcpu_info *rcpu)
+{
+	int err;
+
+	if (!rcpu || !rcpu->rproc) {
+		pr_err("rCPU is not initialized\n");
+		return -EINVAL;
+	}
+
+	if (rcpu->rproc->state != RPROC_RUNNING)
+		return -EINVAL;
+
+	err = mutex_lock_interruptible(&rcpu->rproc->lock);
+	if (err < 0)
+		return err;
+
+	pr_info("Halting rCPU %s\n", rcpu->name);
+	stop_subdevices(rcpu->rproc);
+	err = rcpu->rproc->ops->stop(rcpu->rproc);
+	if (err < 0)
+		pr_err("Failed to halt rCPU %s\n", rcpu->name);
+
+	mutex_unlock(&rcpu->rproc->lock);
+	return err;
+}
+
+/**
+ * reload_rcpu_data - Restore the writable segments of a loaded image.
+ * @rcpu: Pointer to the rcpu_info structure representing the halted rCPU.
+ *
+ * Copies the writable PT_LOAD segments of the cached image back to the rCPU
+ * memory and zeroes their bss part. Read-only segments are left alone. The
+ * resource table, which remoteproc keeps in the loaded image, is restored
+ * from the cached copy afterwards.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+static int reload_rcpu_data(struct rcpu_info *rcpu)
+{
+	struct rproc *rproc = rcpu->rproc;
+	struct rcpu_fw_entry *fw_entry;
+	struct rcpu_segment seg;
+	unsigned int phnum, n;
+	bool is_iomem;
+	u64 entry;
+	void *ptr;
+	int err;
+
+	mutex_lock(&rcpu_fw_cache_lock);
+
+	fw_entry = rcpu_fw_cache_lookup(rproc->firmware);
+	if (!fw_entry) {
+		pr_err("Image %s of rCPU %s is not cached\n", rproc->firmware,
+		       rcpu->name);
+		err = -ENOENT;
+		goto unlock;
+	}
+
+	err = get_image_header(fw_entry->fw, &entry, &phnum);
+	if (err < 0)
+		goto unlock;
+
+	for (n = 0; n < phnum; n++) {
+		err = get_image_segment(fw_entry->fw, n, &seg);
+		if (err < 0)
+			goto unlock;
+		if (seg.type != PT_LOAD || !(seg.flags & PF_W) || !seg.memsz)
+			continue;
+
+		ptr = rproc_da_to_va(rproc, seg.paddr, seg.memsz, &is_iomem);
+		if (!ptr) {
+			pr_err("Bad segment 0x%llx for rCPU %s\n", seg.paddr,
+			       rcpu->name);
+			err = -EINVAL;
+			goto unlock;
+		}
+
+		if (is_iomem) {
+			memcpy_toio((void __iomem *)ptr,
+				    fw_entry->fw->data + seg.offset, seg.filesz);
+			memset_io((void __iomem *)ptr + seg.filesz, 0,
+				  seg.memsz - seg.filesz);
 		} else {
-			soft_rcpu_id = rcpu_id - num_root_rcpus;
-			err = start_rcpu_state(cell->soft_rcpus_info[soft_rcpu_id]);
-			if (err < 0)
-				pr_err("Failed to start soft-rCPU %d\n", rcpu_id);
+			memcpy(ptr, fw_entry->fw->data + seg.offset, seg.filesz);
+			memset(ptr + seg.filesz, 0, seg.memsz - seg.filesz);
 		}
 	}
 
+	if (rproc->table_ptr && rproc->cached_table &&
+	    rproc->table_ptr != rproc->cached_table)
+		memcpy(rproc->table_ptr, rproc->cached_table, rproc->table_sz);
+
+	pr_info("Reloaded data segments of %s on rCPU %s\n", rproc->firmware,
+		rcpu->name);
+
+unlock:
+	mutex_unlock(&rcpu_fw_cache_lock);
 	return err;
 }
 
+/**
+ * switch_rcpu_image - Replace the image of a halted rCPU with its staged one.
+ * @rcpu: Pointer to the rcpu_info structure representing the halted rCPU.
+ *
+ * The staged segments are copied as they are, the ELF image is not walked
+ * again. The resource table of the previous image stays in use, so the
+ * staged image must not need different remoteproc resources.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+static int switch_rcpu_image(struct rcpu_info *rcpu)
+{
+	struct rcpu_stage *stage = rcpu->staged;
+	struct rproc *rproc = rcpu->rproc;
+	const char *firmware;
+	bool is_iomem;
+	unsigned int n;
+	void *ptr;
+
+	/* Nothing is overwritten unless all segments can be placed */
+	for (n = 0; n < stage->num_segments; n++)
+		if (!rproc_da_to_va(rproc, stage->seg[n].da,
+				    stage->seg[n].size, &is_iomem))
+			return -EINVAL;
+
+	firmware = kstrdup_const(stage->name, GFP_KERNEL);
+	if (!firmware)
+		return -ENOMEM;
+
+	for (n = 0; n < stage->num_segments; n++) {
+		ptr = rproc_da_to_va(rproc, stage->seg[n].da,
+				     stage->seg[n].size, &is_iomem);
+		if (is_iomem)
+			memcpy_toio((void __iomem *)ptr,
+				    stage->data + stage->seg[n].offset,
+				    stage->seg[n].size);
+		else
+			memcpy(ptr, stage->data + stage->seg[n].offset,
+			       stage->seg[n].size);
+	}
+
+	/* Later restarts with data reload refer to the new image */
+	mutex_lock(&rproc->lock);
+	kfree_const(rproc->firmware);
+	rproc->firmware = firmware;
+	mutex_unlock(&rproc->lock);
+
+	pr_info("Switched rCPU %s to %s\n", rcpu->name, stage->name);
+	rcpu_stage_free(rcpu);
+	return 0;
+}
+
+/**
+ * jailhouse_restart_rcpus - Warm restart of the rCPUs of a running cell.
+ * @cell: Pointer to the cell structure containing the rCPUs.
+ * @flags: JAILHOUSE_CELL_RESTART_* flags.
+ *
+ * The rCPUs are powered down and woken up again through the platform
+ * firmware, bypassing the remoteproc teardown and the cell re-creation. The
+ * hypervisor keeps the memory protection of the cell and the image stays
+ * loaded, unless JAILHOUSE_CELL_RESTART_SWITCH_IMAGE replaces it with the
+ * staged one. With JAILHOUSE_CELL_RESTART_RELOAD_DATA, the writable segments
+ * of the images that are not switched are restored. If an image cannot be
+ * switched or reloaded, the rCPUs stay halted and the cell is reported as
+ * failed.
+ *
+ * Return: 0 on success, or a negative error code on failure.
+ */
+int jailhouse_restart_rcpus(struct cell *cell, u32 flags)
+{
+	bool reload = flags & (JAILHOUSE_CELL_RESTART_RELOAD_DATA |
+			       JAILHOUSE_CELL_RESTART_SWITCH_IMAGE);
+	unsigned int rcpu_id, failed_rcpu = 0;
+	bool staged = false, halted = true;
+	unsigned long end = JAILHOUSE_RCPU_RESTART_END;
+	struct rcpu_info *rcpu;
+	int err, ret;
+
+	if (flags & JAILHOUSE_CELL_RESTART_SWITCH_IMAGE) {
+		for_each_rcpu(rcpu_id, &cell->rcpus_assigned)
+			if (get_rcpu_info(cell, rcpu_id)->staged)
+				staged = true;
+		if (!staged) {
+			pr_err("No image staged for cell %d\n", cell->id);
+			return -ENOENT;
+		}
+	}
+
+	err = jailhouse_call_arg2(JAILHOUSE_HC_CELL_RCPU_RESTART, cell->id,
+				  reload ?
+				  JAILHOUSE_RCPU_RESTART_BEGIN_RELOAD :
+				  JAILHOUSE_RCPU_RESTART_BEGIN);
+	if (err)
+		return err;
+
+	for_each_rcpu(rcpu_id, &cell->rcpus_assigned) {
+		err = halt_rcpu_state(get_rcpu_info(cell, rcpu_id));
+		if (err < 0) {
+			halted = false;
+			failed_rcpu = rcpu_id;
+			goto end_restart;
+		}
+	}
+
+	if (reload) {
+		for_each_rcpu(rcpu_id, &cell->rcpus_assigned) {
+			rcpu = get_rcpu_info(cell, rcpu_id);
+			if ((flags & JAILHOUSE_CELL_RESTART_SWITCH_IMAGE) &&
+			    rcpu->staged)
+				err = switch_rcpu_image(rcpu);
+			else if (flags & JAILHOUSE_CELL_RESTART_RELOAD_DATA)
+				err = reload_rcpu_data(rcpu);
+			if (err < 0) {
+				/*
+				 * The images may be half rewritten, none of
+				 * the halted cores can be resumed safely.
+				 */
+				pr_err("Failed to reload rCPU %s, cell %d failed\n",
+				       rcpu->name, cell->id);
+				end = JAILHOUSE_RCPU_RESTART_END_FAILED;
+				goto end_restart;
+			}
+		}
+	}
+
+end_restart:
+	/* Withdraw the loadable regions before any rCPU runs again */
+	ret = jailhouse_call_arg2(JAILHOUSE_HC_CELL_RCPU_RESTART, cell->id,
+				  end);
+	if (!halted) {
+		/* Resume the cores halted before the failure, images intact */
+		for_each_rcpu(rcpu_id, &cell->rcpus_assigned) {
+			if (rcpu_id == failed_rcpu)
+				break;
+			if (start_rcpu_state(get_rcpu_info(cell, rcpu_id)) < 0)
+				pr_err("rCPU %d stays halted\n", rcpu_id);
+		}
+	}
+	if (err)
+		return err;
+	if (ret)
+		return ret;
+
+	return jailhouse_start_rcpu(cell);
+}
+
 /**
  * jailhouse_root_rcpus_remove - Release and deallocate the rproc instances for ASIC rCPUs.
  *
@@ -774,6 +1626,9 @@ int jailhouse_root_rcpus_remove()
 	vfree(root_rcpus_info);
 	root_rcpus_info = NULL;
 
+	/* Drop the pinned images */
+	rcpu_fw_cache_invalidate(NULL);
+
 out:
 	return err;
 }
@@ -884,6 +1739,9 @@ int jailhouse_rcpus_remove(struct cell *cell) {
 	for_each_rcpu(rcpu_id, &cell->rcpus_assigned) {
 		pr_info("Removing rcpus %d from cell %d\n", rcpu_id, cell->id);
 
+		/* A staged image does not survive its cell */
+		rcpu_stage_free(get_rcpu_info(cell, rcpu_id));
+
 		/* Distinguish between ASIC rcpus and soft-core rcpus */
 		if (rcpu_id < num_root_rcpus) {
 			err = asic_rcpu_remove(rcpu_id);
@@ -22,22 +22,32 @@
 #define for_each_rcpu(rcpu, set) \
 	for_each_cpu(rcpu, set)
 
+struct rcpu_stage;
+
 struct rcpu_info {
     struct rproc *rproc;
     unsigned int id;
 	char name[JAILHOUSE_RCPU_IMAGE_NAMELEN];
 	char compatible[JAILHOUSE_RCPU_IMAGE_NAMELEN];
+	/* Next image, switched to on restart */
+	struct rcpu_stage *staged;
 };
 
 #ifdef CONFIG_OMNIVISOR
 
 int jailhouse_root_rcpus_setup(struct cell *cell, const struct jailhouse_cell_desc *config);
 int jailhouse_rcpus_setup(struct cell *cell, const struct jailhouse_cell_desc *config);
-int jailhouse_load_rcpu_image(struct cell *cell, 
-                    struct jailhouse_preload_rcpu_image __user *rcpu_uimage);
+int jailhouse_load_rcpu_images(struct cell *cell,
+                    struct jailhouse_preload_rcpu_image *images,
+                    unsigned int num_images);
+int jailhouse_stage_rcpu_images(struct cell *cell,
+                    struct jailhouse_preload_rcpu_image *images,
+                    unsigned int num_images);
 int jailhouse_start_rcpu(struct cell *cell);
+int jailhouse_restart_rcpus(struct cell *cell, u32 flags);
 int jailhouse_root_rcpus_remove(void);
 int jailhouse_rcpus_remove(struct cell *cell);
+int jailhouse_cmd_rcpu_fw_cache(struct jailhouse_rcpu_fw_cache __user *arg);
 
 #else /* !CONFIG_OMNIVISOR */
 
@@ -56,8 +66,16 @@ static inline int jailhouse_rcpus_setup(struct cell *cell, const struct jailhous
     return -1;
 }
 
-static inline int jailhouse_load_rcpu_image(struct cell *cell, 
-                    struct jailhouse_preload_rcpu_image __user *rcpu_uimage)
+static inline int jailhouse_load_rcpu_images(struct cell *cell,
+                    struct jailhouse_preload_rcpu_image *images,
+                    unsigned int num_images)
+{
+    return -1;
+}
+
+static inline int jailhouse_stage_rcpu_images(struct cell *cell,
+                    struct jailhouse_preload_rcpu_image *images,
+                    unsigned int num_images)
 {
     return -1;
 }
@@ -67,6 +85,11 @@ static inline int jailhouse_start_rcpu(struct cell *cell)
     return -1;
 }
 
+static inline int jailhouse_restart_rcpus(struct cell *cell, u32 flags)
+{
+    return -1;
+}
+
 static inline int jailhouse_root_rcpus_remove()
 {
     return -1;
@@ -77,6 +100,11 @@ static inline int jailhouse_rcpus_remove(struct cell *cell)
     return -1;
 }
 
+static inline int jailhouse_cmd_rcpu_fw_cache(struct jailhouse_rcpu_fw_cache __user *arg)
+{
+    return -ENOSYS;
+}
+
 #endif /* CONFIG_OMNIVISOR */
 
 #endif /* !_JAILHOUSE_DRIVER_SYSFS_H */
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include <linux/gfp.h>
 #include <linux/stat.h>
 #include <linux/slab.h>
+#include <linux/timex.h>
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,11,0)
 #define DEVICE_ATTR_RO(_name) \
@@ -130,6 +131,57 @@ static ssize_t cpu_stats_show(struct kobject *kobj,
 	return sprintf(buffer, "%d\n", value);
 }
 
+static const char *const exit_kind_names[JAILHOUSE_NUM_EXIT_KINDS] = {
+	[JAILHOUSE_EXIT_MMIO] = "mmio",
+	[JAILHOUSE_EXIT_HYPERCALL] = "hypercall",
+	[JAILHOUSE_EXIT_MANAGEMENT] = "management",
+	[JAILHOUSE_EXIT_IRQ] = "irq",
+	[JAILHOUSE_EXIT_SMC] = "smc",
+	[JAILHOUSE_EXIT_SYSREG] = "sysreg",
+};
+
+static ssize_t exit_latency_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	struct cell_cpu *cell_cpu = container_of(kobj, struct cell_cpu, kobj);
+	struct jailhouse_exit_histogram *hist;
+	struct jailhouse_exit_latency *latency;
+	unsigned int kind, n;
+	ssize_t written;
+	long val;
+
+	latency = kzalloc(sizeof(*latency), GFP_KERNEL);
+	if (!latency)
+		return -ENOMEM;
+
+	val = jailhouse_call_arg2(JAILHOUSE_HC_CPU_GET_EXIT_LATENCY,
+				  cell_cpu->cpu, __pa(latency));
+	if (val < 0) {
+		kfree(latency);
+		return val;
+	}
+
+	written = scnprintf(buf, PAGE_SIZE, "ticks_hz %llu\n",
+			    latency->ticks_hz);
+	for (kind = 0; kind < JAILHOUSE_NUM_EXIT_KINDS; kind++) {
+		hist = &latency->kinds[kind];
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "%s %llu", exit_kind_names[kind],
+				     hist->max);
+		for (n = 0; n < JAILHOUSE_EXIT_LATENCY_BUCKETS; n++)
+			written += scnprintf(buf + written,
+					     PAGE_SIZE - written, " %u",
+					     hist->buckets[n]);
+		written += scnprintf(buf + written, PAGE_SIZE - written, "\n");
+	}
+
+	kfree(latency);
+	return written;
+}
+
+/* Not a counter, hence not in cpu_stats_attrs, see cpu_stats_layout_show */
+static struct kobj_attribute cpu_exit_latency_attr = __ATTR_RO(exit_latency);
+
 #define JAILHOUSE_CPU_STATS_ATTR(_name, _code) \
 	static struct jailhouse_cpu_stats_attr _name##_cell_attr = { \
 		.kattr = __ATTR(_name, S_IRUGO, cell_stats_show, NULL), \
@@ -146,6 +198,9 @@ JAILHOUSE_CPU_STATS_ATTR(vmexits_management,
 			 JAILHOUSE_CPU_STAT_VMEXITS_MANAGEMENT);
 JAILHOUSE_CPU_STATS_ATTR(vmexits_hypercall,
 			 JAILHOUSE_CPU_STAT_VMEXITS_HYPERCALL);
+JAILHOUSE_CPU_STATS_ATTR(mmio_cache_hits, JAILHOUSE_CPU_STAT_MMIO_CACHE_HITS);
+JAILHOUSE_CPU_STATS_ATTR(mmio_cache_misses,
+			 JAILHOUSE_CPU_STAT_MMIO_CACHE_MISSES);
 #ifdef CONFIG_X86
 JAILHOUSE_CPU_STATS_ATTR(vmexits_pio, JAILHOUSE_CPU_STAT_VMEXITS_PIO);
 JAILHOUSE_CPU_STATS_ATTR(vmexits_xapic, JAILHOUSE_CPU_STAT_VMEXITS_XAPIC);
@@ -165,8 +220,15 @@ JAILHOUSE_CPU_STATS_ATTR(vmexits_virt_irq, JAILHOUSE_CPU_STAT_VMEXITS_VIRQ);
 JAILHOUSE_CPU_STATS_ATTR(vmexits_virt_sgi, JAILHOUSE_CPU_STAT_VMEXITS_VSGI);
 JAILHOUSE_CPU_STATS_ATTR(vmexits_psci, JAILHOUSE_CPU_STAT_VMEXITS_PSCI);
 JAILHOUSE_CPU_STATS_ATTR(vmexits_smccc, JAILHOUSE_CPU_STAT_VMEXITS_SMCCC);
+JAILHOUSE_CPU_STATS_ATTR(tlbi_ranges, JAILHOUSE_CPU_STAT_TLBI_RANGES);
+JAILHOUSE_CPU_STATS_ATTR(tlbi_vmid, JAILHOUSE_CPU_STAT_TLBI_VMID);
 #ifdef CONFIG_ARM
 JAILHOUSE_CPU_STATS_ATTR(vmexits_cp15, JAILHOUSE_CPU_STAT_VMEXITS_CP15);
+#else
+JAILHOUSE_CPU_STATS_ATTR(smc_passthrough, JAILHOUSE_CPU_STAT_SMC_PASSTHROUGH);
+JAILHOUSE_CPU_STATS_ATTR(smc_intercepted, JAILHOUSE_CPU_STAT_SMC_INTERCEPTED);
+JAILHOUSE_CPU_STATS_ATTR(smc_denied, JAILHOUSE_CPU_STAT_SMC_DENIED);
+JAILHOUSE_CPU_STATS_ATTR(smc_sip_time_us, JAILHOUSE_CPU_STAT_SMC_SIP_TIME_US);
 #endif
 #endif
 
@@ -175,6 +237,8 @@ static struct attribute *cell_stats_attrs[] = {
 	&vmexits_mmio_cell_attr.kattr.attr,
 	&vmexits_management_cell_attr.kattr.attr,
 	&vmexits_hypercall_cell_attr.kattr.attr,
+	&mmio_cache_hits_cell_attr.kattr.attr,
+	&mmio_cache_misses_cell_attr.kattr.attr,
 #ifdef CONFIG_X86
 	&vmexits_pio_cell_attr.kattr.attr,
 	&vmexits_xapic_cell_attr.kattr.attr,
@@ -190,8 +254,15 @@ static struct attribute *cell_stats_attrs[] = {
 	&vmexits_virt_sgi_cell_attr.kattr.attr,
 	&vmexits_psci_cell_attr.kattr.attr,
 	&vmexits_smccc_cell_attr.kattr.attr,
+	&tlbi_ranges_cell_attr.kattr.attr,
+	&tlbi_vmid_cell_attr.kattr.attr,
 #ifdef CONFIG_ARM
 	&vmexits_cp15_cell_attr.kattr.attr,
+#else
+	&smc_passthrough_cell_attr.kattr.attr,
+	&smc_intercepted_cell_attr.kattr.attr,
+	&smc_denied_cell_attr.kattr.attr,
+	&smc_sip_time_us_cell_attr.kattr.attr,
 #endif
 #endif
 	NULL
@@ -208,6 +279,8 @@ static struct attribute *cpu_stats_attrs[] = {
 	&vmexits_mmio_cpu_attr.kattr.attr,
 	&vmexits_management_cpu_attr.kattr.attr,
 	&vmexits_hypercall_cpu_attr.kattr.attr,
+	&mmio_cache_hits_cpu_attr.kattr.attr,
+	&mmio_cache_misses_cpu_attr.kattr.attr,
 #ifdef CONFIG_X86
 	&vmexits_pio_cpu_attr.kattr.attr,
 	&vmexits_xapic_cpu_attr.kattr.attr,
@@ -223,8 +296,15 @@ static struct attribute *cpu_stats_attrs[] = {
 	&vmexits_virt_sgi_cpu_attr.kattr.attr,
 	&vmexits_psci_cpu_attr.kattr.attr,
 	&vmexits_smccc_cpu_attr.kattr.attr,
+	&tlbi_ranges_cpu_attr.kattr.attr,
+	&tlbi_vmid_cpu_attr.kattr.attr,
 #ifdef CONFIG_ARM
 	&vmexits_cp15_cpu_attr.kattr.attr,
+#else
+	&smc_passthrough_cpu_attr.kattr.attr,
+	&smc_intercepted_cpu_attr.kattr.attr,
+	&smc_denied_cpu_attr.kattr.attr,
+	&smc_sip_time_us_cpu_attr.kattr.attr,
 #endif
 #endif
 	NULL
@@ -375,6 +455,289 @@ static ssize_t fpga_regions_assigned_list_show(struct kobject *kobj,
 	return print_cpumask(buf, PAGE_SIZE, &cell->fpga_regions_assigned, true);
 }
 
+static ssize_t xmpu_violations_show(struct kobject *kobj,
+				    struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+	long val;
+
+	val = jailhouse_call_arg2(JAILHOUSE_HC_XMPU_GET_FAULTS, cell->id, 0);
+	if (val < 0)
+		return val;
+
+	return sprintf(buf, "%ld\n", val);
+}
+
+static ssize_t rcpu_start_skew_ns_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+
+	return sprintf(buf, "%llu\n", cell->rcpu_start_skew_ns);
+}
+
+/* Driver and hypervisor boot stamps, in the order they are taken */
+static const struct {
+	const char *name;
+	bool hv;
+	unsigned int index;
+} boot_stamp_list[] = {
+	{ "create_ioctl", false, RCPU_STAMP_CREATE_IOCTL },
+	{ "xmpu_begin", true, JAILHOUSE_BOOT_STAMP_XMPU_BEGIN },
+	{ "xmpu_end", true, JAILHOUSE_BOOT_STAMP_XMPU_END },
+	{ "load_ioctl", false, RCPU_STAMP_LOAD_IOCTL },
+	{ "fw_load_begin", false, RCPU_STAMP_FW_LOAD_BEGIN },
+	{ "fw_load_end", false, RCPU_STAMP_FW_LOAD_END },
+	{ "start_ioctl", false, RCPU_STAMP_START_IOCTL },
+	{ "rcpu_wakeup", true, JAILHOUSE_BOOT_STAMP_RCPU_WAKEUP },
+};
+
+static ssize_t boot_stamps_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+	ssize_t written = 0;
+	unsigned int n;
+	long hv_val;
+	u64 val;
+
+	for (n = 0; n < ARRAY_SIZE(boot_stamp_list); n++) {
+		if (boot_stamp_list[n].hv) {
+			hv_val = jailhouse_call_arg2(
+					JAILHOUSE_HC_CELL_GET_BOOT_STAMP,
+					cell->id, boot_stamp_list[n].index);
+			/* 0 if not supported by this hypervisor build */
+			val = hv_val < 0 ? 0 : hv_val;
+		} else {
+			val = cell->boot_stamps[boot_stamp_list[n].index];
+		}
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "%s %llu\n", boot_stamp_list[n].name, val);
+	}
+
+	return written;
+}
+
+static const char * const fpga_phase_names[NUM_FPGA_PHASES] = {
+	[FPGA_PHASE_DECOUPLE] = "decouple",
+	[FPGA_PHASE_BITSTREAM] = "bitstream",
+	[FPGA_PHASE_COUPLE] = "couple",
+	[FPGA_PHASE_OVERLAY] = "overlay",
+	[FPGA_PHASE_TOTAL] = "total",
+};
+
+static ssize_t fpga_setup_ns_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+	ssize_t written = 0;
+	unsigned int n;
+
+	for (n = 0; n < NUM_FPGA_PHASES; n++)
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "%s %llu\n", fpga_phase_names[n],
+				     cell->fpga_setup_ns[n]);
+
+	return written;
+}
+
+/* Torn copies of the rCPU telemetry page tolerated before giving up */
+#define RCPU_TELEMETRY_READ_TRIES	16
+
+/*
+ * Snapshot of the telemetry page of an rCPU cell. The page is written by the
+ * firmware without any handshake, a copy is only valid if the sequence count
+ * was even and did not change while copying.
+ */
+static int read_rcpu_telemetry(const struct rcpu_telemetry *page,
+			       struct rcpu_telemetry *snap)
+{
+	unsigned int seq, n;
+
+	for (n = 0; n < RCPU_TELEMETRY_READ_TRIES; n++) {
+		seq = READ_ONCE(page->seq);
+		if (seq & 1) {
+			cpu_relax();
+			continue;
+		}
+		smp_rmb();
+		memcpy(snap, page, sizeof(*snap));
+		smp_rmb();
+		if (READ_ONCE(page->seq) == seq)
+			return 0;
+	}
+
+	return -EBUSY;
+}
+
+static ssize_t rcpu_telemetry_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+	const struct rcpu_telemetry_task *task;
+	struct rcpu_telemetry *snap;
+	ssize_t written = 0;
+	const char *state;
+	u64 now, age;
+	unsigned int n;
+	int err;
+
+	if (!cell->rcpu_telemetry)
+		return -ENODATA;
+
+	snap = kmalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	now = get_cycles();
+	err = read_rcpu_telemetry(cell->rcpu_telemetry, snap);
+	if (err) {
+		kfree(snap);
+		return err;
+	}
+
+	if (snap->magic != RCPU_TELEMETRY_MAGIC ||
+	    snap->version != RCPU_TELEMETRY_VERSION) {
+		kfree(snap);
+		return sprintf(buf, "state offline\n");
+	}
+
+	age = now > snap->heartbeat_stamp ? now - snap->heartbeat_stamp : 0;
+	if (snap->heartbeat == 0)
+		state = "booting";
+	else if (snap->heartbeat_period &&
+		 age > RCPU_TELEMETRY_STALL_PERIODS * snap->heartbeat_period)
+		state = "stalled";
+	else
+		state = "alive";
+
+	written += scnprintf(buf + written, PAGE_SIZE - written,
+			     "state %s\nheartbeat %llu\nheartbeat_age %llu\n"
+			     "busy %llu\ntotal %llu\n", state, snap->heartbeat,
+			     age, snap->busy, snap->total);
+
+	for (n = 0; n < min_t(unsigned int, snap->num_tasks,
+			      RCPU_TELEMETRY_MAX_TASKS); n++) {
+		task = &snap->task[n];
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "task %.*s %llu %llu %u\n",
+				     RCPU_TELEMETRY_TASK_NAMELEN, task->name,
+				     task->runs, task->wcet, task->stack_free);
+	}
+
+	kfree(snap);
+	return written;
+}
+
+static const char *const rcpu_trace_events[] = {
+	[RCPU_TELEMETRY_TRACE_SWITCH] = "switch",
+	[RCPU_TELEMETRY_TRACE_SLEEP] = "sleep",
+	[RCPU_TELEMETRY_TRACE_WAKE] = "wake",
+};
+
+/*
+ * Scheduler events of the rCPU firmware, oldest first. The ring is not
+ * covered by the sequence count: only the entries that cannot have been
+ * overwritten while copying the page are shown.
+ */
+static ssize_t rcpu_trace_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+	const struct rcpu_telemetry_trace *entry;
+	struct rcpu_telemetry *snap;
+	unsigned int head, tail, idx;
+	ssize_t written = 0;
+	const char *event;
+	int err;
+
+	if (!cell->rcpu_telemetry)
+		return -ENODATA;
+
+	snap = kmalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	head = READ_ONCE(cell->rcpu_telemetry->trace_head);
+	smp_rmb();
+	err = read_rcpu_telemetry(cell->rcpu_telemetry, snap);
+	smp_rmb();
+	tail = READ_ONCE(cell->rcpu_telemetry->trace_head) -
+		RCPU_TELEMETRY_TRACE_ENTRIES + 1;
+	if (err)
+		goto out;
+
+	if (snap->magic != RCPU_TELEMETRY_MAGIC ||
+	    snap->version != RCPU_TELEMETRY_VERSION ||
+	    !(snap->flags & RCPU_TELEMETRY_FLAG_TRACE))
+		goto out;
+
+	for (idx = tail; (int)(head - idx) > 0; idx++) {
+		entry = &snap->trace[idx & (RCPU_TELEMETRY_TRACE_ENTRIES - 1)];
+		/* Entries never written yet */
+		if (entry->stamp == 0)
+			continue;
+
+		event = entry->event < ARRAY_SIZE(rcpu_trace_events) ?
+			rcpu_trace_events[entry->event] : "unknown";
+		if (entry->task < min_t(unsigned int, snap->num_tasks,
+					RCPU_TELEMETRY_MAX_TASKS))
+			written += scnprintf(buf + written,
+					     PAGE_SIZE - written,
+					     "%llu %s %.*s\n", entry->stamp,
+					     event,
+					     RCPU_TELEMETRY_TASK_NAMELEN,
+					     snap->task[entry->task].name);
+		else
+			written += scnprintf(buf + written,
+					     PAGE_SIZE - written,
+					     "%llu %s\n", entry->stamp, event);
+	}
+
+out:
+	kfree(snap);
+	return err ? err : written;
+}
+
+static ssize_t mmio_stats_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct cell *cell = container_of(kobj, struct cell, kobj);
+	struct jailhouse_mmio_region_stats *region;
+	struct jailhouse_mmio_stats *stats;
+	ssize_t written = 0;
+	unsigned int n;
+	long val;
+
+	stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return -ENOMEM;
+
+	/* -ENOSYS if the hypervisor is built without CONFIG_MMIO_STATS */
+	val = jailhouse_call_arg2(JAILHOUSE_HC_CELL_GET_MMIO_STATS, cell->id,
+				  __pa(stats));
+	if (val < 0) {
+		kfree(stats);
+		return val;
+	}
+
+	for (n = 0; n < min_t(unsigned int, stats->num_regions,
+			      JAILHOUSE_MMIO_STATS_MAX_REGIONS); n++) {
+		region = &stats->regions[n];
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "0x%010llx 0x%llx %llu %llu %llu\n",
+				     region->start, region->size,
+				     region->reads, region->writes,
+				     region->ticks);
+	}
+	if (val > stats->num_regions)
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "(%ld more regions not shown)\n",
+				     val - stats->num_regions);
+
+	kfree(stats);
+	return written;
+}
 
 static struct kobj_attribute cell_name_attr = __ATTR_RO(name);
 static struct kobj_attribute cell_state_attr = __ATTR_RO(state);
@@ -393,6 +756,16 @@ static struct kobj_attribute cell_fpga_regions_assigned_attr =
 	__ATTR_RO(fpga_regions_assigned);
 static struct kobj_attribute cell_fpga_regions_assigned_list_attr =
 	__ATTR_RO(fpga_regions_assigned_list);
+static struct kobj_attribute cell_xmpu_violations_attr =
+	__ATTR_RO(xmpu_violations);
+static struct kobj_attribute cell_rcpu_start_skew_ns_attr =
+	__ATTR_RO(rcpu_start_skew_ns);
+static struct kobj_attribute cell_boot_stamps_attr = __ATTR_RO(boot_stamps);
+static struct kobj_attribute cell_fpga_setup_ns_attr = __ATTR_RO(fpga_setup_ns);
+static struct kobj_attribute cell_rcpu_telemetry_attr =
+	__ATTR_RO(rcpu_telemetry);
+static struct kobj_attribute cell_rcpu_trace_attr = __ATTR_RO(rcpu_trace);
+static struct kobj_attribute cell_mmio_stats_attr = __ATTR_RO(mmio_stats);
 
 static struct attribute *cell_attrs[] = {
 	&cell_name_attr.attr,
@@ -405,6 +778,13 @@ static struct attribute *cell_attrs[] = {
 	&cell_rcpus_assigned_list_attr.attr,
 	&cell_fpga_regions_assigned_attr.attr,
 	&cell_fpga_regions_assigned_list_attr.attr,
+	&cell_xmpu_violations_attr.attr,
+	&cell_rcpu_start_skew_ns_attr.attr,
+	&cell_boot_stamps_attr.attr,
+	&cell_fpga_setup_ns_attr.attr,
+	&cell_rcpu_telemetry_attr.attr,
+	&cell_rcpu_trace_attr.attr,
+	&cell_mmio_stats_attr.attr,
 	NULL,
 };
 COMPAT_ATTRIBUTE_GROUPS(cell);
@@ -470,6 +850,13 @@ int jailhouse_sysfs_cell_create(struct cell *cell)
 				return err;
 			}
 			list_add_tail(&cell_cpu->entry, &cell->cell_cpus);
+
+			err = sysfs_create_file(&cell_cpu->kobj,
+						&cpu_exit_latency_attr.attr);
+			if (err) {
+				jailhouse_sysfs_cell_delete(cell);
+				return err;
+			}
 		} else {
 			cell_cpu = find_cell_cpu(root_cell, cpu);
 			if (cell_cpu == NULL)
@@ -590,6 +977,72 @@ static ssize_t remap_pool_used_show(struct device *dev,
 	return info_show(dev, buffer, JAILHOUSE_INFO_REMAP_POOL_USED);
 }
 
+static ssize_t xmpu_faults_show(struct device *dev,
+				struct device_attribute *attr, char *buffer)
+{
+	struct jailhouse_xmpu_fault_log *log;
+	struct jailhouse_xmpu_fault *fault;
+	unsigned int n, first;
+	ssize_t result = 0;
+	long val = -EINVAL;
+
+	log = kzalloc(sizeof(*log), GFP_KERNEL);
+	if (!log)
+		return -ENOMEM;
+
+	if (mutex_lock_interruptible(&jailhouse_lock) != 0) {
+		kfree(log);
+		return -EINTR;
+	}
+
+	if (jailhouse_enabled)
+		/* any valid cell ID will do, the root cell always exists */
+		val = jailhouse_call_arg2(JAILHOUSE_HC_XMPU_GET_FAULTS,
+					  root_cell->id, __pa(log));
+
+	mutex_unlock(&jailhouse_lock);
+
+	if (val < 0) {
+		kfree(log);
+		return val;
+	}
+
+	first = log->count > JAILHOUSE_XMPU_FAULT_LOG_SIZE ?
+		log->count - JAILHOUSE_XMPU_FAULT_LOG_SIZE : 0;
+	for (n = first; n < log->count; n++) {
+		fault = &log->entries[n % JAILHOUSE_XMPU_FAULT_LOG_SIZE];
+		result += scnprintf(buffer + result, PAGE_SIZE - result,
+				    "%u cell %d master 0x%04x channel %u "
+				    "addr 0x%010llx type 0x%x\n",
+				    n, fault->cell_id, fault->master_id,
+				    fault->channel, fault->addr, fault->type);
+	}
+
+	kfree(log);
+	return result;
+}
+
+/* Index of each counter in the statistics pages mapped via /dev/jailhouse */
+static ssize_t cpu_stats_layout_show(struct device *dev,
+				     struct device_attribute *attr,
+				     char *buffer)
+{
+	struct jailhouse_cpu_stats_attr *stats_attr;
+	struct attribute **entry;
+	ssize_t result = 0;
+
+	for (entry = cpu_stats_attrs; *entry; entry++) {
+		stats_attr = container_of(*entry,
+					  struct jailhouse_cpu_stats_attr,
+					  kattr.attr);
+		result += scnprintf(buffer + result, PAGE_SIZE - result,
+				    "%u %s\n", stats_attr->code,
+				    (*entry)->name);
+	}
+
+	return result;
+}
+
 static ssize_t core_show(struct file *filp, struct kobject *kobj,
 			 struct bin_attribute *attr, char *buf, loff_t off,
 			 size_t count)
@@ -604,6 +1057,8 @@ static DEVICE_ATTR_RO(mem_pool_size);
 static DEVICE_ATTR_RO(mem_pool_used);
 static DEVICE_ATTR_RO(remap_pool_size);
 static DEVICE_ATTR_RO(remap_pool_used);
+static DEVICE_ATTR_RO(xmpu_faults);
+static DEVICE_ATTR_RO(cpu_stats_layout);
 
 static struct attribute *jailhouse_sysfs_entries[] = {
 	&dev_attr_console.attr,
@@ -612,6 +1067,8 @@ static struct attribute *jailhouse_sysfs_entries[] = {
 	&dev_attr_mem_pool_used.attr,
 	&dev_attr_remap_pool_size.attr,
 	&dev_attr_remap_pool_used.attr,
+	&dev_attr_xmpu_faults.attr,
+	&dev_attr_cpu_stats_layout.attr,
 	NULL
 };
 
@@ -22,8 +22,12 @@
 #include <asm/smc.h>
 #include <asm/smccc.h>
 #include <asm/memguard.h>
+#include <asm/omnv.h>
 #include <asm/timer.h>
 #include <asm/pmu.h>
+#if defined(CONFIG_XMPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+#include <asm/xmpu.h>
+#endif
 
 static void enter_cpu_off(struct public_per_cpu *cpu_public)
 {
@@ -111,6 +115,7 @@ static void check_events(struct public_per_cpu *cpu_public)
 	if (cpu_public->flush_vcpu_caches) {
 		cpu_public->flush_vcpu_caches = false;
 		arm_paging_vcpu_flush_tlbs();
+		cpu_public->stats[JAILHOUSE_CPU_STAT_TLBI_VMID]++;
 	}
 
 	spin_unlock(&cpu_public->control_lock);
@@ -171,6 +176,12 @@ bool arch_handle_phys_irq(u32 irqn, unsigned int count_event)
 		return pmu_isr_handler();
 	}
 
+#if defined(CONFIG_XMPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+	if (irq_is_xmpu(irqn)) {
+		return xmpu_isr_handler();
+	}
+#endif
+
 	cpu_public->stats[JAILHOUSE_CPU_STAT_VMEXITS_VIRQ] += count_event;
 	irqchip_set_pending(cpu_public, irqn);
 
@@ -227,10 +238,15 @@ void arch_flush_cell_vcpu_caches(struct cell *cell)
 {
 	unsigned int cpu;
 
+	/* Few changed ranges are invalidated by IPA, on all CPUs from here. */
+	if (arm_paging_flush_cell_ranges(cell))
+		return;
+
 	for_each_cpu(cpu, cell->cpu_set)
-		if (cpu == this_cpu_id())
+		if (cpu == this_cpu_id()) {
 			arm_paging_vcpu_flush_tlbs();
-		else
+			this_cpu_public()->stats[JAILHOUSE_CPU_STAT_TLBI_VMID]++;
+		} else
 			public_per_cpu(cpu)->flush_vcpu_caches = true;
 }
 
@@ -238,6 +254,7 @@ void arch_config_commit(struct cell *cell_added_removed)
 {
 	irqchip_config_commit(cell_added_removed);
 	iommu_config_commit(cell_added_removed);
+	omnv_config_commit();
 }
 
 void __attribute__((noreturn)) arch_panic_stop(void)
@@ -14,9 +14,18 @@
 #define _JAILHOUSE_ASM_CELL_H
 
 #include <jailhouse/paging.h>
+#include <jailhouse/hypercall.h>
+
+/* Changed stage-2 ranges tracked per cell before flushing all its TLBs */
+#define ARM_TLB_RANGES		8
 
 struct pvu_tlb_entry;
 
+struct arm_tlb_range {
+	unsigned long start;
+	unsigned long size;
+};
+
 struct arch_cell {
 	struct paging_structures mm;
 
@@ -26,6 +35,22 @@ struct arch_cell {
 		u8 ent_count;
 		struct pvu_tlb_entry *entries;
 	} iommu_pvu; /**< ARM PVU specific fields. */
+
+	/** Number of XMPU violations caused by the masters of the cell. */
+	u32 xmpu_violations;
+
+	/** Boot time stamps of the rCPUs of the cell (JAILHOUSE_BOOT_STAMP_*). */
+	u64 boot_stamps[JAILHOUSE_NUM_BOOT_STAMPS];
+
+	/** rCPUs whose PM SMCs the cell passes through, see omnv.c. */
+	unsigned long smc_rcpus;
+
+	/**
+	 * Stage-2 ranges changed since the last TLB flush of the cell. More
+	 * than ARM_TLB_RANGES means that all its TLB entries have to go.
+	 */
+	struct arm_tlb_range tlb_ranges[ARM_TLB_RANGES];
+	unsigned int num_tlb_ranges;
 };
 
 #endif /* !_JAILHOUSE_ASM_CELL_H */
@@ -13,21 +13,47 @@
 #include <jailhouse/config.h>
 #include <asm/traps.h>
 
+struct per_cpu;
+
 
 #if defined(__aarch64__) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
 #define SMC_FID_MASK        	0xff
 #define PM_POWERDOWN_RCPU   	0x08
 #define PM_WAKEUP_RCPU      	0x0a
 
+/* PM API calls whose first argument is a PM node */
+static const unsigned int pm_node_fids[] = {
+	0x03, // PM_GET_NODE_STATUS
+	0x04, // PM_GET_OP_CHARACTERISTIC
+	0x05, // PM_REGISTER_NOTIFIER
+	0x06, // PM_REQUEST_SUSPEND
+	0x07, // PM_SELF_SUSPEND
+	PM_POWERDOWN_RCPU, // PM_FORCE_POWERDOWN
+	0x09, // PM_ABORT_SUSPEND
+	PM_WAKEUP_RCPU, // PM_REQUEST_WAKEUP
+	0x0b, // PM_SET_WAKEUP_SOURCE
+	0x0d, // PM_REQUEST_NODE
+	0x0e, // PM_RELEASE_NODE
+	0x0f, // PM_SET_REQUIREMENT
+	0x10, // PM_SET_MAX_LATENCY
+	0x22, // PM_IOCTL
+	-1, // Sentinel
+};
+
+/* IPI channel 0 (APU), used to ring the doorbell of the hard rCPUs */
+#define IPI_APU_BASE		0xFF300000
+#define IPI_TRIG		0x00
+
 struct rcpu_map {
 	unsigned int smc_val;
 	unsigned int rcpu_id;
+	unsigned int ipi_mask;
 };
 
 static const struct rcpu_map rcpu_table[] = {
-	{ 7, 0 },
-	{ 8, 1 },
-	{ 0, -1 }, // Sentinel
+	{ 7, 0, 0x100 }, // IPI channel 1 (RPU0)
+	{ 8, 1, 0x200 }, // IPI channel 2 (RPU1)
+	{ 0, -1, 0 }, // Sentinel
 };
 
 #else
@@ -35,19 +61,32 @@ static const struct rcpu_map rcpu_table[] = {
 #define PM_WAKEUP_RCPU      	0xff
 #define PM_POWERDOWN_RCPU   	0xff
 
+static const unsigned int pm_node_fids[] = {
+	-1, // Only sentinel
+};
+
+#define IPI_APU_BASE		0
+#define IPI_TRIG		0x00
+
 struct rcpu_map {
 	unsigned int smc_val;
 	unsigned int rcpu_id;
+	unsigned int ipi_mask;
 };
 
 static const struct rcpu_map rcpu_table[] = {
-	{ 0, -1 }, // Only sentinel
+	{ 0, -1, 0 }, // Only sentinel
 };
 
 #endif
 
 
+void omnv_init(void);
+void omnv_config_commit(void);
 void enable_rcpu_start(unsigned int rcpu);
 void disable_rcpu_start(unsigned int rcpu);
 void enable_rcpu_load(void);
-int omnv_intercept_smc(struct trap_context *ctx);
\ No newline at end of file
+int omnv_intercept_smc(struct trap_context *ctx);
+long omnv_get_boot_stamp(struct per_cpu *cpu_data, unsigned long id,
+			 unsigned long stamp);
+long omnv_rcpu_doorbell(struct per_cpu *cpu_data, unsigned long rcpu);
\ No newline at end of file
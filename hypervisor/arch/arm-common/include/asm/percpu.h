@@ -17,7 +17,9 @@
 
 #define ARM_PERCPU_FIELDS						\
 	int smccc_feat_workaround_1;					\
-	int smccc_feat_workaround_2;
+	int smccc_feat_workaround_2;					\
+	/** SIP SMC handling time below 1 us not yet accounted. */	\
+	u64 smc_sip_ticks;
 
 #define ARCH_PUBLIC_PERCPU_FIELDS					\
 	unsigned long mpidr;						\
@@ -0,0 +1,40 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor: time stamps of the statistics and the event trace
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef _JAILHOUSE_ASM_TICKS_H
+#define _JAILHOUSE_ASM_TICKS_H
+
+#include <jailhouse/types.h>
+#include <asm/processor.h>
+#include <asm/sysregs.h>
+
+/** Ticks of the global system counter. */
+static inline u64 arch_get_ticks(void)
+{
+	u64 ticks;
+
+	isb();
+	arm_read_sysreg(CNTPCT_EL0, ticks);
+	return ticks;
+}
+
+static inline u64 arch_get_ticks_hz(void)
+{
+	unsigned long freq;
+
+	arm_read_sysreg(CNTFRQ_EL0, freq);
+	return freq;
+}
+
+#endif /* !_JAILHOUSE_ASM_TICKS_H */
@@ -14,10 +14,12 @@
 
 #include <jailhouse/control.h>
 #include <jailhouse/entry.h>
+#include <jailhouse/latency.h>
 #include <jailhouse/mmio.h>
 #include <jailhouse/paging.h>
 #include <jailhouse/printk.h>
 #include <jailhouse/string.h>
+#include <jailhouse/trace.h>
 #include <jailhouse/unit.h>
 #include <jailhouse/assert.h>
 #include <asm/control.h>
@@ -191,6 +193,8 @@ static enum mmio_result gic_handle_dist_access(void *arg,
 
 void irqchip_handle_irq(void)
 {
+	unsigned int kind = JAILHOUSE_EXIT_IRQ;
+	u64 start = exit_latency_start();
 	unsigned int count_event = 1;
 	bool handled = false;
 	u32 irq_id;
@@ -202,8 +206,12 @@ void irqchip_handle_irq(void)
 		if (irq_id == 0x3ff) /* Spurious IRQ */
 			break;
 
+		trace_begin(JAILHOUSE_TRACE_IRQ, irq_id);
+
 		/* Handle IRQ */
 		if (is_sgi(irq_id)) {
+			if (irq_id == SGI_EVENT)
+				kind = JAILHOUSE_EXIT_MANAGEMENT;
 			arch_handle_sgi(irq_id, count_event);
 			handled = true;
 		} else {
@@ -220,9 +228,13 @@ void irqchip_handle_irq(void)
 		 */
 		irqchip.eoi_irq(irq_id, handled);
 
+		trace_end(JAILHOUSE_TRACE_IRQ, irq_id);
+
 		/* check possible memguard blocking */
 		memguard_cpu_block();
 	}
+
+	exit_latency_account(kind, start);
 }
 
 bool irqchip_irq_in_cell(struct cell *cell, unsigned int irq_id)
@@ -18,6 +18,29 @@
 #include <asm/iommu.h>
 #include <asm/coloring.h>
 
+/* Record a stage-2 change, to be invalidated by the next config_commit */
+static void arm_paging_track_range(struct cell *cell, unsigned long start,
+				   unsigned long size)
+{
+	struct arch_cell *arch = &cell->arch;
+
+	if (arch->num_tlb_ranges < ARM_TLB_RANGES) {
+		arch->tlb_ranges[arch->num_tlb_ranges].start = start;
+		arch->tlb_ranges[arch->num_tlb_ranges].size = size;
+	}
+	if (arch->num_tlb_ranges <= ARM_TLB_RANGES)
+		arch->num_tlb_ranges++;
+}
+
+static u64 arm_paging_vttbr(struct cell *cell,
+			    const struct paging_structures *pg_structs)
+{
+	unsigned long cell_table = paging_hvirt2phys(pg_structs->root_table);
+
+	return (u64)cell->config->id << VTTBR_VMID_SHIFT |
+		(u64)(cell_table & TTBR_MASK);
+}
+
 int arch_map_memory_region(struct cell *cell,
 			   const struct jailhouse_memory *mem)
 {
@@ -47,6 +70,8 @@ int arch_map_memory_region(struct cell *cell,
 	if (err)
 		return err;
 
+	arm_paging_track_range(cell, mem->virt_start, mem->size);
+
 	if (mem->flags & JAILHOUSE_MEM_COLORED)
 		err = color_paging_create(&cell->arch.mm, phys_start,
 				mem->size, mem->virt_start, access_flags,
@@ -54,10 +79,20 @@ int arch_map_memory_region(struct cell *cell,
 	else
 		err = paging_create(&cell->arch.mm, phys_start, mem->size,
 			    mem->virt_start, access_flags, paging_flags);
-	if (err)
+	if (err) {
 		iommu_unmap_memory_region(cell, mem);
+		return err;
+	}
 
-	return err;
+	/*
+	 * Non-root cells are not running while their regions are mapped, so
+	 * their page-wise mappings can be merged into larger TLB entries.
+	 */
+	if (cell != &root_cell && paging_flags & PAGING_HUGE)
+		arm_paging_coalesce(&cell->arch.mm, mem->virt_start, mem->size,
+				    paging_flags);
+
+	return 0;
 }
 
 int arch_unmap_memory_region(struct cell *cell,
@@ -69,6 +104,8 @@ int arch_unmap_memory_region(struct cell *cell,
 	if (err)
 		return err;
 
+	arm_paging_track_range(cell, mem->virt_start, mem->size);
+
 	if (mem->flags & JAILHOUSE_MEM_COLORED)
 		return color_paging_destroy(&cell->arch.mm,
 				mem->phys_start, mem->size, mem->virt_start,
@@ -156,15 +193,34 @@ void arm_paging_cell_destroy(struct cell *cell)
 	page_free(&mem_pool, cell->arch.mm.root_table, CELL_ROOT_PT_PAGES);
 }
 
-void arm_paging_vcpu_init(struct paging_structures *pg_structs)
+/**
+ * Invalidate the stage-2 ranges of a cell that changed since its last flush,
+ * for all CPUs at once.
+ *
+ * @param cell		Cell whose TLB entries shall be invalidated.
+ *
+ * @return True if done, false if all TLB entries of the cell have to be
+ * flushed instead.
+ */
+bool arm_paging_flush_cell_ranges(struct cell *cell)
 {
-	unsigned long cell_table = paging_hvirt2phys(pg_structs->root_table);
-	u64 vttbr = 0;
-
-	vttbr |= (u64)this_cell()->config->id << VTTBR_VMID_SHIFT;
-	vttbr |= (u64)(cell_table & TTBR_MASK);
+	unsigned int num = cell->arch.num_tlb_ranges;
+
+	cell->arch.num_tlb_ranges = 0;
+	if (num == 0)
+		return true;
+	if (num > ARM_TLB_RANGES ||
+	    !arm_paging_flush_ipa_ranges(arm_paging_vttbr(cell, &cell->arch.mm),
+					 cell->arch.tlb_ranges, num))
+		return false;
+
+	this_cpu_public()->stats[JAILHOUSE_CPU_STAT_TLBI_RANGES] += num;
+	return true;
+}
 
-	arm_write_sysreg(VTTBR_EL2, vttbr);
+void arm_paging_vcpu_init(struct paging_structures *pg_structs)
+{
+	arm_write_sysreg(VTTBR_EL2, arm_paging_vttbr(this_cell(), pg_structs));
 
 	/* Ensure that the new VMID is present before flushing the caches */
 	isb();
@@ -174,4 +230,5 @@ void arm_paging_vcpu_init(struct paging_structures *pg_structs)
 	 * means that this unconditionnal flush is redundant on master CPU.
 	 */
 	arm_paging_vcpu_flush_tlbs();
+	this_cpu_public()->stats[JAILHOUSE_CPU_STAT_TLBI_VMID]++;
 }
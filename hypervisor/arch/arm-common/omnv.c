@@ -13,12 +13,25 @@
 #include <jailhouse/control.h>
 #include <jailhouse/printk.h>
 #include <jailhouse/bitops.h>
+#include <jailhouse/mmio.h>
+#include <jailhouse/paging.h>
 #include <asm/omnv.h>
 #include <asm/bitops.h>
+#include <asm/spinlock.h>
+#include <asm/timer.h>
+
+#define OMNV_MAX_RCPUS		BITS_PER_LONG
 
 static unsigned long rcpu_start_bitmap = 0;
 static unsigned long load_phase = 0;
 
+/* Doorbell register of each rCPU, mapped on first use */
+static struct {
+	unsigned long phys;
+	void *virt;
+} doorbell_map[OMNV_MAX_RCPUS];
+static spinlock_t doorbell_lock;
+
 void enable_rcpu_start(unsigned int rcpu)
 {
 	set_bit(rcpu, &rcpu_start_bitmap);
@@ -38,13 +51,229 @@ static inline void disable_rcpu_load(void)
 	load_phase = 0;
 }
 
-static int get_rcpu_from_smc_arg(unsigned long val)
+/*
+ * Handling of SIP SMCs per function ID and rCPU per PM node, indexed with
+ * SMC_FID_MASK. Built by omnv_init() so that omnv_intercept_smc() does not
+ * need to search rcpu_table on each SMC.
+ */
+enum omnv_smc_class {
+	OMNV_SMC_PASSTHROUGH = 0,	/* not targeting a PM node */
+	OMNV_SMC_NODE,			/* first argument is a PM node */
+	OMNV_SMC_RCPU_WAKEUP,
+	OMNV_SMC_RCPU_POWERDOWN,
+};
+
+static u8 smc_fid_class[SMC_FID_MASK + 1];
+static s8 smc_node_rcpu[SMC_FID_MASK + 1];
+
+static void set_smc_fid_class(unsigned int fid, enum omnv_smc_class class)
+{
+	if (fid <= SMC_FID_MASK)
+		smc_fid_class[fid] = class;
+}
+
+/* Precomputes the rCPUs whose SMCs a cell may pass through */
+static void omnv_update_cell(struct cell *cell)
+{
+	cell->arch.smc_rcpus =
+		cell->config->rcpu_set_size > 0 ? cell->rcpu_set->bitmap[0] : 0;
+}
+
+void omnv_init(void)
+{
+	unsigned int n;
+
+	for (n = 0; n <= SMC_FID_MASK; n++)
+		smc_node_rcpu[n] = -1;
+	for (n = 0; rcpu_table[n].rcpu_id != (unsigned int)-1; n++)
+		if (rcpu_table[n].smc_val <= SMC_FID_MASK)
+			smc_node_rcpu[rcpu_table[n].smc_val] =
+				rcpu_table[n].rcpu_id;
+
+	for (n = 0; pm_node_fids[n] != (unsigned int)-1; n++)
+		set_smc_fid_class(pm_node_fids[n], OMNV_SMC_NODE);
+	set_smc_fid_class(PM_WAKEUP_RCPU, OMNV_SMC_RCPU_WAKEUP);
+	set_smc_fid_class(PM_POWERDOWN_RCPU, OMNV_SMC_RCPU_POWERDOWN);
+
+	omnv_update_cell(&root_cell);
+}
+
+/* rCPUs move between the root cell and the created/destroyed cells */
+void omnv_config_commit(void)
+{
+	struct cell *cell;
+
+	for_each_cell(cell)
+		omnv_update_cell(cell);
+}
+
+static unsigned int get_ipi_mask_from_rcpu(unsigned int rcpu)
 {
 	for (int i = 0; rcpu_table[i].rcpu_id != (unsigned int)-1; ++i) {
-		if (rcpu_table[i].smc_val == val)
-			return rcpu_table[i].rcpu_id;
+		if (rcpu_table[i].rcpu_id == rcpu)
+			return rcpu_table[i].ipi_mask;
+	}
+	return 0; // Not a hard core
+}
+
+static struct cell *get_rcpu_owner(unsigned int rcpu)
+{
+	struct cell *cell;
+
+	for_each_non_root_cell(cell)
+		if (cell->config->rcpu_set_size > 0 &&
+		    cell_owns_rcpu(cell, rcpu))
+			return cell;
+	return NULL;
+}
+
+#if defined(__aarch64__)
+static void omnv_boot_stamp(unsigned int rcpu, unsigned int stamp)
+{
+	struct cell *cell = get_rcpu_owner(rcpu);
+
+	if (cell)
+		cell->arch.boot_stamps[stamp] = timer_get_ticks();
+}
+#else
+static inline void omnv_boot_stamp(unsigned int rcpu, unsigned int stamp)
+{
+}
+#endif
+
+/**
+ * omnv_get_boot_stamp - Returns a boot time stamp of the rCPUs of a cell.
+ *
+ * @cpu_data: Per-CPU data of the calling CPU.
+ * @id: ID of the cell.
+ * @stamp: Stamp to be returned (JAILHOUSE_BOOT_STAMP_*).
+ *
+ * Return: the stamp in ticks of the system counter, 0 if not yet taken, or a
+ *         negative error code.
+ */
+long omnv_get_boot_stamp(struct per_cpu *cpu_data, unsigned long id,
+			 unsigned long stamp)
+{
+	struct cell *cell;
+
+	if (cpu_data->public.cell != &root_cell)
+		return -EPERM;
+
+	if (stamp >= JAILHOUSE_NUM_BOOT_STAMPS)
+		return -EINVAL;
+
+	for_each_cell(cell)
+		if (cell->config->id == id)
+			return cell->arch.boot_stamps[stamp];
+
+	return -ENOENT;
+}
+
+/*
+ * The caller may ring the doorbell of an rCPU only if it shares an rCPU
+ * channel region with the owner of the rCPU. The root cell sees the regions
+ * of the other cells flagged as root-shared.
+ */
+static bool rcpu_channel_shared(struct cell *cell, struct cell *owner)
+{
+	const struct jailhouse_memory *mem, *peer;
+	unsigned int n, m;
+
+	for_each_mem_region(mem, owner->config, n) {
+		if (!(mem->flags & JAILHOUSE_MEM_RCPU_CHANNEL))
+			continue;
+		if (cell == &root_cell) {
+			if (mem->flags & JAILHOUSE_MEM_ROOTSHARED)
+				return true;
+			continue;
+		}
+		for_each_mem_region(peer, cell->config, m)
+			if ((peer->flags & JAILHOUSE_MEM_RCPU_CHANNEL) &&
+			    peer->phys_start == mem->phys_start)
+				return true;
+	}
+	return false;
+}
+
+static const struct jailhouse_rcpu_device *
+get_rcpu_device(struct cell *cell, unsigned int rcpu)
+{
+	const struct jailhouse_rcpu_device *dev =
+		jailhouse_cell_rcpu_devices(cell->config);
+	unsigned int n;
+
+	for (n = 0; n < cell->config->num_rcpu_devices; n++)
+		if (dev[n].rcpu_id == rcpu)
+			return &dev[n];
+	return NULL;
+}
+
+/* Must be called with doorbell_lock held */
+static void *get_doorbell(unsigned int rcpu, unsigned long phys)
+{
+	unsigned long page = phys & PAGE_MASK;
+
+	if (doorbell_map[rcpu].virt && doorbell_map[rcpu].phys != page) {
+		paging_unmap_device(doorbell_map[rcpu].phys,
+				    doorbell_map[rcpu].virt, PAGE_SIZE);
+		doorbell_map[rcpu].virt = NULL;
+	}
+	if (!doorbell_map[rcpu].virt) {
+		doorbell_map[rcpu].virt = paging_map_device(page, PAGE_SIZE);
+		if (!doorbell_map[rcpu].virt)
+			return NULL;
+		doorbell_map[rcpu].phys = page;
+	}
+	return doorbell_map[rcpu].virt + (phys & PAGE_OFFS_MASK);
+}
+
+/**
+ * omnv_rcpu_doorbell - Rings the doorbell of an rCPU for its rCPU channel.
+ *
+ * @cpu_data: Per-CPU data of the calling CPU.
+ * @rcpu: ID of the rCPU.
+ *
+ * Hard cores are signaled through the IPI from the APU channel, soft-cores by
+ * writing the doorbell value of their rCPU device to the doorbell address.
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+long omnv_rcpu_doorbell(struct per_cpu *cpu_data, unsigned long rcpu)
+{
+	const struct jailhouse_rcpu_device *dev;
+	unsigned long phys;
+	struct cell *owner;
+	void *doorbell;
+	u32 value;
+
+	if (rcpu >= OMNV_MAX_RCPUS)
+		return -EINVAL;
+
+	owner = get_rcpu_owner(rcpu);
+	if (!owner)
+		return -ENOENT;
+
+	if (!rcpu_channel_shared(cpu_data->public.cell, owner))
+		return -EPERM;
+
+	value = get_ipi_mask_from_rcpu(rcpu);
+	if (value) {
+		phys = IPI_APU_BASE + IPI_TRIG;
+	} else {
+		dev = get_rcpu_device(owner, rcpu);
+		if (!dev || !dev->doorbell_address)
+			return -ENODEV;
+		phys = dev->doorbell_address;
+		value = dev->doorbell_value;
 	}
-	return -1; // Not found
+
+	spin_lock(&doorbell_lock);
+	doorbell = get_doorbell(rcpu, phys);
+	if (doorbell)
+		mmio_write32(doorbell, value);
+	spin_unlock(&doorbell_lock);
+
+	return doorbell ? 0 : -ENOMEM;
 }
 
 /**
@@ -57,6 +286,8 @@ static int get_rcpu_from_smc_arg(unsigned long val)
  * This function handles SMC calls related to remote CPUs (rCPUs) in the Jailhouse hypervisor.
  * It determines whether the SMC should be passed through, intercepted, or rejected based on
  * the ownership of the rCPU and the type of SMC function identifier (fid).
+ * SMCs that do not take a PM node, or whose node is not an rCPU, are passed
+ * through after two table lookups.
  *
  * Return: 
  *   -  0: Passthrough. The SMC is allowed to proceed normally.
@@ -65,61 +296,61 @@ static int get_rcpu_from_smc_arg(unsigned long val)
  */
 int omnv_intercept_smc(struct trap_context *ctx)
 {
-	struct cell *cell = this_cell();
 	unsigned long *regs = ctx->regs;
-	unsigned long fid = regs[0] & SMC_FID_MASK;
-	int rcpu = get_rcpu_from_smc_arg(regs[1] & SMC_FID_MASK);
-	int err = 0;
+	unsigned int class = smc_fid_class[regs[0] & SMC_FID_MASK];
+	struct cell *cell;
+	int rcpu;
+
+	/* The SMC fid is not targeting a PM node */
+	if (class == OMNV_SMC_PASSTHROUGH)
+		return 0;
 
-	/* The SMC fid is not targeting an rCPU */
-	if (rcpu == -1)
-		goto out;
+	/* The PM node is not an rCPU */
+	rcpu = smc_node_rcpu[regs[1] & SMC_FID_MASK];
+	if (rcpu < 0)
+		return 0;
 
 	/*
 	 * If the cell owns the rCPU, passthrough
 	 * N.B. The powerdown is done after the rCPU ownership is given to the root cell
 	 * 	    so we can safely passthrough the powerdown here.
 	 */
-	if (test_bit(rcpu, cell->rcpu_set->bitmap))
-		goto out;
-	
+	cell = this_cell();
+	if (test_bit(rcpu, &cell->arch.smc_rcpus))
+		return 0;
+
 	/* Only the root cell can handle rCPU SMCs */
-	if (this_cell() != &root_cell) {
+	if (cell != &root_cell) {
 		panic_printk("[ERROR] OMNV: Non-root_cell tried to access not owned rCPU\n");
-		err = -1;
-		goto out;
+		return -1;
 	}
 
 	/* If the rootcell does not own the rCPU, handle the PM_WAKEUP_RCPU and PM_POWERDOWN_RCPU */
-	if (fid == PM_WAKEUP_RCPU) {
+	switch (class) {
+	case OMNV_SMC_RCPU_WAKEUP:
 		if (test_bit(rcpu, &rcpu_start_bitmap)) {
 			disable_rcpu_start(rcpu);
-			goto out;
+			omnv_boot_stamp(rcpu, JAILHOUSE_BOOT_STAMP_RCPU_WAKEUP);
+			return 0;
 		}
 		/* In the load phase we need to fake the start of the rCPU
 		 * so that rproc_boot() can be called but the rCPU is not actually started.
 		 */
 		if (load_phase) {
 			disable_rcpu_load();
-			err = 1; // Intercept
-			goto out;
+			return 1; // Intercept
 		}
 		panic_printk("[ERROR] OMNV: PM_WAKEUP_RCPU invalid on rCPU %d\n", rcpu);
-		err = -1;
-		goto out;
-	}
+		return -1;
 
-	if (fid == PM_POWERDOWN_RCPU) {
+	case OMNV_SMC_RCPU_POWERDOWN:
 		/* If the Powerdown is requested before the startup (the start_bitmap is up) it is valid */
-		if (test_bit(rcpu, &rcpu_start_bitmap)) {
-			goto out;
-		}
+		if (test_bit(rcpu, &rcpu_start_bitmap))
+			return 0;
 		panic_printk("[ERROR] OMNV: PM_POWERDOWN_RCPU invalid on rCPU %d\n", rcpu);
-		err = -1;
-		goto out;
-	}
+		return -1;
 
-out:
-	return err;
+	default:
+		return 0;
+	}
 }
-
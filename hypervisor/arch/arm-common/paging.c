@@ -26,8 +26,28 @@ static unsigned long arm_get_entry_flags(pt_entry_t entry)
 	return *entry & 0xfff;
 }
 
+/*
+ * The contiguous hint must be consistent over its whole group of entries.
+ * Drop it from the group before one of them is rewritten.
+ */
+static void arm_break_contiguous(pt_entry_t pte)
+{
+	pt_entry_t group;
+	unsigned int n;
+
+	if (!(*pte & PTE_FLAG_CONTIGUOUS))
+		return;
+
+	group = (pt_entry_t)((unsigned long)pte &
+			     ~(PTE_CONT_ENTRIES * sizeof(u64) - 1));
+	for (n = 0; n < PTE_CONT_ENTRIES; n++)
+		group[n] &= ~PTE_FLAG_CONTIGUOUS;
+	arch_paging_flush_cpu_caches(group, PTE_CONT_ENTRIES * sizeof(u64));
+}
+
 static void arm_clear_entry(pt_entry_t entry)
 {
+	arm_break_contiguous(entry);
 	*entry = 0;
 }
 
@@ -64,6 +84,7 @@ static pt_entry_t arm_get_l1_entry(page_table_t page_table, unsigned long virt)
 
 static void arm_set_l1_block(pt_entry_t pte, unsigned long phys, unsigned long flags)
 {
+	arm_break_contiguous(pte);
 	*pte = ((u64)phys & PTE_L1_BLOCK_ADDR_MASK) | flags;
 }
 
@@ -99,16 +120,19 @@ static pt_entry_t arm_get_l3_entry(page_table_t page_table, unsigned long virt)
 
 static void arm_set_l2_block(pt_entry_t pte, unsigned long phys, unsigned long flags)
 {
+	arm_break_contiguous(pte);
 	*pte = ((u64)phys & PTE_L2_BLOCK_ADDR_MASK) | flags;
 }
 
 static void arm_set_l3_page(pt_entry_t pte, unsigned long phys, unsigned long flags)
 {
+	arm_break_contiguous(pte);
 	*pte = ((u64)phys & PTE_PAGE_ADDR_MASK) | flags | PTE_FLAG_TERMINAL;
 }
 
 static void arm_set_l12_table(pt_entry_t pte, unsigned long next_pt)
 {
+	arm_break_contiguous(pte);
 	*pte = ((u64)next_pt & PTE_TABLE_ADDR_MASK) | PTE_TABLE_FLAGS;
 }
 
@@ -13,6 +13,7 @@
 #include <jailhouse/control.h>
 #include <jailhouse/paging.h>
 #include <jailhouse/processor.h>
+#include <asm/omnv.h>
 #include <asm/setup.h>
 #include <asm/smccc.h>
 
@@ -34,6 +35,8 @@ int arm_init_early(void)
 	if (err)
 		return err;
 
+	omnv_init();
+
 	return arm_paging_cell_init(&root_cell);
 }
 
@@ -17,6 +17,7 @@
 #include <asm/smc.h>
 #include <asm/smccc.h>
 #include <asm/omnv.h>
+#include <asm/timer.h>
 
 bool sdei_available;
 
@@ -126,6 +127,43 @@ static enum trap_return handle_arch(struct trap_context *ctx)
 	return TRAP_HANDLED;
 }
 
+#if defined(__aarch64__) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+static void handle_omnv_sip(struct trap_context *ctx)
+{
+	struct per_cpu *cpu_data = this_cpu_data();
+	u32 *stats = cpu_data->public.stats;
+	unsigned long *regs = ctx->regs;
+	u64 start = timer_get_ticks();
+	u64 ticks_per_us;
+
+	switch (omnv_intercept_smc(ctx)) {
+	case 0:
+		stats[JAILHOUSE_CPU_STAT_SMC_PASSTHROUGH]++;
+		regs[0] = smc_arg4(regs[0], regs[1], regs[2], regs[3], regs[4]);
+		break;
+
+	case 1:
+		stats[JAILHOUSE_CPU_STAT_SMC_INTERCEPTED]++;
+		regs[0] = ARM_SMCCC_SUCCESS;
+		break;
+
+	default:
+		stats[JAILHOUSE_CPU_STAT_SMC_DENIED]++;
+		regs[0] = ARM_SMCCC_NOT_SUPPORTED;
+	}
+
+	/*
+	 * Account whole microseconds to the counter, which may be reset at any
+	 * time, and carry only the remainder over to the next call.
+	 */
+	ticks_per_us = timer_get_frequency() / 1000000;
+	cpu_data->smc_sip_ticks += timer_get_ticks() - start;
+	stats[JAILHOUSE_CPU_STAT_SMC_SIP_TIME_US] +=
+		cpu_data->smc_sip_ticks / ticks_per_us;
+	cpu_data->smc_sip_ticks %= ticks_per_us;
+}
+#endif
+
 enum trap_return handle_smc(struct trap_context *ctx)
 {
 	unsigned long *regs = ctx->regs;
@@ -142,18 +180,7 @@ enum trap_return handle_smc(struct trap_context *ctx)
 	case ARM_SMCCC_OWNER_SIP:
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_SMCCC]++;
 #if defined(__aarch64__) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
-		switch (omnv_intercept_smc(ctx)) {
-		case 0:
-			regs[0] = smc_arg4(regs[0], regs[1], regs[2], regs[3], regs[4]);
-			break;
-
-		case 1:
-			regs[0] = ARM_SMCCC_SUCCESS;
-			break;
-
-		default:
-			regs[0] = ARM_SMCCC_NOT_SUPPORTED; 
-		}
+		handle_omnv_sip(ctx);
 #else
 		if (this_cell() == &root_cell)
 			/*
@@ -13,6 +13,7 @@
 #ifndef _JAILHOUSE_ASM_PAGING_H
 #define _JAILHOUSE_ASM_PAGING_H
 
+#include <jailhouse/string.h>
 #include <jailhouse/types.h>
 #include <jailhouse/utils.h>
 #include <asm/dcaches.h>
@@ -59,8 +60,12 @@
  * An arch-specific typedef for the flags as well as the addresses would be
  * useful.
  * The contiguous bit is a hint that allows the PE to store blocks of 16 pages
- * in the TLB. This may be a useful optimisation.
+ * in the TLB. It is only set by arm64, but entries written by the common code
+ * must clear it on their neighbours.
  */
+#define PTE_FLAG_CONTIGUOUS	(0x1ULL << 52)
+#define PTE_CONT_ENTRIES	16
+
 #define PTE_ACCESS_FLAG		(0x1 << 10)
 /*
  * When combining shareability attributes, the stage-1 ones prevail. So we can
@@ -183,9 +188,28 @@ extern unsigned int cache_line_size;
 
 int arm_paging_cell_init(struct cell *cell);
 void arm_paging_cell_destroy(struct cell *cell);
+bool arm_paging_flush_cell_ranges(struct cell *cell);
+
+struct arm_tlb_range;
 
 void arm_paging_vcpu_init(struct paging_structures *pg_structs);
 
+/* No stage-2 invalidation by IPA on ARMv7, the whole VMID is flushed */
+static inline bool
+arm_paging_flush_ipa_ranges(u64 vttbr, const struct arm_tlb_range *ranges,
+			    unsigned int num)
+{
+	return false;
+}
+
+/* Stage-2 mappings are not coalesced on ARMv7 */
+static inline void
+arm_paging_coalesce(const struct paging_structures *pg_structs,
+		    unsigned long virt, unsigned long size,
+		    unsigned long paging_flags)
+{
+}
+
 void arm_dcaches_clean_by_sw(void);
 
 static inline void arm_paging_vcpu_flush_tlbs(void)
@@ -221,12 +245,38 @@ static inline void arch_paging_flush_page_tlbs(unsigned long page_addr)
 	}
 }
 
+/* Above this size, all hypervisor TLB entries are dropped instead */
+#define TLB_FLUSH_MAX_PAGES	64
+
+static inline void arch_paging_flush_range_tlbs(unsigned long virt,
+						unsigned long size)
+{
+	unsigned long pages = PAGES(size);
+
+	if (!is_el2())
+		return;
+
+	dsb();
+	if (pages > TLB_FLUSH_MAX_PAGES)
+		arm_write_sysreg(TLBIALLH, 0);
+	else
+		for (virt &= PAGE_MASK; pages > 0; pages--, virt += PAGE_SIZE)
+			arm_write_sysreg(TLBIMVAH, virt);
+	dsb();
+	isb();
+}
+
 /* Used to clean the PAGING_COHERENT page table changes */
 static inline void arch_paging_flush_cpu_caches(void *addr, long size)
 {
 	arm_dcaches_flush(addr, size, DCACHE_CLEAN);
 }
 
+static inline void arch_paging_zero_page(void *page)
+{
+	memset(page, 0, PAGE_SIZE);
+}
+
 #endif /* !__ASSEMBLY__ */
 
 #endif /* !_JAILHOUSE_ASM_PAGING_H */
@@ -15,8 +15,10 @@
  */
 
 #include <jailhouse/control.h>
+#include <jailhouse/latency.h>
 #include <jailhouse/printk.h>
 #include <jailhouse/panic.h>
+#include <jailhouse/trace.h>
 #include <asm/control.h>
 #include <asm/gic.h>
 #include <asm/psci.h>
@@ -425,15 +427,36 @@ static const trap_handler trap_handlers[0x40] =
 	[HSR_EC_DABT]		= arch_handle_dabt,
 };
 
+/* Kind of a trap for the exit latency histograms, -1 if not accounted */
+static int exit_kind(u32 exception_class)
+{
+	switch (exception_class) {
+	case HSR_EC_DABT:
+		return JAILHOUSE_EXIT_MMIO;
+	case HSR_EC_HVC:
+		return JAILHOUSE_EXIT_HYPERCALL;
+	case HSR_EC_SMC:
+		return JAILHOUSE_EXIT_SMC;
+	case HSR_EC_CP15_32:
+	case HSR_EC_CP15_64:
+		return JAILHOUSE_EXIT_SYSREG;
+	default:
+		return -1;
+	}
+}
+
 static void arch_handle_trap(union registers *guest_regs)
 {
+	u64 start = exit_latency_start();
 	struct trap_context ctx;
 	u32 exception_class;
 	int ret = TRAP_UNHANDLED;
+	int kind;
 
 	arm_read_sysreg(HSR, ctx.hsr);
 	exception_class = HSR_EC(ctx.hsr);
 	ctx.regs = guest_regs->usr;
+	trace_begin(JAILHOUSE_TRACE_TRAP, exception_class);
 
 	/*
 	 * On some implementations, instructions that fail their condition check
@@ -441,7 +464,7 @@ static void arch_handle_trap(union registers *guest_regs)
 	 */
 	if (arch_failed_condition(&ctx)) {
 		arch_skip_instruction(&ctx);
-		return;
+		goto out;
 	}
 
 	if (trap_handlers[exception_class])
@@ -457,6 +480,13 @@ static void arch_handle_trap(union registers *guest_regs)
 		dump_guest_regs(&ctx);
 		panic_park();
 	}
+
+out:
+	trace_end(JAILHOUSE_TRACE_TRAP, exception_class);
+
+	kind = exit_kind(exception_class);
+	if (kind >= 0)
+		exit_latency_account(kind, start);
 }
 
 static void arch_dump_exit(union registers *regs, const char *reason)
@@ -13,6 +13,7 @@
 #ifndef _JAILHOUSE_ASM_PAGING_H
 #define _JAILHOUSE_ASM_PAGING_H
 
+#include <jailhouse/string.h>
 #include <jailhouse/types.h>
 #include <jailhouse/utils.h>
 #include <asm/dcaches.h>
@@ -41,10 +42,14 @@
 #define L3_VADDR_MASK		BIT_MASK(20, 12)
 
 /*
- * Stage-1 and Stage-2 lower attributes.
+ * Stage-1 and Stage-2 upper attributes.
  * The contiguous bit is a hint that allows the PE to store blocks of 16 pages
- * in the TLB. This may be a useful optimisation.
+ * in the TLB. Set on cell stage-2 mappings by arm_paging_coalesce().
  */
+#define PTE_FLAG_CONTIGUOUS	(0x1UL << 52)
+#define PTE_CONT_ENTRIES	16
+
+/* Stage-1 and Stage-2 lower attributes. */
 #define PTE_ACCESS_FLAG		(0x1 << 10)
 /*
  * When combining shareability attributes, the stage-1 ones prevail. So we can
@@ -147,6 +152,10 @@
 /* Memory Model Feature Register 0 */
 #define ID_AA64MMFR0_PARANGE_SHIFT	0
 
+/* Instruction Set Attribute Register 0: TLB range maintenance (ARMv8.4) */
+#define ID_AA64ISAR0_TLB_SHIFT		56
+#define ID_AA64ISAR0_TLB_RANGE		2
+
 /* Macros used by the core, only for the EL2 stage-1 mappings */
 #define PAGE_FLAG_FRAMEBUFFER	S1_PTE_FLAG_DEVICE
 #define PAGE_FLAG_DEVICE	S1_PTE_FLAG_DEVICE
@@ -200,9 +209,20 @@ unsigned int get_cpu_parange(void);
 
 int arm_paging_cell_init(struct cell *cell);
 void arm_paging_cell_destroy(struct cell *cell);
+bool arm_paging_flush_cell_ranges(struct cell *cell);
+
+struct arm_tlb_range;
 
 void arm_paging_vcpu_init(struct paging_structures *pg_structs);
 
+void arm_paging_cpu_init(void);
+bool arm_paging_flush_ipa_ranges(u64 vttbr, const struct arm_tlb_range *ranges,
+				 unsigned int num);
+
+void arm_paging_coalesce(const struct paging_structures *pg_structs,
+			 unsigned long virt, unsigned long size,
+			 unsigned long paging_flags);
+
 static inline void arm_paging_vcpu_flush_tlbs(void)
 {
 	/*
@@ -223,12 +243,50 @@ static inline void arch_paging_flush_page_tlbs(unsigned long page_addr)
 		: : "r" (page_addr >> PAGE_SHIFT));
 }
 
+/* Above this size, all hypervisor TLB entries are dropped instead */
+#define TLB_FLUSH_MAX_PAGES	64
+
+static inline void arch_paging_flush_range_tlbs(unsigned long virt,
+						unsigned long size)
+{
+	unsigned long pages = PAGES(size);
+
+	dsb(ish);
+	if (pages > TLB_FLUSH_MAX_PAGES)
+		asm volatile("tlbi alle2");
+	else
+		for (virt >>= PAGE_SHIFT; pages > 0; pages--, virt++)
+			asm volatile("tlbi vae2, %0" : : "r" (virt));
+	dsb(ish);
+	isb();
+}
+
 /* Used to clean the PAGE_MAP_COHERENT page table changes */
 static inline void arch_paging_flush_cpu_caches(void *addr, long size)
 {
 	arm_dcaches_flush(addr, size, DCACHE_CLEAN);
 }
 
+#define DCZID_DZP		(1 << 4)
+#define DCZID_BS_MASK		0xf
+
+/* Zero a page by cache block, unless DC ZVA is prohibited */
+static inline void arch_paging_zero_page(void *page)
+{
+	unsigned long dczid, block, addr;
+
+	arm_read_sysreg(DCZID_EL0, dczid);
+	if (dczid & DCZID_DZP) {
+		memset(page, 0, PAGE_SIZE);
+		return;
+	}
+
+	block = 4UL << (dczid & DCZID_BS_MASK);
+	for (addr = (unsigned long)page; addr < (unsigned long)page + PAGE_SIZE;
+	     addr += block)
+		asm volatile("dc zva, %0" : : "r" (addr) : "memory");
+}
+
 #endif /* !__ASSEMBLY__ */
 
 #endif /* !_JAILHOUSE_ASM_PAGING_H */
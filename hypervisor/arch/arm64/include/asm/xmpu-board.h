@@ -17,11 +17,22 @@
 
 #include <asm/smc.h>
 
-#if defined(CONFIG_XMPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+#if (defined(CONFIG_XMPU_ACTIVE) || defined(CONFIG_XPPU_ACTIVE)) && \
+	defined(CONFIG_MACH_ZYNQMP_ZCU102)
 
 #define ZCU102_XMPU_READ_SMC     0x8400ff04
 #define ZCU102_XMPU_WRITE_SMC    0x8400ff05
 
+/*
+ * XMPU violation interrupts (GIC IDs, see UG1085 "System Interrupts").
+ * They must not be assigned to any cell, including the root cell.
+ */
+#define ZCU102_XMPU_FPD_IRQ      166   /* DDR and FPD XMPUs */
+#define ZCU102_XMPU_OCM_IRQ      42    /* OCM XMPU */
+
+/* XPPU configuration registers, also poisoned by the XMPU unit */
+#define XPPU_BASE_ADDR           0xFF980000U
+
 static inline u32 xmpu_read32(void *addr)
 {
 	int ret;
@@ -44,6 +55,6 @@ static inline void xmpu_write32(void *addr, u32 val)
 	return;
 }
 
-#endif /* CONFIG_XMPU_ACTIVE && CONFIG_MACH_ZYNQMP_ZCU102 */
+#endif /* (CONFIG_XMPU_ACTIVE || CONFIG_XPPU_ACTIVE) && CONFIG_MACH_ZYNQMP_ZCU102 */
 
 #endif /* _JAILHOUSE_ARM64_XMPU_BOARD_H */
\ No newline at end of file
@@ -18,6 +18,14 @@
 #include <jailhouse/types.h>
 
 #if defined(CONFIG_XMPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+struct per_cpu;
+
+// Violation interrupts
+bool irq_is_xmpu(u32 irqn);
+bool xmpu_isr_handler(void);
+long xmpu_get_faults(struct per_cpu *cpu_data, unsigned long id,
+		     unsigned long log_ptr);
+
 //Debug Print
 void print_xmpu_status_regs(u32 xmpu_base);
 void print_xmpu_region_regs(u32 xmpu_base, u32 region);
@@ -24,6 +24,7 @@
 #include <jailhouse/assert.h>
 #include <jailhouse/memguard-common.h>
 #include <jailhouse/memguard.h>
+#include <jailhouse/trace.h>
 #include <asm/memguard.h>
 #include <asm/gic_v2.h>
 #include <asm/timer.h>
@@ -119,6 +120,7 @@ bool memguard_isr_timer(void)
 
 	assert(arm_is_irq_off());
 	memguard_isr_debug_print("time");
+	trace_instant(JAILHOUSE_TRACE_MEMGUARD_TIMER, memguard->budget_memory);
 
 	memguard->last_time += memguard->budget_time;
 	/* Recharge budget */
@@ -153,6 +155,7 @@ bool memguard_isr_pmu(void)
 	/* NOTE: both IRQ and FIQ are off here */
 	assert(arm_is_irq_off());
 	memguard_isr_debug_print("pmu");
+	trace_instant(JAILHOUSE_TRACE_MEMGUARD_PMU, 0);
 
 	/* clear overflow, let the counter run */
 	pmu_clear_overflow(memguard_pmu_cnt);
@@ -184,9 +187,11 @@ void memguard_cpu_block(void)
 	printk("%uB\n", this_cpu_id());
 #endif
 	/* poll till the next interrupt, then recheck what happened */
+	trace_begin(JAILHOUSE_TRACE_MEMGUARD_BLOCK, 0);
 	while (!timer_fired()) {
 		isb();
 	}
+	trace_end(JAILHOUSE_TRACE_MEMGUARD_BLOCK, 0);
 
 	return;
 }
@@ -241,23 +246,17 @@ void memguard_cpu_reset(void)
 /** Setup budget time + memory for this CPU. */
 int memguard_set(struct memguard *memguard, unsigned long params_address)
 {
-	unsigned long params_page_offs = params_address & PAGE_OFFS_MASK;
-	unsigned int params_pages;
-	void *params_mapping;
 	struct memguard_params *params;
 	unsigned int event_type;
 
 	assert(arm_is_irq_off());
 
-	params_pages = PAGES(params_page_offs + sizeof(struct memguard_params));
-	params_mapping = paging_get_guest_pages(NULL, params_address,
-						params_pages,
-						PAGE_READONLY_FLAGS);
-	if (!params_mapping)
+	params = hypercall_get_params(params_address,
+				      sizeof(struct memguard_params),
+				      PAGE_READONLY_FLAGS);
+	if (!params)
 		return -ENOMEM;
 
-	params = (struct memguard_params *)(params_mapping + params_page_offs);
-
 	memguard->start_time = timer_get_ticks();
 	memguard->last_time = memguard->start_time;
 
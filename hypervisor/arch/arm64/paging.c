@@ -12,10 +12,23 @@
 
 #include <jailhouse/control.h>
 #include <jailhouse/percpu.h>
+#include <asm/cell.h>
 #include <asm/paging.h>
 
+/* Above this number of pages, the VMID is flushed instead */
+#define S2_TLB_FLUSH_MAX_PAGES	512
+/* Largest range one series of range invalidations can cover */
+#define TLBI_RANGE_MAX_PAGES	(1UL << 21)
+
+#define TLBI_RANGE_TG_4K	(1UL << 46)
+#define TLBI_RANGE_SCALE_SHIFT	44
+#define TLBI_RANGE_NUM_SHIFT	39
+
 unsigned int cpu_parange_encoded;
 
+/* Cleared if one of the CPUs lacks the TLB range instructions */
+static bool tlbi_range = true;
+
 /**
  * Return the physical address bits.
  *
@@ -46,3 +59,218 @@ unsigned int get_cpu_parange(void)
 	return cpu_parange_encoded < ARRAY_SIZE(pa_bits) ?
 		pa_bits[cpu_parange_encoded] : 0;
 }
+
+/**
+ * Probe the TLB maintenance features of the calling CPU.
+ *
+ * Range invalidations are broadcast, so they are only used if all CPUs
+ * implement them.
+ */
+void arm_paging_cpu_init(void)
+{
+	unsigned long isar0;
+
+	arm_read_sysreg(ID_AA64ISAR0_EL1, isar0);
+	if (((isar0 >> ID_AA64ISAR0_TLB_SHIFT) & 0xf) < ID_AA64ISAR0_TLB_RANGE)
+		tlbi_range = false;
+}
+
+static void flush_ipa_pages(unsigned long ipa, unsigned long pages)
+{
+	unsigned long scale = 0, num, range;
+
+	ipa >>= PAGE_SHIFT;
+	while (pages > 0) {
+		if (!tlbi_range || pages & 1) {
+			asm volatile("tlbi ipas2e1is, %0" : : "r" (ipa));
+			ipa++;
+			pages--;
+			continue;
+		}
+
+		/*
+		 * Each scale covers 5 bits of the page count, one TLBI
+		 * RIPAS2E1IS (encoded as SYS) invalidates
+		 * num << (5 * scale + 1) pages.
+		 */
+		num = (pages >> (5 * scale + 1)) & 0x1f;
+		if (num) {
+			range = TLBI_RANGE_TG_4K |
+				scale << TLBI_RANGE_SCALE_SHIFT |
+				(num - 1) << TLBI_RANGE_NUM_SHIFT | ipa;
+			asm volatile("sys #4, c8, c0, #2, %0" : : "r" (range));
+			ipa += num << (5 * scale + 1);
+			pages -= num << (5 * scale + 1);
+		}
+		scale++;
+	}
+}
+
+/**
+ * Invalidate the stage-2 TLB entries of IPA ranges on all CPUs.
+ *
+ * The VMID is taken from VTTBR_EL2, so the one of the target cell is loaded
+ * for the time of the invalidation. Stage-1 entries of that VMID are dropped
+ * as well, they may have been combined with the old stage-2 translations.
+ *
+ * @param vttbr		VTTBR_EL2 value of the target cell.
+ * @param ranges	Ranges to invalidate.
+ * @param num		Number of ranges.
+ *
+ * @return True if done, false if the ranges are too large and the caller has
+ * to flush the whole VMID instead.
+ */
+bool arm_paging_flush_ipa_ranges(u64 vttbr, const struct arm_tlb_range *ranges,
+				 unsigned int num)
+{
+	unsigned long pages = 0;
+	unsigned int n;
+	u64 old_vttbr;
+
+	for (n = 0; n < num; n++)
+		pages = tlbi_range ? MAX(pages, PAGES(ranges[n].size)) :
+			pages + PAGES(ranges[n].size);
+	if (pages >= (tlbi_range ? TLBI_RANGE_MAX_PAGES :
+				   S2_TLB_FLUSH_MAX_PAGES + 1))
+		return false;
+
+	arm_read_sysreg(VTTBR_EL2, old_vttbr);
+	if (old_vttbr != vttbr) {
+		arm_write_sysreg(VTTBR_EL2, vttbr);
+		isb();
+	}
+
+	/* Complete the page table updates before invalidating. */
+	dsb(ishst);
+	for (n = 0; n < num; n++)
+		flush_ipa_pages(ranges[n].start, PAGES(ranges[n].size));
+	dsb(ish);
+	asm volatile("tlbi vmalle1is");
+	dsb(ish);
+	isb();
+
+	if (old_vttbr != vttbr) {
+		arm_write_sysreg(VTTBR_EL2, old_vttbr);
+		isb();
+	}
+
+	return true;
+}
+
+#define PTE_ENTRIES		(PAGE_SIZE / sizeof(u64))
+
+/* Attribute bits of an entry that a block built from it has to inherit */
+#define PTE_ATTR_MASK		~(PTE_PAGE_ADDR_MASK | PTE_FLAG_CONTIGUOUS)
+
+static unsigned long level_span(const struct paging *paging)
+{
+	/* Levels without block entries span a full table of the next one */
+	if (paging->page_size)
+		return paging->page_size;
+	return level_span(paging + 1) * PTE_ENTRIES;
+}
+
+static unsigned long terminal_phys(const struct paging *paging,
+				   pt_entry_t pte)
+{
+	if (!paging->entry_valid(pte, PAGE_PRESENT_FLAGS))
+		return INVALID_PHYS_ADDR;
+	return paging->get_phys(pte, 0);
+}
+
+/*
+ * True if the @p num entries starting at @p pte are valid terminal entries
+ * with identical attributes, mapping a physical range aligned to its size.
+ */
+static bool entries_mergeable(const struct paging *paging, pt_entry_t pte,
+			      unsigned int num)
+{
+	unsigned long phys = terminal_phys(paging, pte);
+	unsigned int n;
+
+	if (phys == INVALID_PHYS_ADDR || phys & (num * paging->page_size - 1))
+		return false;
+
+	for (n = 1; n < num; n++)
+		if (terminal_phys(paging, &pte[n]) !=
+		    phys + n * paging->page_size ||
+		    (pte[n] ^ pte[0]) & PTE_ATTR_MASK)
+			return false;
+	return true;
+}
+
+static void coalesce_table(const struct paging *paging, page_table_t pt,
+			   unsigned long start, unsigned long end,
+			   unsigned long paging_flags)
+{
+	unsigned long span = level_span(paging);
+	unsigned long cont_span = span * PTE_CONT_ENTRIES;
+	unsigned long virt, next, phys;
+	page_table_t sub_pt;
+	pt_entry_t pte;
+	unsigned int n;
+
+	for (virt = start; virt < end; virt = next) {
+		next = (virt & ~(span - 1)) + span;
+		pte = paging->get_entry(pt, virt);
+		if (!paging->entry_valid(pte, PAGE_PRESENT_FLAGS) ||
+		    paging->get_phys(pte, virt) != INVALID_PHYS_ADDR)
+			continue;
+
+		sub_pt = paging_phys2hvirt(paging->get_next_pt(pte));
+		coalesce_table(paging + 1, sub_pt, virt, MIN(next, end),
+			       paging_flags);
+
+		/* Replace a table that is covered by the range by a block. */
+		if (!paging->page_size || virt & (span - 1) || next > end ||
+		    !entries_mergeable(paging + 1, sub_pt, PTE_ENTRIES))
+			continue;
+
+		phys = terminal_phys(paging + 1, sub_pt);
+		paging->set_terminal(pte, phys,
+				     *sub_pt & PTE_ATTR_MASK & ~PTE_FLAG_TERMINAL);
+		if (paging_flags & PAGING_COHERENT)
+			arch_paging_flush_cpu_caches(pte, sizeof(*pte));
+		page_free(&mem_pool, sub_pt, 1);
+	}
+
+	if (!paging->page_size)
+		return;
+
+	/* Mark aligned runs of PTE_CONT_ENTRIES blocks or pages as such. */
+	for (virt = (start + cont_span - 1) & ~(cont_span - 1);
+	     virt < end && end - virt >= cont_span; virt += cont_span) {
+		pte = paging->get_entry(pt, virt);
+		if (!entries_mergeable(paging, pte, PTE_CONT_ENTRIES))
+			continue;
+
+		for (n = 0; n < PTE_CONT_ENTRIES; n++)
+			pte[n] |= PTE_FLAG_CONTIGUOUS;
+		if (paging_flags & PAGING_COHERENT)
+			arch_paging_flush_cpu_caches(pte,
+					PTE_CONT_ENTRIES * sizeof(*pte));
+	}
+}
+
+/**
+ * Coalesce the mappings of a range after it was created page by page.
+ *
+ * Tables whose entries map a contiguous, aligned range with identical
+ * attributes are replaced by a single block, and aligned runs of 16 such
+ * entries get the contiguous hint, so that they take a single TLB entry.
+ *
+ * Only for paging structures that are not in use yet, as neither change
+ * is done break-before-make.
+ *
+ * @param pg_structs	Descriptor of the paging structures.
+ * @param virt		Virtual start address of the range.
+ * @param size		Size of the range.
+ * @param paging_flags	Flags describing the paging mode, see @ref PAGING_FLAGS.
+ */
+void arm_paging_coalesce(const struct paging_structures *pg_structs,
+			 unsigned long virt, unsigned long size,
+			 unsigned long paging_flags)
+{
+	coalesce_table(pg_structs->root_paging, pg_structs->root_table,
+		       virt, virt + size, paging_flags);
+}
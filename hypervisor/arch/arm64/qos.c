@@ -346,9 +346,6 @@ static int qos_disable_all(void)
 /* Main entry point for QoS management call */
 int qos_call(unsigned long count, unsigned long settings_ptr)
 {
-	unsigned long sett_page_offs = settings_ptr & ~PAGE_MASK;
-	unsigned int sett_pages;
-	void *sett_mapping;
 	struct qos_setting *settings;
 
 	/* Check if the NIC needs to be mapped */
@@ -360,19 +357,19 @@ int qos_call(unsigned long count, unsigned long settings_ptr)
 			return -ENOSYS;
 	}
 
-	/* The settings currently reside in kernel memory. Use
-	 * temporary mapping to make the settings readable by the
-	 * hypervisor. No need to clean up the mapping because this is
-	 * only temporary by design. */
-	sett_pages = PAGES(sett_page_offs + sizeof(struct qos_setting) * count);
-	sett_mapping = paging_get_guest_pages(NULL, settings_ptr, sett_pages,
-					      PAGE_READONLY_FLAGS);
-
-	if (sett_mapping == NULL) {
+	/* The settings reside either in the parameter page of the cell
+	 * or in kernel memory. In the latter case, a temporary mapping
+	 * makes them readable by the hypervisor. No need to clean up the
+	 * mapping because this is only temporary by design. */
+	if (count > NUM_TEMPORARY_PAGES * PAGE_SIZE / sizeof(struct qos_setting))
+		return -EINVAL;
+	settings = hypercall_get_params(settings_ptr,
+					sizeof(struct qos_setting) * count,
+					PAGE_READONLY_FLAGS);
+
+	if (settings == NULL) {
 		return -ENOMEM;
 	}
-
-	settings = (struct qos_setting *)(sett_mapping + sett_page_offs);
 	/* Check if the user has requestes QoS control to be disabled */
 	if ((count > 0) && (strncmp("disable", settings[0].dev_name, 8) == 0)) {
 		return qos_disable_all();
@@ -66,6 +66,8 @@ int arch_cpu_init(struct per_cpu *cpu_data)
 	if (err)
 		return err;
 
+	arm_paging_cpu_init();
+
 	if (sdei_available) {
 		if (smc_arg5(SDEI_EVENT_REGISTER, 0,
 			     (unsigned long)sdei_handler, LOCAL_CPU_BASE,
@@ -12,8 +12,10 @@
  */
 
 #include <jailhouse/control.h>
+#include <jailhouse/latency.h>
 #include <jailhouse/printk.h>
 #include <jailhouse/panic.h>
+#include <jailhouse/trace.h>
 #include <asm/control.h>
 #include <asm/entry.h>
 #include <asm/gic.h>
@@ -171,13 +173,37 @@ static const trap_handler trap_handlers[0x40] =
 	[ESR_EC_DABT_LOW]	= arch_handle_dabt,
 };
 
+/* Kind of a trap for the exit latency histograms, -1 if not accounted */
+static int exit_kind(u64 esr)
+{
+	switch (ESR_EC(esr)) {
+	case ESR_EC_DABT_LOW:
+		return JAILHOUSE_EXIT_MMIO;
+	case ESR_EC_HVC32:
+	case ESR_EC_HVC64:
+		return JAILHOUSE_EXIT_HYPERCALL;
+	case ESR_EC_SMC32:
+	case ESR_EC_SMC64:
+		return JAILHOUSE_EXIT_SMC;
+	case ESR_EC_CP15_32:
+	case ESR_EC_CP15_64:
+	case ESR_EC_SYS64:
+		return JAILHOUSE_EXIT_SYSREG;
+	default:
+		return -1;
+	}
+}
+
 void arch_handle_trap(union registers *guest_regs)
 {
+	u64 start = exit_latency_start();
 	struct trap_context ctx;
 	trap_handler handler;
 	int ret = TRAP_UNHANDLED;
+	int kind;
 
 	fill_trap_context(&ctx, guest_regs);
+	trace_begin(JAILHOUSE_TRACE_TRAP, ESR_EC(ctx.esr));
 
 	handler = trap_handlers[ESR_EC(ctx.esr)];
 	if (handler)
@@ -192,6 +218,12 @@ void arch_handle_trap(union registers *guest_regs)
 		dump_regs(&ctx);
 		panic_park();
 	}
+
+	trace_end(JAILHOUSE_TRACE_TRAP, ESR_EC(ctx.esr));
+
+	kind = exit_kind(ctx.esr);
+	if (kind >= 0)
+		exit_latency_account(kind, start);
 }
 
 void arch_el2_abt(union registers *regs)
@@ -16,8 +16,15 @@
 #include <jailhouse/assert.h>
 #include <jailhouse/unit.h>
 #include <jailhouse/control.h>
+#include <jailhouse/paging.h>
+#include <jailhouse/printk.h>
 #include <jailhouse/string.h>
+#include <asm/bitops.h>
+#include <asm/gic_v2.h>
+#include <asm/gic_v3.h>
+#include <asm/spinlock.h>
 #include <asm/sysregs.h>
+#include <asm/timer.h>
 #include <asm/xmpu-board.h>
 #include <asm/xmpu.h>
 
@@ -51,7 +58,6 @@
 #define XMPU_ALIGN_4KB  0
 
 /* XPPU configuration register addresses */
-#define XPPU_BASE_ADDR            0xFF980000U
 #define XPPU_POISON_OFFSET_ADDR   0xFF9CFF00U
 
 /* XMPU configuration register addresses */
@@ -75,6 +81,8 @@
 /* XMPU Region offset */
 #define XMPU_REGION_OFFSET        0x10U
 #define NR_XMPU_REGIONS 16
+/* XMPU channels: NR_XMPU_DDR + FPD + OCM */
+#define NR_XMPU_CHANNELS (NR_XMPU_DDR + 2)
 /* XMPU region field offset */
 #define RX_START_OFFSET    0x100U
 #define RX_END_OFFSET      0x104U
@@ -112,6 +120,14 @@
 #define XMPU_DEFAULT_END          0x00000000U
 #define XMPU_DEFAULT_MASTER       0x00000000U
 #define XMPU_DEFAULT_CONFIG       0x00000008U
+/* XMPU interrupt bits (ISR, IMR, IEN, IDS) */
+#define XMPU_IRQ_INV_APB          (1U << 0)
+#define XMPU_IRQ_RD_PERM_VIO      (1U << 1)
+#define XMPU_IRQ_WR_PERM_VIO      (1U << 2)
+#define XMPU_IRQ_SEC_VIO          (1U << 3)
+#define XMPU_IRQ_ALL              (XMPU_IRQ_INV_APB | XMPU_IRQ_RD_PERM_VIO | XMPU_IRQ_WR_PERM_VIO | XMPU_IRQ_SEC_VIO)
+/* AXI ID field of ERR_STATUS2 */
+#define XMPU_ERR_AXI_ID_MASK      0x0000FFFFU
 
 /* Master Devices */
 /* RPU0 ( 0000, 00, AXI ID[3:0] ) */
@@ -190,48 +206,73 @@ typedef struct xmpu_region_config{
   bool used;
 }xmpu_region_config;
 
+// Last values written to the region registers (the XMPU is only reachable via SMC)
+typedef struct xmpu_region_regs{
+  u32 start;
+  u32 end;
+  u32 master;
+  u32 config;
+}xmpu_region_regs;
+
 typedef struct xmpu_dev{
   u32 base_addr; 
   xmpu_status_config status;
   xmpu_region_config region[NR_XMPU_REGIONS];
   xmpu_dev_type type;
+  // Jailhouse-Omnivisor index of the region slots
+  u16 used_mask;      // slots holding a valid configuration
+  u16 released_mask;  // slots released but not yet reset to default
+  xmpu_region_regs shadow[NR_XMPU_REGIONS];
 }xmpu_dev;
 
 typedef struct master_device{
   u64 id;
   u64 mask;
   u8  xmpu_dev_mask;
+  // Jailhouse-Omnivisor index: region slots used by the master in each channel
+  u16 region_map[NR_XMPU_CHANNELS];
 }master_device;
 
 /* XMPU board specific devices */
 static xmpu_dev xmpu_device[] = {
-    { XMPU_DDR_BASE_ADDR, {0}, {{0}}, XMPU_DDR },
-    { (XMPU_DDR_BASE_ADDR + XMPU_DDR_OFFSET), {0}, {{0}}, XMPU_DDR },
-    { (XMPU_DDR_BASE_ADDR + (2 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR },
-    { (XMPU_DDR_BASE_ADDR + (3 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR },
-    { (XMPU_DDR_BASE_ADDR + (4 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR },
-    { (XMPU_DDR_BASE_ADDR + (5 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR },
-    { XMPU_FPD_BASE_ADDR,   {0}, {{0}}, XMPU_FPD },
-    { XMPU_OCM_BASE_ADDR,   {0}, {{0}}, XMPU_OCM }
+    { XMPU_DDR_BASE_ADDR, {0}, {{0}}, XMPU_DDR, 0, 0, {{0}} },
+    { (XMPU_DDR_BASE_ADDR + XMPU_DDR_OFFSET), {0}, {{0}}, XMPU_DDR, 0, 0, {{0}} },
+    { (XMPU_DDR_BASE_ADDR + (2 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR, 0, 0, {{0}} },
+    { (XMPU_DDR_BASE_ADDR + (3 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR, 0, 0, {{0}} },
+    { (XMPU_DDR_BASE_ADDR + (4 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR, 0, 0, {{0}} },
+    { (XMPU_DDR_BASE_ADDR + (5 * XMPU_DDR_OFFSET)), {0}, {{0}}, XMPU_DDR, 0, 0, {{0}} },
+    { XMPU_FPD_BASE_ADDR,   {0}, {{0}}, XMPU_FPD, 0, 0, {{0}} },
+    { XMPU_OCM_BASE_ADDR,   {0}, {{0}}, XMPU_OCM, 0, 0, {{0}} }
 };
 #define NR_XMPU (sizeof(xmpu_device)/sizeof(xmpu_device[0]))
 
 /* Static master device list */
 static master_device master_device_list[] = {
-    { RPU0_ID,        RPU0_MASK,        (u8)0b10000001 },
-    { RPU1_ID,        RPU1_MASK,        (u8)0b10000001 },
-    { GROUP0_ID,      GROUP0_MASK,      (u8)0b00000110 },
-    { GROUP1_ID,      GROUP1_MASK,      (u8)0b00000110 },
-    { GROUP2_ID,      GROUP2_MASK,      (u8)0b00000110 },
-    { APU_ID,         APU_MASK,         (u8)0b11000110 },
-    { DISPLAYPORT_ID, DISPLAYPORT_MASK, (u8)0b00001000 },
-    { FPD_DMA_ID,     FPD_DMA_MASK,     (u8)0b00001000 },
-    { TBU3_ID,        TBU3_MASK,        (u8)0b00001000 },
-    { TBU4_ID,        TBU4_MASK,        (u8)0b00010000 },
-    { TBU5_ID,        TBU5_MASK,        (u8)0b00100000 }
+    { RPU0_ID,        RPU0_MASK,        (u8)0b10000001, {0} },
+    { RPU1_ID,        RPU1_MASK,        (u8)0b10000001, {0} },
+    { GROUP0_ID,      GROUP0_MASK,      (u8)0b00000110, {0} },
+    { GROUP1_ID,      GROUP1_MASK,      (u8)0b00000110, {0} },
+    { GROUP2_ID,      GROUP2_MASK,      (u8)0b00000110, {0} },
+    { APU_ID,         APU_MASK,         (u8)0b11000110, {0} },
+    { DISPLAYPORT_ID, DISPLAYPORT_MASK, (u8)0b00001000, {0} },
+    { FPD_DMA_ID,     FPD_DMA_MASK,     (u8)0b00001000, {0} },
+    { TBU3_ID,        TBU3_MASK,        (u8)0b00001000, {0} },
+    { TBU4_ID,        TBU4_MASK,        (u8)0b00010000, {0} },
+    { TBU5_ID,        TBU5_MASK,        (u8)0b00100000, {0} }
 };
 #define NR_MASTER_DEVICES (sizeof(master_device_list)/sizeof(master_device_list[0]))
 
+/* Soft-core rCPUs masters, allocated at cell_init from the rCPU device configuration */
+#define NR_SOFT_MASTERS 8
+
+typedef struct soft_master{
+  u32 rcpu_id;
+  bool used;
+  master_device dev;
+}soft_master;
+
+static soft_master soft_master_list[NR_SOFT_MASTERS];
+
 #if defined(CONFIG_XMPU_DEBUG)
 //Print the XMPU status registers
 void print_xmpu_status_regs(u32 xmpu_base){
@@ -292,6 +333,43 @@ static void set_xmpu_status(xmpu_dev * xmpu){
   xmpu_write32((void *)(XMPU_LOCK_REGISTER(xmpu->base_addr)), xmpu_lock_register);
 }
 
+/*
+ * Write the region registers of the xmpu, skipping the ones whose value
+ * is already programmed according to the shadow copy. Every access is an
+ * SMC to the secure monitor, so unchanged registers are never rewritten
+ * unless force is set (i.e., the hardware state is unknown).
+ */
+static void write_xmpu_region_regs(xmpu_dev *xmpu, u32 reg_num,
+                                   u32 start, u32 end, u32 master, u32 config,
+                                   bool force){
+  xmpu_region_regs *shadow = &xmpu->shadow[reg_num];
+  u32 region_offset = reg_num * XMPU_REGION_OFFSET;
+
+  // Disable the region first if it changes while enabled
+  if (!force && (shadow->config & 0x1) &&
+      (shadow->start != start || shadow->end != end || shadow->master != master)) {
+    shadow->config = XMPU_DEFAULT_CONFIG;
+    xmpu_write32((void *)(XMPU_CONFIG_REGISTER(xmpu->base_addr, region_offset)), shadow->config);
+  }
+
+  if (force || shadow->start != start) {
+    xmpu_write32((void *)(XMPU_START_REGISTER(xmpu->base_addr, region_offset)), start);
+    shadow->start = start;
+  }
+  if (force || shadow->end != end) {
+    xmpu_write32((void *)(XMPU_END_REGISTER(xmpu->base_addr, region_offset)), end);
+    shadow->end = end;
+  }
+  if (force || shadow->master != master) {
+    xmpu_write32((void *)(XMPU_MASTER_REGISTER(xmpu->base_addr, region_offset)), master);
+    shadow->master = master;
+  }
+  if (force || shadow->config != config) {
+    xmpu_write32((void *)(XMPU_CONFIG_REGISTER(xmpu->base_addr, region_offset)), config);
+    shadow->config = config;
+  }
+}
+
 // Set the XMPU region to the value of the input xmpu_dev
 static void set_xmpu_region(xmpu_dev *xmpu, u32 reg_num){
   u32 tmp_addr;
@@ -331,24 +409,14 @@ static void set_xmpu_region(xmpu_dev *xmpu, u32 reg_num){
   xmpu_master_register = (0x00000000 | (xmpu->region[reg_num].master_mask << 16) | (xmpu->region[reg_num].master_id));
   xmpu_config_register = (0x00000000 | (xmpu->region[reg_num].ns_checktype << 4) | (xmpu->region[reg_num].region_ns << 3) | (xmpu->region[reg_num].wrallowed << 2) | (xmpu->region[reg_num].rdallowed << 1) | (xmpu->region[reg_num].enable));
 
-  xmpu_write32((void *)(XMPU_START_REGISTER(xmpu->base_addr, region_offset)), xmpu_start_register);
-  xmpu_write32((void *)(XMPU_END_REGISTER(xmpu->base_addr, region_offset)), xmpu_end_register);
-  xmpu_write32((void *)(XMPU_MASTER_REGISTER(xmpu->base_addr, region_offset)), xmpu_master_register);
-  xmpu_write32((void *)(XMPU_CONFIG_REGISTER(xmpu->base_addr, region_offset)), xmpu_config_register);
+  write_xmpu_region_regs(xmpu, reg_num, xmpu_start_register, xmpu_end_register,
+                         xmpu_master_register, xmpu_config_register, false);
 }
 
 // Set the XMPU region registers to default values
-static void set_xmpu_region_default(xmpu_dev *xmpu, u32 reg_num){
-  u32 xmpu_start_register   = XMPU_DEFAULT_START;
-  u32 xmpu_end_register     = XMPU_DEFAULT_END;
-  u32 xmpu_master_register  = XMPU_DEFAULT_MASTER;
-  u32 xmpu_config_register  = XMPU_DEFAULT_CONFIG;
-  u32 region_offset = reg_num * XMPU_REGION_OFFSET;
-
-  xmpu_write32((void *)(XMPU_START_REGISTER(xmpu->base_addr, region_offset)), xmpu_start_register);
-  xmpu_write32((void *)(XMPU_END_REGISTER(xmpu->base_addr, region_offset)), xmpu_end_register);
-  xmpu_write32((void *)(XMPU_MASTER_REGISTER(xmpu->base_addr, region_offset)), xmpu_master_register);
-  xmpu_write32((void *)(XMPU_CONFIG_REGISTER(xmpu->base_addr, region_offset)), xmpu_config_register);
+static void set_xmpu_region_default(xmpu_dev *xmpu, u32 reg_num, bool force){
+  write_xmpu_region_regs(xmpu, reg_num, XMPU_DEFAULT_START, XMPU_DEFAULT_END,
+                         XMPU_DEFAULT_MASTER, XMPU_DEFAULT_CONFIG, force);
 }
 
 // Set the XMPU status registers to default values
@@ -387,9 +455,12 @@ static void set_xmpu_default(xmpu_dev * xmpu){
   set_xmpu_status_default(xmpu);
 
   for(i=0 ; i<NR_XMPU_REGIONS; i++){
-    set_xmpu_region_default(xmpu, i);
+    set_xmpu_region_default(xmpu, i, true);
+    xmpu->region[i].id = 0;
+    xmpu->region[i].used = 0;
   }
-
+  xmpu->used_mask = 0;
+  xmpu->released_mask = 0;
 }
 
 // Setup status to poison (DDR->1Mb alignment, Others->4Kb alignment)
@@ -431,11 +502,17 @@ static void enable_region_configuration(xmpu_region_config *config,
   config->used =         true;
 }
 
-// Helper function to clean xmpu permissions of a specific device for all the regions used by a cell
+/*
+ * Helper function to release the xmpu regions of a specific device used by a cell.
+ * Only the slots recorded in the device region map are visited. The released
+ * slots keep their programming until they are either reused by
+ * set_cell_permissions or reset by flush_released_regions, so that
+ * reconfiguring a master rewrites only the registers that actually change.
+ */
 static void clean_cell_permissions(struct master_device *dev, u8 cell_id) { 
   u8 xmpu_dev_n = 0;
   u8 valid_reg_n = 0; 
-  u8 i = 0;
+  unsigned long map;
   xmpu_dev *xmpu;
   u8 mask = dev->xmpu_dev_mask;
 
@@ -453,22 +530,61 @@ static void clean_cell_permissions(struct master_device *dev, u8 cell_id) {
     xmpu_print("XMPU device channel %d (addr: 0x%08x)\n\r", xmpu_dev_n, xmpu->base_addr);
 #endif // CONFIG_XMPU_DEBUG
 
-    for(i = 0; i < NR_XMPU_REGIONS; i++) {
-      if(xmpu->region[i].id == cell_id && xmpu->region[i].used == 1 && xmpu->region[i].master_id == dev->id && xmpu->region[i].master_mask == dev->mask) {
-        valid_reg_n = i;
+    for (map = dev->region_map[xmpu_dev_n]; map; map &= map - 1) {
+      valid_reg_n = ffsl(map);
+      if (xmpu->region[valid_reg_n].id != cell_id)
+        continue;
 
 #if defined(CONFIG_XMPU_DEBUG)
-        xmpu_print("Cleaning XMPU region %d\n\r", valid_reg_n);
+      xmpu_print("Releasing XMPU region %d\n\r", valid_reg_n);
 #endif // CONFIG_XMPU_DEBUG
 
-        set_xmpu_region_default(xmpu, valid_reg_n);
-        xmpu->region[valid_reg_n].id = 0;
-        xmpu->region[valid_reg_n].used = 0;
-      }
+      xmpu->region[valid_reg_n].id = 0;
+      xmpu->region[valid_reg_n].used = 0;
+      xmpu->used_mask &= ~(1 << valid_reg_n);
+      xmpu->released_mask |= (1 << valid_reg_n);
+      dev->region_map[xmpu_dev_n] &= ~(1 << valid_reg_n);
     }
   }
 }
 
+// Reset to default the released regions that were not reused by any master
+static void flush_released_regions(struct master_device *dev) {
+  u8 xmpu_dev_n = 0;
+  u8 reg_n = 0;
+  unsigned long map;
+  xmpu_dev *xmpu;
+  u8 mask = dev->xmpu_dev_mask;
+
+  for (xmpu_dev_n = 0; mask; xmpu_dev_n++, mask >>= 1) {
+    if (!(mask & 0x1))
+      continue;
+    xmpu = &xmpu_device[xmpu_dev_n];
+
+    for (map = xmpu->released_mask; map; map &= map - 1) {
+      reg_n = ffsl(map);
+#if defined(CONFIG_XMPU_DEBUG)
+      xmpu_print("Cleaning XMPU region %d of channel %d\n\r", reg_n, xmpu_dev_n);
+#endif // CONFIG_XMPU_DEBUG
+      set_xmpu_region_default(xmpu, reg_n, false);
+    }
+    xmpu->released_mask = 0;
+  }
+}
+
+// Get a free region of the channel, preferring released ones to save register writes
+static int get_free_region(xmpu_dev *xmpu) {
+  unsigned long free;
+
+  free = xmpu->released_mask;
+  if (!free)
+    free = ~(unsigned long)xmpu->used_mask & ((1UL << NR_XMPU_REGIONS) - 1);
+  if (!free)
+    return -1;
+
+  return ffsl(free);
+}
+
 static bool mem_in_xmpu_addr_range(xmpu_dev *xmpu, const struct jailhouse_memory *mem) {
   bool in_ddr_low_range = mem->virt_start <= DDR_LOW_END - mem->size;
   bool in_ddr_high_range = (mem->virt_start >= DDR_HIGH_START) && (mem->virt_start + mem->size - 1 <= DDR_HIGH_END);
@@ -489,7 +605,7 @@ static bool mem_in_xmpu_addr_range(xmpu_dev *xmpu, const struct jailhouse_memory
 static int set_cell_permissions(struct master_device *dev, struct cell *cell) {
   u8 xmpu_dev_n = 0;
   u8 valid_reg_n = 0;
-  u8 i = 0;
+  int free_reg_n;
   u64 addr_start, addr_end;
   bool wrallowed = false;
   bool rdallowed = false;
@@ -524,16 +640,12 @@ static int set_cell_permissions(struct master_device *dev, struct cell *cell) {
         rdallowed = (mem->flags & JAILHOUSE_MEM_READ) ? 1 : 0;
 
         // Check for free region in the channel
-        for(i = 0; i < NR_XMPU_REGIONS; i++){
-          if(xmpu->region[i].used == 0){
-            valid_reg_n = i;
-            break;
-          }
-        }
-        if (i == NR_XMPU_REGIONS){
+        free_reg_n = get_free_region(xmpu);
+        if (free_reg_n < 0){
           xmpu_print("ERROR: No XMPU free region, impossible to create the VM\n\r");
           return -1;
         }
+        valid_reg_n = free_reg_n;
 
 #if defined(CONFIG_XMPU_DEBUG)
         xmpu_print("Setting XMPU region %d\n\r", valid_reg_n);
@@ -548,6 +660,9 @@ static int set_cell_permissions(struct master_device *dev, struct cell *cell) {
                           rdallowed,
                           cell->config->id);
         set_xmpu_region(xmpu, valid_reg_n);
+        xmpu->used_mask |= (1 << valid_reg_n);
+        xmpu->released_mask &= ~(1 << valid_reg_n);
+        dev->region_map[xmpu_dev_n] |= (1 << valid_reg_n);
 
         // rootcell needs only one region per channel
         if(cell->config->id == root_cell.config->id) break; 
@@ -558,42 +673,316 @@ static int set_cell_permissions(struct master_device *dev, struct cell *cell) {
   return 0;
 }
 
-static void arm_xmpu_cell_exit(struct cell *cell){
-  struct master_device *dev = NULL; 
-  unsigned int rcpu, fpga_region;
+/* Violation interrupts */
+static const u32 xmpu_irqs[] = { ZCU102_XMPU_FPD_IRQ, ZCU102_XMPU_OCM_IRQ };
+#define NR_XMPU_IRQS (sizeof(xmpu_irqs)/sizeof(xmpu_irqs[0]))
 
-  xmpu_print("Removing XMPU permissions for cell %d\n\r", cell->config->id);
+static spinlock_t xmpu_lock;
+static struct jailhouse_xmpu_fault_log xmpu_fault_log;
+
+bool irq_is_xmpu(u32 irqn){
+  u8 i;
+
+  for(i = 0; i < NR_XMPU_IRQS; i++){
+    if(irqn == xmpu_irqs[i])
+      return true;
+  }
+  return false;
+}
+
+static void xmpu_irq_enable(bool enable){
+  u8 i;
+
+  for(i = 0; i < NR_XMPU_IRQS; i++){
+    if(system_config->platform_info.arm.gic_version == 3){
+      if(enable)
+        gicv3_enable_irq(xmpu_irqs[i]);
+      else
+        gicv3_disable_irq(xmpu_irqs[i]);
+    } else {
+      if(enable){
+        gicv2_set_targets(xmpu_irqs[i], (1U << this_cpu_id()));
+        gicv2_enable_irq(xmpu_irqs[i]);
+      } else {
+        gicv2_disable_irq(xmpu_irqs[i]);
+      }
+    }
+  }
+}
+
+// Get the master device that issued the transaction with the given AXI ID
+static struct master_device *get_master_device(u8 xmpu_dev_n, u32 axi_id){
+  u8 i;
+
+  // Soft-cores first, their IDs are a subset of the HP ports ones
+  for(i = 0; i < NR_SOFT_MASTERS; i++){
+    if(!soft_master_list[i].used ||
+       !(soft_master_list[i].dev.xmpu_dev_mask & (1 << xmpu_dev_n)))
+      continue;
+    if((axi_id & soft_master_list[i].dev.mask) == soft_master_list[i].dev.id)
+      return &soft_master_list[i].dev;
+  }
+
+  for(i = 0; i < NR_MASTER_DEVICES; i++){
+    if(!(master_device_list[i].xmpu_dev_mask & (1 << xmpu_dev_n)))
+      continue;
+    if((axi_id & master_device_list[i].mask) == master_device_list[i].id)
+      return &master_device_list[i];
+  }
+  return NULL;
+}
+
+// Get the cell currently owning the master device
+static struct cell *get_master_owner(struct master_device *dev){
+  u8 xmpu_dev_n;
+  u16 cell_id;
+  struct cell *cell;
+
+  for(xmpu_dev_n = 0; xmpu_dev_n < NR_XMPU; xmpu_dev_n++){
+    if(!dev->region_map[xmpu_dev_n])
+      continue;
+    cell_id = xmpu_device[xmpu_dev_n].region[ffsl(dev->region_map[xmpu_dev_n])].id;
+    for_each_cell(cell)
+      if(cell->config->id == cell_id)
+        return cell;
+  }
+  return NULL;
+}
+
+/*
+ * Decode and clear the pending violation of a channel.
+ * ERR_STATUS1 holds address bits [39:12] of the offending access, except on
+ * the OCM XMPU which reports the full 32-bit address.
+ */
+static void handle_xmpu_violation(u8 xmpu_dev_n, u32 isr){
+  xmpu_dev *xmpu = &xmpu_device[xmpu_dev_n];
+  struct jailhouse_xmpu_fault *fault;
+  struct master_device *dev;
+  struct cell *cell = NULL;
+  u32 err1, err2;
+  u64 addr;
+
+  err1 = xmpu_read32((void *)(XMPU_ERR_STATUS1_REGISTER(xmpu->base_addr)));
+  err2 = xmpu_read32((void *)(XMPU_ERR_STATUS2_REGISTER(xmpu->base_addr)));
+  xmpu_write32((void *)(XMPU_ISR_REGISTER(xmpu->base_addr)), isr);
+
+  addr = (xmpu->type == XMPU_OCM) ? err1 : ((u64)err1 << 12);
+  dev = get_master_device(xmpu_dev_n, err2 & XMPU_ERR_AXI_ID_MASK);
+  if(dev)
+    cell = get_master_owner(dev);
+
+  fault = &xmpu_fault_log.entries[xmpu_fault_log.count % JAILHOUSE_XMPU_FAULT_LOG_SIZE];
+  fault->addr = addr;
+  fault->cell_id = cell ? (s32)cell->config->id : -1;
+  fault->master_id = err2 & XMPU_ERR_AXI_ID_MASK;
+  fault->channel = xmpu_dev_n;
+  fault->type = isr & XMPU_IRQ_ALL;
+  xmpu_fault_log.count++;
+
+  printk("XMPU violation: channel %d, master 0x%04x, addr 0x%010llx, type 0x%x, cell %d\n",
+         xmpu_dev_n, fault->master_id, addr, fault->type, fault->cell_id);
+
+  if(!cell)
+    return;
+
+  cell->arch.xmpu_violations++;
+
+  /*
+   * Fail the cell and fence the offending master: the master loses all its
+   * XMPU regions until the cell is destroyed and the root cell gets it back.
+   */
+  if((cell->config->flags & JAILHOUSE_CELL_XMPU_FAULT_FAIL) && cell != &root_cell){
+    printk("XMPU: putting cell \"%s\" into failed state\n", cell->config->name);
+    clean_cell_permissions(dev, cell->config->id);
+    flush_released_regions(dev);
+    cell->comm_page.comm_region.cell_state = JAILHOUSE_CELL_FAILED;
+  }
+}
+
+bool xmpu_isr_handler(void){
+  u8 xmpu_dev_n;
+  u32 isr;
+
+  spin_lock(&xmpu_lock);
+  for(xmpu_dev_n = 0; xmpu_dev_n < NR_XMPU; xmpu_dev_n++){
+    isr = xmpu_read32((void *)(XMPU_ISR_REGISTER(xmpu_device[xmpu_dev_n].base_addr)));
+    if(isr & XMPU_IRQ_ALL)
+      handle_xmpu_violation(xmpu_dev_n, isr & XMPU_IRQ_ALL);
+  }
+  spin_unlock(&xmpu_lock);
+
+  return true;
+}
+
+/*
+ * Return the number of XMPU violations of the cell and, if log_ptr is not
+ * zero, copy the fault log to that guest-physical address of the caller.
+ */
+long xmpu_get_faults(struct per_cpu *cpu_data, unsigned long id,
+                     unsigned long log_ptr){
+  unsigned long log_page_offs = log_ptr & ~PAGE_MASK;
+  struct jailhouse_xmpu_fault_log *log;
+  struct cell *cell;
+  void *log_mapping;
+  long ret = -ENOENT;
+
+  if(cpu_data->public.cell != &root_cell)
+    return -EPERM;
+
+  if(log_ptr){
+    log_mapping = paging_get_guest_pages(NULL, log_ptr,
+                    PAGES(log_page_offs + sizeof(*log)), PAGE_DEFAULT_FLAGS);
+    if(!log_mapping)
+      return -ENOMEM;
+    log = (struct jailhouse_xmpu_fault_log *)(log_mapping + log_page_offs);
+  }
+
+  spin_lock(&xmpu_lock);
+  for_each_cell(cell)
+    if(cell->config->id == id){
+      ret = cell->arch.xmpu_violations;
+      break;
+    }
+  if(log_ptr)
+    memcpy(log, &xmpu_fault_log, sizeof(*log));
+  spin_unlock(&xmpu_lock);
+
+  return ret;
+}
+
+// Get the HP port master device the AXI ID belongs to
+static struct master_device *get_port_master(u16 axi_id){
+  u8 i;
+
+  for(i = TBU3; i <= TBU5; i++){
+    if((axi_id & master_device_list[i].mask) == master_device_list[i].id)
+      return &master_device_list[i];
+  }
+  return NULL;
+}
+
+static struct master_device *get_soft_master(unsigned int rcpu){
+  u8 i;
+
+  for(i = 0; i < NR_SOFT_MASTERS; i++){
+    if(soft_master_list[i].used && soft_master_list[i].rcpu_id == rcpu)
+      return &soft_master_list[i].dev;
+  }
+  return NULL;
+}
+
+/*
+ * Allocate the master device of a soft-core from the AXI ID/mask of its rCPU
+ * device. The XMPU channels are the ones of the HP port the soft-core is
+ * attached to. *dev stays NULL for a soft-core without AXI ID, which is not
+ * protected. Returns 0 or a negative error code.
+ */
+static int alloc_soft_master(struct cell *cell, unsigned int rcpu,
+                             struct master_device **dev){
+  const struct jailhouse_rcpu_device *rcpu_dev;
+  struct master_device *port;
+  unsigned int n;
+  u8 i;
+
+  *dev = NULL;
+
+  rcpu_dev = jailhouse_cell_rcpu_devices(cell->config);
+  for(n = 0; n < cell->config->num_rcpu_devices; n++, rcpu_dev++){
+    if(rcpu_dev->rcpu_id == rcpu)
+      break;
+  }
+  if(n == cell->config->num_rcpu_devices || rcpu_dev->axi_mask == 0){
+    xmpu_print("Soft-core %d has no AXI ID, not protected\n\r", rcpu);
+    return 0;
+  }
+
+  port = get_port_master(rcpu_dev->axi_id);
+  if(!port){
+    xmpu_print("Error: soft-core %d AXI ID 0x%04x not on an HP port\n\r", rcpu, rcpu_dev->axi_id);
+    return -EINVAL;
+  }
+  // A root cell region of the port would still match the soft-core ID
+  if(get_master_owner(port) == &root_cell){
+    xmpu_print("Error: HP port of soft-core %d owned by the root cell\n\r", rcpu);
+    return -EBUSY;
+  }
+
+  for(i = 0; i < NR_SOFT_MASTERS; i++){
+    if(soft_master_list[i].used)
+      continue;
+    soft_master_list[i].rcpu_id = rcpu;
+    soft_master_list[i].used = true;
+    memset(&soft_master_list[i].dev, 0, sizeof(soft_master_list[i].dev));
+    soft_master_list[i].dev.id = rcpu_dev->axi_id;
+    soft_master_list[i].dev.mask = rcpu_dev->axi_mask;
+    soft_master_list[i].dev.xmpu_dev_mask = port->xmpu_dev_mask;
+    *dev = &soft_master_list[i].dev;
+    return 0;
+  }
+
+  xmpu_print("Error: no free soft-core master\n\r");
+  return -ENOMEM;
+}
 
-  if(cell->config->fpga_regions_size != 0){ 
+static void free_soft_master(unsigned int rcpu){
+  u8 i;
+
+  for(i = 0; i < NR_SOFT_MASTERS; i++){
+    if(soft_master_list[i].used && soft_master_list[i].rcpu_id == rcpu)
+      soft_master_list[i].used = false;
+  }
+}
+
+// Get the master device behind an FPGA region, NULL if the region is not valid
+static struct master_device *get_fpga_master(unsigned int fpga_region){
+  switch (fpga_region)
+  {
+    case 0:
+      return &master_device_list[TBU3];
+    case 1:
+      return &master_device_list[TBU4];
+    case 2:
+      return &master_device_list[TBU5];
+    default:
+      return NULL;
+  }
+}
+
+/*
+ * Give the master devices of the cell back to the root cell. Only the first
+ * num_fpga FPGA regions and num_rcpus rCPUs of the cell are released, so that
+ * a partially failed arm_xmpu_cell_init can be unwound. Soft-cores are
+ * freed, the root cell has no region for them. Caller holds xmpu_lock.
+ */
+static void release_cell_masters(struct cell *cell, unsigned int num_fpga,
+                                 unsigned int num_rcpus){
+  struct master_device *dev;
+  unsigned int rcpu, fpga_region;
+
+  if(cell->config->fpga_regions_size != 0){
     /* 
     * Non-Secure transactions coming from the FPGA are protected by the SMMU
     * Secure transactions are protected only by the XMPU
     */
     for_each_region(fpga_region, cell->fpga_region_set){
-      switch (fpga_region)
-      {
-        case 0:
-          dev = &master_device_list[TBU3];
-          break;
-        case 1:
-          dev = &master_device_list[TBU4];
-          break;
-        case 2:
-          dev = &master_device_list[TBU5];
-          break;
-        default:
-          xmpu_print("Error: FPGA region not valid\n\r");
-          continue;
+      if(num_fpga-- == 0)
+        break;
+      dev = get_fpga_master(fpga_region);
+      if(!dev){
+        xmpu_print("Error: FPGA region not valid\n\r");
+        continue;
       }
 
       clean_cell_permissions(dev, cell->config->id);
       set_cell_permissions(dev, &root_cell);
+      flush_released_regions(dev);
     }
   }
 
   if(cell->config->rcpu_set_size != 0){
-
     for_each_cpu(rcpu, cell->rcpu_set) {
+      if(num_rcpus-- == 0)
+        break;
       switch (rcpu)
       {
         case 0:
@@ -603,44 +992,63 @@ static void arm_xmpu_cell_exit(struct cell *cell){
           dev = &master_device_list[RPU1];
           break;
         default:
-          continue; // skip soft-core for now
+          // soft-core, the root cell has no region for it
+          dev = get_soft_master(rcpu);
+          if(!dev)
+            continue;
+          clean_cell_permissions(dev, cell->config->id);
+          flush_released_regions(dev);
+          free_soft_master(rcpu);
+          continue;
       }
 
       clean_cell_permissions(dev, cell->config->id);
       set_cell_permissions(dev, &root_cell);
+      flush_released_regions(dev);
     }
-  } 
+  }
+}
+
+static void arm_xmpu_cell_exit(struct cell *cell){
+  xmpu_print("Removing XMPU permissions for cell %d\n\r", cell->config->id);
+
+  spin_lock(&xmpu_lock);
+  release_cell_masters(cell, ~0U, ~0U);
+  spin_unlock(&xmpu_lock);
 }
 
 static int arm_xmpu_cell_init(struct cell *cell){
   struct master_device *dev;
 	unsigned int rcpu, fpga_region;
+  unsigned int num_fpga = 0, num_rcpus = 0;
+  int err = 0;
   xmpu_print("Setting XMPU permissions for cell %d\n\r", cell->config->id);
-  
+
+  cell->arch.xmpu_violations = 0;
+  memset(cell->arch.boot_stamps, 0, sizeof(cell->arch.boot_stamps));
+  cell->arch.boot_stamps[JAILHOUSE_BOOT_STAMP_XMPU_BEGIN] = timer_get_ticks();
+
+  spin_lock(&xmpu_lock);
+
   if(cell->config->fpga_regions_size > 0){
     /* 
     * Non-Secure transactions coming from the FPGA are protected by the SMMU
     * Secure transactions are protected only by the XMPU
     */
     for_each_region(fpga_region, cell->fpga_region_set){
-      switch (fpga_region)
-      {
-        case 0:
-          dev = &master_device_list[TBU3];
-          break;
-        case 1:
-          dev = &master_device_list[TBU4];
-          break;
-        case 2:
-          dev = &master_device_list[TBU5];
-          break;
-        default:
-          xmpu_print("Error: FPGA region not valid\n\r");
-          return -1;
+      dev = get_fpga_master(fpga_region);
+      if(!dev){
+        xmpu_print("Error: FPGA region not valid\n\r");
+        err = -EINVAL;
+        goto unwind;
       }
       // Clean region used by root-cell and set the permissions for the cell
       clean_cell_permissions(dev, root_cell.config->id);
-      set_cell_permissions(dev, cell);
+      num_fpga++;
+      err = set_cell_permissions(dev, cell);
+      flush_released_regions(dev);
+      if(err)
+        goto unwind;
     }
   }
 
@@ -655,16 +1063,39 @@ static int arm_xmpu_cell_init(struct cell *cell){
           dev = &master_device_list[RPU1];
           break;
         default:
-          // TODO: Daniele Ottaviano, fine grained management of soft-core permissions
-          continue; // soft-core, not supported yet
+          // soft-core, protected through its own AXI ID
+          err = alloc_soft_master(cell, rcpu, &dev);
+          if(err)
+            goto unwind;
+          num_rcpus++;
+          if(!dev)
+            continue;
+          err = set_cell_permissions(dev, cell);
+          if(err)
+            goto unwind;
+          continue;
       }
       // Clean region used by root-cell and set the permissions for the cell
       clean_cell_permissions(dev, root_cell.config->id);
-      set_cell_permissions(dev, cell);
+      num_rcpus++;
+      err = set_cell_permissions(dev, cell);
+      flush_released_regions(dev);
+      if(err)
+        goto unwind;
     }
   }
 
+  spin_unlock(&xmpu_lock);
+
+  cell->arch.boot_stamps[JAILHOUSE_BOOT_STAMP_XMPU_END] = timer_get_ticks();
+
   return 0;
+
+unwind:
+  // cell_exit is not called for a unit that failed its cell_init
+  release_cell_masters(cell, num_fpga, num_rcpus);
+  spin_unlock(&xmpu_lock);
+  return err;
 }
 
 // Config the XMPU to its default values
@@ -672,8 +1103,13 @@ static void arm_xmpu_shutdown(void){
   u8 i = 0;
   xmpu_print("Resetting XMPU to default values\n\r");
 
+  // Disable violation interrupts
+  xmpu_irq_enable(false);
+
   // Set to default values
   for(i=0 ; i<NR_XMPU; i++){
+    xmpu_write32((void *)(XMPU_IDS_REGISTER(xmpu_device[i].base_addr)), XMPU_IRQ_ALL);
+    xmpu_write32((void *)(XMPU_ISR_REGISTER(xmpu_device[i].base_addr)), XMPU_IRQ_ALL);
     set_xmpu_default(&xmpu_device[i]);
   }
 }
@@ -697,6 +1133,13 @@ static int arm_xmpu_init(void){
     poison_xmpu_status(&xmpu_device[i]);
   }
 
+  // Clear stale violations and enable the violation interrupts
+  for(i=0 ;  i<NR_XMPU; i++){
+    xmpu_write32((void *)(XMPU_ISR_REGISTER(xmpu_device[i].base_addr)), XMPU_IRQ_ALL);
+    xmpu_write32((void *)(XMPU_IEN_REGISTER(xmpu_device[i].base_addr)), XMPU_IRQ_ALL);
+  }
+  xmpu_irq_enable(true);
+
   return 0;
 }
 
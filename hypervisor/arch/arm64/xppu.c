@@ -0,0 +1,298 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Zynqmp XPPU management for asymmetric cores peripheral protection
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#include <jailhouse/printk.h>
+#include <jailhouse/unit.h>
+#include <jailhouse/control.h>
+#include <jailhouse/string.h>
+#include <asm/xmpu-board.h>
+
+#if defined(CONFIG_XPPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+
+#ifdef CONFIG_DEBUG
+#define xppu_print(fmt, ...)			\
+	printk("[XPPU] " fmt, ##__VA_ARGS__)
+#else
+#define xppu_print(fmt, ...) do { } while (0)
+#endif
+
+/* XPPU configuration register offsets, see XPPU_BASE_ADDR */
+#define XPPU_CTRL_OFFSET          0x000U
+#define XPPU_MASTER_ID_OFFSET     0x100U
+#define XPPU_APERPERM_OFFSET      0x1000U
+
+#define XPPU_CTRL_REGISTER              ((void *)(u64)(XPPU_BASE_ADDR + XPPU_CTRL_OFFSET))
+#define XPPU_MASTER_ID_REGISTER(n)      ((void *)(u64)(XPPU_BASE_ADDR + XPPU_MASTER_ID_OFFSET + (n) * 4))
+#define XPPU_APERPERM_REGISTER(n)       ((void *)(u64)(XPPU_BASE_ADDR + XPPU_APERPERM_OFFSET + (n) * 4))
+
+/* XPPU control register fields */
+#define XPPU_CTRL_ENABLE          (1U << 0)
+
+/* Master ID register fields */
+#define XPPU_MASTER_ID(id, mask)  ((((mask) & 0x3FFU) << 16) | ((id) & 0x3FFU))
+#define NR_XPPU_MASTER_IDS        20
+
+/* Aperture permission entry fields */
+#define XPPU_APERPERM_MASTERS     0x000FFFFFU
+#define XPPU_APERPERM_TZ          (1U << 27)  // allow non-secure transactions
+
+/* Aperture permission table layout */
+#define XPPU_APER_64KB_BASE       0xFF000000UL
+#define XPPU_APER_64KB_FIRST      0
+#define XPPU_APER_64KB_COUNT      256
+#define XPPU_APER_32B_BASE        0xFF990000UL
+#define XPPU_APER_32B_FIRST       256
+#define XPPU_APER_32B_COUNT       128
+#define XPPU_APER_1MB_BASE        0xFE000000UL
+#define XPPU_APER_1MB_FIRST       384
+#define XPPU_APER_1MB_COUNT       16
+#define XPPU_APER_512MB_BASE      0xC0000000UL
+#define XPPU_APER_512MB_FIRST     400
+#define XPPU_APER_512MB_COUNT     1
+#define NR_XPPU_APERTURES         401
+
+/*
+ * Master ID list slots programmed by Jailhouse.
+ * FPGA masters use the lower 10 bits of the HP ports IDs used by the XMPU unit.
+ */
+#define XPPU_APU                  0   /* APU ( 0010, xx, xxxx ) */
+#define XPPU_LPD                  1   /* PMU, CSU, LPD DMA, ... ( 0001, xx, xxxx ) */
+#define XPPU_RPU0                 2   /* RPU0 ( 0000, 00, xxxx ) */
+#define XPPU_RPU1                 3   /* RPU1 ( 0000, 01, xxxx ) */
+#define XPPU_HP0                  4   /* HP0 ( 1010, xx, xxxx ) */
+#define XPPU_HP1                  5   /* HP1/HP2 ( 1000, xx, xxxx ) */
+#define XPPU_HP3                  6   /* HP3 ( 1101, xx, xxxx ) */
+
+// Masters that keep access to every aperture, their isolation is not up to the XPPU
+#define XPPU_SYSTEM_MASTERS       ((1U << XPPU_APU) | (1U << XPPU_LPD))
+
+typedef struct xppu_aperture_range{
+  u64 base;
+  u64 size;
+  u16 first;
+  u16 count;
+}xppu_aperture_range;
+
+static const u32 xppu_master_ids[] = {
+  [XPPU_APU]  = XPPU_MASTER_ID(0x0080, 0x03C0),
+  [XPPU_LPD]  = XPPU_MASTER_ID(0x0040, 0x03C0),
+  [XPPU_RPU0] = XPPU_MASTER_ID(0x0000, 0x03F0),
+  [XPPU_RPU1] = XPPU_MASTER_ID(0x0010, 0x03F0),
+  [XPPU_HP0]  = XPPU_MASTER_ID(0x0280, 0x03C0),
+  [XPPU_HP1]  = XPPU_MASTER_ID(0x0200, 0x03C0),
+  [XPPU_HP3]  = XPPU_MASTER_ID(0x0340, 0x03C0),
+};
+#define NR_XPPU_MASTERS (sizeof(xppu_master_ids)/sizeof(xppu_master_ids[0]))
+
+static const xppu_aperture_range xppu_ranges[] = {
+  { XPPU_APER_64KB_BASE,  0x10000,    XPPU_APER_64KB_FIRST,  XPPU_APER_64KB_COUNT  },
+  { XPPU_APER_32B_BASE,   0x20,       XPPU_APER_32B_FIRST,   XPPU_APER_32B_COUNT   },
+  { XPPU_APER_1MB_BASE,   0x100000,   XPPU_APER_1MB_FIRST,   XPPU_APER_1MB_COUNT   },
+  { XPPU_APER_512MB_BASE, 0x20000000, XPPU_APER_512MB_FIRST, XPPU_APER_512MB_COUNT },
+};
+#define NR_XPPU_RANGES (sizeof(xppu_ranges)/sizeof(xppu_ranges[0]))
+
+/* Permission table as programmed in the XPPU, the one being built, and the one found at init */
+static u32 xppu_perm[NR_XPPU_APERTURES];
+static u32 xppu_next[NR_XPPU_APERTURES];
+static u32 xppu_saved[NR_XPPU_APERTURES];
+static u32 xppu_saved_master_ids[NR_XPPU_MASTER_IDS];
+static u32 xppu_saved_ctrl;
+// Apertures assigned to a non-root cell in xppu_next
+static bool xppu_claimed[NR_XPPU_APERTURES];
+
+// Get the XPPU masters of the rCPUs and FPGA regions of the cell
+static u32 get_cell_masters(struct cell *cell){
+  unsigned int rcpu, fpga_region;
+  u32 masters = 0;
+
+  if(cell->config->rcpu_set_size != 0){
+    for_each_cpu(rcpu, cell->rcpu_set){
+      if(rcpu == 0)
+        masters |= (1U << XPPU_RPU0);
+      else if(rcpu == 1)
+        masters |= (1U << XPPU_RPU1);
+      // soft-core, not supported yet
+    }
+  }
+
+  if(cell->config->fpga_regions_size != 0){
+    for_each_region(fpga_region, cell->fpga_region_set){
+      if(fpga_region == 0)
+        masters |= (1U << XPPU_HP0);
+      else if(fpga_region == 1)
+        masters |= (1U << XPPU_HP1);
+      else if(fpga_region == 2)
+        masters |= (1U << XPPU_HP3);
+    }
+  }
+
+  return masters;
+}
+
+/*
+ * Allow the masters on all apertures overlapping the memory region.
+ * Apertures of non-root cells are exclusive unless shared with the root cell:
+ * the root cell masters are only added to the apertures not claimed by any
+ * other cell.
+ */
+static void allow_mem_region(const struct jailhouse_memory *mem, u32 masters, bool root){
+  const xppu_aperture_range *range;
+  bool exclusive = !root && !(mem->flags & JAILHOUSE_MEM_ROOTSHARED);
+  u64 start, end;
+  u16 first, last, n;
+  u8 i;
+
+  if(mem->flags & JAILHOUSE_MEM_COMM_REGION)
+    return;
+
+  for(i = 0; i < NR_XPPU_RANGES; i++){
+    range = &xppu_ranges[i];
+    start = mem->phys_start;
+    end = mem->phys_start + mem->size;
+
+    if(end <= range->base || start >= range->base + range->size * range->count)
+      continue;
+
+    if(start < range->base)
+      start = range->base;
+    if(end > range->base + range->size * range->count)
+      end = range->base + range->size * range->count;
+
+    first = range->first + (start - range->base) / range->size;
+    last = range->first + (end - 1 - range->base) / range->size;
+    for(n = first; n <= last; n++){
+      if(root && xppu_claimed[n])
+        continue;
+      if(exclusive && !xppu_claimed[n]){
+        xppu_claimed[n] = true;
+        xppu_next[n] = XPPU_SYSTEM_MASTERS;
+      }
+      xppu_next[n] |= masters;
+    }
+  }
+}
+
+/*
+ * Build the permission table for the current cell set.
+ * At cell_init the new cell is not yet linked and the root cell still owns
+ * its masters, at cell_exit the cell is still linked but its masters are
+ * already back to the root cell.
+ */
+static void xppu_build_table(struct cell *added, struct cell *removed){
+  const struct jailhouse_memory *mem;
+  struct cell *cell;
+  u32 root_masters;
+  unsigned int n;
+
+  root_masters = get_cell_masters(&root_cell);
+  if(added)
+    root_masters &= ~get_cell_masters(added);
+
+  for(n = 0; n < NR_XPPU_APERTURES; n++){
+    xppu_next[n] = XPPU_SYSTEM_MASTERS;
+    xppu_claimed[n] = false;
+  }
+
+  // Non-root cells first, their apertures are exclusive
+  for_each_non_root_cell(cell){
+    if(cell == removed)
+      continue;
+    for_each_mem_region(mem, cell->config, n)
+      allow_mem_region(mem, get_cell_masters(cell), false);
+  }
+  if(added){
+    for_each_mem_region(mem, added->config, n)
+      allow_mem_region(mem, get_cell_masters(added), false);
+  }
+
+  for_each_mem_region(mem, root_cell.config, n)
+    allow_mem_region(mem, root_masters, true);
+
+  for(n = 0; n < NR_XPPU_APERTURES; n++)
+    xppu_next[n] |= XPPU_APERPERM_TZ;
+}
+
+// Write the entries of the built table that differ from the programmed one
+static void xppu_flush_table(bool force){
+  unsigned int n, written = 0;
+
+  for(n = 0; n < NR_XPPU_APERTURES; n++){
+    if(!force && xppu_perm[n] == xppu_next[n])
+      continue;
+    xmpu_write32(XPPU_APERPERM_REGISTER(n), xppu_next[n]);
+    xppu_perm[n] = xppu_next[n];
+    written++;
+  }
+
+  xppu_print("%u aperture entries updated\n\r", written);
+}
+
+static int arm_xppu_cell_init(struct cell *cell){
+  xppu_print("Setting XPPU permissions for cell %d\n\r", cell->config->id);
+
+  xppu_build_table(cell, NULL);
+  xppu_flush_table(false);
+
+  return 0;
+}
+
+static void arm_xppu_cell_exit(struct cell *cell){
+  xppu_print("Removing XPPU permissions for cell %d\n\r", cell->config->id);
+
+  xppu_build_table(NULL, cell);
+  xppu_flush_table(false);
+}
+
+// Restore the XPPU configuration found at init
+static void arm_xppu_shutdown(void){
+  unsigned int n;
+
+  xppu_print("Restoring XPPU configuration\n\r");
+
+  xmpu_write32(XPPU_CTRL_REGISTER, xppu_saved_ctrl & ~XPPU_CTRL_ENABLE);
+  for(n = 0; n < NR_XPPU_MASTER_IDS; n++)
+    xmpu_write32(XPPU_MASTER_ID_REGISTER(n), xppu_saved_master_ids[n]);
+  memcpy(xppu_next, xppu_saved, sizeof(xppu_next));
+  xppu_flush_table(false);
+  xmpu_write32(XPPU_CTRL_REGISTER, xppu_saved_ctrl);
+}
+
+static int arm_xppu_init(void){
+  unsigned int n;
+
+  // Save the configuration of the boot firmware
+  xppu_saved_ctrl = xmpu_read32(XPPU_CTRL_REGISTER);
+  for(n = 0; n < NR_XPPU_MASTER_IDS; n++)
+    xppu_saved_master_ids[n] = xmpu_read32(XPPU_MASTER_ID_REGISTER(n));
+  for(n = 0; n < NR_XPPU_APERTURES; n++)
+    xppu_saved[n] = xmpu_read32(XPPU_APERPERM_REGISTER(n));
+
+  // Program the master ID list, unused slots are never granted any aperture
+  xmpu_write32(XPPU_CTRL_REGISTER, xppu_saved_ctrl & ~XPPU_CTRL_ENABLE);
+  for(n = 0; n < NR_XPPU_MASTER_IDS; n++)
+    xmpu_write32(XPPU_MASTER_ID_REGISTER(n),
+                 n < NR_XPPU_MASTERS ? xppu_master_ids[n] : 0);
+
+  // Program the whole table for the root cell, then enable the XPPU
+  xppu_build_table(NULL, NULL);
+  xppu_flush_table(true);
+  xmpu_write32(XPPU_CTRL_REGISTER, XPPU_CTRL_ENABLE);
+
+  return 0;
+}
+
+DEFINE_UNIT_MMIO_COUNT_REGIONS_STUB(arm_xppu);
+DEFINE_UNIT(arm_xppu, "ARM XPPU");
+#endif /* CONFIG_XPPU_ACTIVE && CONFIG_MACH_ZYNQMP_ZCU102 */
@@ -13,6 +13,7 @@
 #ifndef _JAILHOUSE_ASM_PAGING_H
 #define _JAILHOUSE_ASM_PAGING_H
 
+#include <jailhouse/string.h>
 #include <jailhouse/types.h>
 #include <jailhouse/utils.h>
 #include <asm/processor.h>
@@ -59,6 +60,15 @@ static inline void arch_paging_flush_page_tlbs(unsigned long page_addr)
 	asm volatile("invlpg (%0)" : : "r" (page_addr));
 }
 
+static inline void arch_paging_flush_range_tlbs(unsigned long virt,
+						unsigned long size)
+{
+	unsigned long pages;
+
+	for (pages = PAGES(size); pages > 0; pages--, virt += PAGE_SIZE)
+		arch_paging_flush_page_tlbs(virt);
+}
+
 extern unsigned long cache_line_size;
 
 static inline void arch_paging_flush_cpu_caches(void *addr, long size)
@@ -67,6 +77,11 @@ static inline void arch_paging_flush_cpu_caches(void *addr, long size)
 		asm volatile("clflush %0" : "+m" (*(char *)addr));
 }
 
+static inline void arch_paging_zero_page(void *page)
+{
+	memset(page, 0, PAGE_SIZE);
+}
+
 #endif /* !__ASSEMBLY__ */
 
 #endif /* !_JAILHOUSE_ASM_PAGING_H */
@@ -0,0 +1,34 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor: time stamps of the statistics and the event trace
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef _JAILHOUSE_ASM_TICKS_H
+#define _JAILHOUSE_ASM_TICKS_H
+
+#include <jailhouse/control.h>
+
+/** Ticks of the time stamp counter. */
+static inline u64 arch_get_ticks(void)
+{
+	u32 lo, hi;
+
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((u64)hi << 32) | lo;
+}
+
+static inline u64 arch_get_ticks_hz(void)
+{
+	return system_config->platform_info.x86.tsc_khz * 1000ULL;
+}
+
+#endif /* !_JAILHOUSE_ASM_TICKS_H */
@@ -18,6 +18,7 @@
 #include <jailhouse/cell.h>
 #include <jailhouse/cell-config.h>
 #include <jailhouse/control.h>
+#include <jailhouse/latency.h>
 #include <jailhouse/paging.h>
 #include <jailhouse/printk.h>
 #include <jailhouse/panic.h>
@@ -870,8 +871,10 @@ unsigned long vcpu_vendor_get_guest_cr4(void)
 void vcpu_handle_exit(struct per_cpu *cpu_data)
 {
 	struct public_per_cpu *cpu_public = &cpu_data->public;
+	u64 start = exit_latency_start();
 	struct vmcb *vmcb = &cpu_data->vmcb;
 	bool res = false;
+	int kind = -1;
 
 	vmcb->gs.base = read_msr(MSR_GS_BASE);
 
@@ -892,22 +895,27 @@ void vcpu_handle_exit(struct per_cpu *cpu_data)
 		break;
 	case VMEXIT_NMI:
 		cpu_public->stats[JAILHOUSE_CPU_STAT_VMEXITS_MANAGEMENT]++;
+		kind = JAILHOUSE_EXIT_MANAGEMENT;
 		/* Temporarily enable GIF to consume pending NMI */
 		asm volatile("stgi; clgi" : : : "memory");
 		x86_check_events();
 		goto vmentry;
 	case VMEXIT_VMMCALL:
+		kind = JAILHOUSE_EXIT_HYPERCALL;
 		vcpu_handle_hypercall();
 		goto vmentry;
 	case VMEXIT_CR0_SEL_WRITE:
 		cpu_public->stats[JAILHOUSE_CPU_STAT_VMEXITS_CR]++;
+		kind = JAILHOUSE_EXIT_SYSREG;
 		if (svm_handle_cr(cpu_data))
 			goto vmentry;
 		break;
 	case VMEXIT_CPUID:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		vcpu_handle_cpuid();
 		goto vmentry;
 	case VMEXIT_MSR:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		if (!vmcb->exitinfo1)
 			res = vcpu_handle_msr_read();
 		else
@@ -916,6 +924,7 @@ void vcpu_handle_exit(struct per_cpu *cpu_data)
 			goto vmentry;
 		break;
 	case VMEXIT_NPF:
+		kind = JAILHOUSE_EXIT_MMIO;
 		if ((vmcb->exitinfo1 & 0x7) == 0x7 &&
 		     vmcb->exitinfo2 >= XAPIC_BASE &&
 		     vmcb->exitinfo2 < XAPIC_BASE + PAGE_SIZE) {
@@ -932,6 +941,7 @@ void vcpu_handle_exit(struct per_cpu *cpu_data)
 		break;
 	case VMEXIT_IOIO:
 		cpu_public->stats[JAILHOUSE_CPU_STAT_VMEXITS_PIO]++;
+		kind = JAILHOUSE_EXIT_MMIO;
 		if (vcpu_handle_io_access())
 			goto vmentry;
 		break;
@@ -957,6 +967,8 @@ void vcpu_handle_exit(struct per_cpu *cpu_data)
 	panic_park();
 
 vmentry:
+	if (kind >= 0)
+		exit_latency_account(kind, start);
 	write_msr(MSR_GS_BASE, vmcb->gs.base);
 }
 
@@ -13,6 +13,7 @@
  */
 
 #include <jailhouse/entry.h>
+#include <jailhouse/latency.h>
 #include <jailhouse/paging.h>
 #include <jailhouse/processor.h>
 #include <jailhouse/printk.h>
@@ -1149,62 +1150,75 @@ void vcpu_vendor_get_mmio_intercept(struct vcpu_mmio_intercept *mmio)
 
 void vcpu_handle_exit(struct per_cpu *cpu_data)
 {
+	u64 start = exit_latency_start();
 	u32 reason = vmcs_read32(VM_EXIT_REASON);
 	u32 *stats = cpu_data->public.stats;
+	int kind = -1;
 
 	stats[JAILHOUSE_CPU_STAT_VMEXITS_TOTAL]++;
 
 	switch (reason) {
 	case EXIT_REASON_EXCEPTION_NMI:
+		kind = JAILHOUSE_EXIT_MANAGEMENT;
 		vmx_handle_exception_nmi();
-		return;
+		goto vmentry;
 	case EXIT_REASON_PREEMPTION_TIMER:
+		kind = JAILHOUSE_EXIT_MANAGEMENT;
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_MANAGEMENT]++;
 		vmx_check_events();
-		return;
+		goto vmentry;
 	case EXIT_REASON_CPUID:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		vcpu_handle_cpuid();
-		return;
+		goto vmentry;
 	case EXIT_REASON_VMCALL:
+		kind = JAILHOUSE_EXIT_HYPERCALL;
 		vcpu_handle_hypercall();
-		return;
+		goto vmentry;
 	case EXIT_REASON_CR_ACCESS:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_CR]++;
 		if (vmx_handle_cr())
-			return;
+			goto vmentry;
 		break;
 	case EXIT_REASON_MSR_READ:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		if (vcpu_handle_msr_read())
-			return;
+			goto vmentry;
 		break;
 	case EXIT_REASON_MSR_WRITE:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		if (cpu_data->guest_regs.rcx == MSR_IA32_PERF_GLOBAL_CTRL) {
 			/* ignore writes */
 			stats[JAILHOUSE_CPU_STAT_VMEXITS_MSR_OTHER]++;
 			vcpu_skip_emulated_instruction(X86_INST_LEN_WRMSR);
-			return;
+			goto vmentry;
 		} else if (vcpu_handle_msr_write())
-			return;
+			goto vmentry;
 		break;
 	case EXIT_REASON_APIC_ACCESS:
+		kind = JAILHOUSE_EXIT_MMIO;
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_XAPIC]++;
 		if (vmx_handle_apic_access())
-			return;
+			goto vmentry;
 		break;
 	case EXIT_REASON_XSETBV:
+		kind = JAILHOUSE_EXIT_SYSREG;
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_XSETBV]++;
 		if (vmx_handle_xsetbv())
-			return;
+			goto vmentry;
 		break;
 	case EXIT_REASON_IO_INSTRUCTION:
+		kind = JAILHOUSE_EXIT_MMIO;
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_PIO]++;
 		if (vcpu_handle_io_access())
-			return;
+			goto vmentry;
 		break;
 	case EXIT_REASON_EPT_VIOLATION:
+		kind = JAILHOUSE_EXIT_MMIO;
 		stats[JAILHOUSE_CPU_STAT_VMEXITS_MMIO]++;
 		if (vcpu_handle_mmio_access())
-			return;
+			goto vmentry;
 		break;
 	default:
 		panic_printk("FATAL: %s, reason %d\n",
@@ -1216,6 +1230,10 @@ void vcpu_handle_exit(struct per_cpu *cpu_data)
 	}
 	dump_guest_regs(&cpu_data->guest_regs);
 	panic_park();
+
+vmentry:
+	if (kind >= 0)
+		exit_latency_account(kind, start);
 }
 
 void vmx_entry_failure(void)
@@ -17,11 +17,13 @@
  */
 #include <jailhouse/entry.h>
 #include <jailhouse/control.h>
+#include <jailhouse/latency.h>
 #include <jailhouse/mmio.h>
 #include <jailhouse/printk.h>
 #include <jailhouse/paging.h>
 #include <jailhouse/processor.h>
 #include <jailhouse/string.h>
+#include <jailhouse/trace.h>
 #include <jailhouse/unit.h>
 #include <jailhouse/utils.h>
 #include <jailhouse/memguard.h>
@@ -33,10 +35,14 @@
 /* QoS Support only provided on arm64 */
 #include <asm/qos.h>
 #endif
+#if defined(CONFIG_XMPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+#include <asm/xmpu.h>
+#endif
 
 enum msg_type {MSG_REQUEST, MSG_INFORMATION};
 enum failure_mode {ABORT_ON_ERROR, WARN_ON_ERROR};
-enum management_task {CELL_START, CELL_SET_LOADABLE, CELL_DESTROY};
+enum management_task {CELL_START, CELL_SET_LOADABLE, CELL_DESTROY,
+		      CELL_RCPU_RESTART, CELL_RCPU_RESTART_END};
 
 /** System configuration as used while activating the hypervisor. */
 struct jailhouse_system *system_config;
@@ -44,6 +50,7 @@ struct jailhouse_system *system_config;
 struct cell root_cell;
 
 static spinlock_t shutdown_lock;
+static spinlock_t param_page_lock;
 static unsigned int num_cells = 1;
 
 volatile unsigned long panic_in_progress;
@@ -181,14 +188,17 @@ static void cell_suspend(struct cell *cell)
 {
 	unsigned int cpu;
 
+	trace_begin(JAILHOUSE_TRACE_CELL_SUSPEND, cell->config->id);
 	for_each_cpu_except(cpu, cell->cpu_set, this_cpu_id())
 		suspend_cpu(cpu);
+	trace_end(JAILHOUSE_TRACE_CELL_SUSPEND, cell->config->id);
 }
 
 static void cell_resume(struct cell *cell)
 {
 	unsigned int cpu;
 
+	trace_instant(JAILHOUSE_TRACE_CELL_RESUME, cell->config->id);
 	for_each_cpu_except(cpu, cell->cpu_set, this_cpu_id())
 		resume_cpu(cpu);
 }
@@ -385,6 +395,17 @@ static bool address_in_region(unsigned long addr,
 	       addr < (region->phys_start + region->size);
 }
 
+static void param_page_release(struct cell *cell)
+{
+	if (!cell->param_page)
+		return;
+
+	paging_destroy(&hv_paging_structs, (unsigned long)cell->param_page,
+		       PAGE_SIZE, PAGING_NON_COHERENT);
+	page_free(&remap_pool, cell->param_page, 1);
+	cell->param_page = NULL;
+}
+
 static int unmap_from_root_cell(const struct jailhouse_memory *mem, bool create)
 {
 	/*
@@ -396,6 +417,14 @@ static int unmap_from_root_cell(const struct jailhouse_memory *mem, bool create)
 
 	tmp.virt_start = tmp.phys_start;
 
+	/*
+	 * The root cell loses access to its parameter page, drop it. Its CPUs
+	 * are suspended, none is using the page.
+	 */
+	if (root_cell.param_page &&
+	    address_in_region(root_cell.param_page_phys, mem))
+		param_page_release(&root_cell);
+
 	if (JAILHOUSE_MEMORY_IS_SUBPAGE(&tmp)) {
 		mmio_subpage_unregister(&root_cell, &tmp);
 		return 0;
@@ -463,6 +492,18 @@ static int remap_to_root_cell(const struct jailhouse_memory *mem,
 	return err;
 }
 
+/* The root cell may read the counters at any time, see is_cpu_export_page */
+static void cpu_stats_reset(struct public_per_cpu *cpu_public)
+{
+	cpu_public->stats_seq++;
+	memory_barrier();
+	memset(cpu_public->stats, 0, sizeof(cpu_public->stats));
+	memory_barrier();
+	cpu_public->stats_seq++;
+
+	memset(cpu_public->exit_latency, 0, sizeof(cpu_public->exit_latency));
+}
+
 static void cell_destroy_internal(struct cell *cell)
 {
 	const struct jailhouse_memory *mem;
@@ -473,14 +514,16 @@ static void cell_destroy_internal(struct cell *cell)
 
 	cell->comm_page.comm_region.cell_state = JAILHOUSE_CELL_SHUT_DOWN;
 
+	param_page_release(cell);
+
 	for_each_cpu(cpu, cell->cpu_set) {
 		arch_park_cpu(cpu);
 
 		set_bit(cpu, root_cell.cpu_set->bitmap);
 		public_per_cpu(cpu)->cell = &root_cell;
 		public_per_cpu(cpu)->failed = false;
-		memset(public_per_cpu(cpu)->stats, 0,
-		       sizeof(public_per_cpu(cpu)->stats));
+		cpu_stats_reset(public_per_cpu(cpu));
+		mmio_cache_flush(per_cpu(cpu));
 	}
 
 	// For each rCPU, power them off
@@ -649,8 +692,8 @@ static int cell_create(struct per_cpu *cpu_data, unsigned long config_address)
 
 		clear_bit(cpu, root_cell.cpu_set->bitmap);
 		public_per_cpu(cpu)->cell = cell;
-		memset(public_per_cpu(cpu)->stats, 0,
-		       sizeof(public_per_cpu(cpu)->stats));
+		cpu_stats_reset(public_per_cpu(cpu));
+		mmio_cache_flush(per_cpu(cpu));
 	}
 
 	// to do ... public per rcpu managment	
@@ -762,8 +805,12 @@ static int cell_management_prologue(enum management_task task,
 		return -EINVAL;
 	}
 
+	/*
+	 * The end of an rCPU restart completes a request already approved,
+	 * cell_rcpu_restart checks that one is pending.
+	 */
 	if ((task == CELL_DESTROY && !cell_reconfig_ok(*cell_ptr)) ||
-	    !cell_shutdown_ok(*cell_ptr)) {
+	    (task != CELL_RCPU_RESTART_END && !cell_shutdown_ok(*cell_ptr))) {
 		cell_resume(&root_cell);
 		return -EPERM;
 	}
@@ -901,6 +948,109 @@ out_resume:
 	return err;
 }
 
+/*
+ * Warm restart of the rCPUs of a running cell. Unlike set-loadable/start,
+ * the cell keeps its CPUs, comm region and unit state (e.g. XMPU regions);
+ * only the PM power-down/wake-up of its rCPUs is permitted to the root cell
+ * once more and, optionally, the loadable regions are lent to the root cell
+ * until the restart is finished.
+ */
+static int cell_rcpu_restart(struct per_cpu *cpu_data, unsigned long id,
+			     unsigned long cmd)
+{
+	const struct jailhouse_memory *mem;
+	unsigned int rcpu, n;
+	struct cell *cell;
+	u32 cell_state;
+	int err;
+
+	err = cell_management_prologue(cmd == JAILHOUSE_RCPU_RESTART_END ||
+				       cmd == JAILHOUSE_RCPU_RESTART_END_FAILED ?
+				       CELL_RCPU_RESTART_END :
+				       CELL_RCPU_RESTART,
+				       cpu_data, id, &cell);
+	if (err)
+		return err;
+
+	if (cell->config->rcpu_set_size == 0) {
+		err = -EINVAL;
+		goto out_resume;
+	}
+
+	switch (cmd) {
+	case JAILHOUSE_RCPU_RESTART_BEGIN:
+	case JAILHOUSE_RCPU_RESTART_BEGIN_RELOAD:
+		for_each_cpu(rcpu, cell->rcpu_set)
+			enable_rcpu_start(rcpu);
+		cell->rcpu_restarting = true;
+
+		if (cmd == JAILHOUSE_RCPU_RESTART_BEGIN || cell->loadable)
+			break;
+
+		for_each_mem_region(mem, cell->config, n)
+			if (mem->flags & JAILHOUSE_MEM_LOADABLE) {
+				err = remap_to_root_cell(mem, ABORT_ON_ERROR);
+				if (err)
+					goto out_resume;
+			}
+		config_commit(NULL);
+		cell->loadable = true;
+		break;
+	case JAILHOUSE_RCPU_RESTART_END:
+	case JAILHOUSE_RCPU_RESTART_END_FAILED:
+		if (!cell->rcpu_restarting) {
+			err = -EINVAL;
+			goto out_resume;
+		}
+		cell->rcpu_restarting = false;
+
+		/*
+		 * The cell reported itself shut down when approving the
+		 * restart, its rCPUs are about to run again. A cell that
+		 * failed in the meantime stays failed. The root cell reports
+		 * a restart it could not complete, leaving the rCPUs halted,
+		 * as failure as well.
+		 */
+		cell_state = cell->comm_page.comm_region.cell_state;
+		if (cmd == JAILHOUSE_RCPU_RESTART_END_FAILED)
+			cell->comm_page.comm_region.cell_state =
+				JAILHOUSE_CELL_FAILED;
+		else if (cell_state != JAILHOUSE_CELL_FAILED &&
+			 cell_state != JAILHOUSE_CELL_FAILED_COMM_REV)
+			cell->comm_page.comm_region.cell_state =
+				JAILHOUSE_CELL_RUNNING;
+		cell->comm_page.comm_region.msg_to_cell = JAILHOUSE_MSG_NONE;
+		cell->comm_page.comm_region.reply_from_cell =
+			JAILHOUSE_MSG_NONE;
+
+		if (!cell->loadable)
+			break;
+
+		for_each_mem_region(mem, cell->config, n)
+			if (mem->flags & JAILHOUSE_MEM_LOADABLE) {
+				err = unmap_from_root_cell(mem, false);
+				if (err)
+					goto out_resume;
+			}
+		config_commit(NULL);
+		cell->loadable = false;
+		break;
+	default:
+		err = -EINVAL;
+		goto out_resume;
+	}
+
+	printk("Cell \"%s\" rCPU restart %s\n", cell->config->name,
+	       cmd == JAILHOUSE_RCPU_RESTART_END ? "done" :
+	       cmd == JAILHOUSE_RCPU_RESTART_END_FAILED ? "failed" : "armed");
+
+out_resume:
+	cell_resume(cell);
+	cell_resume(&root_cell);
+
+	return err;
+}
+
 static int cell_destroy(struct per_cpu *cpu_data, unsigned long id)
 {
 	struct cell *cell, *previous;
@@ -990,6 +1140,9 @@ void shutdown(void)
 	 * because of that, we're doomed anyway.
 	 */
 	color_copy_root(&root_cell, false);
+
+	/* Leave no data of destroyed cells behind in the hypervisor memory. */
+	page_scrub(&mem_pool, ~0UL);
 }
 
 static int hypervisor_disable(struct per_cpu *cpu_data)
@@ -1126,21 +1279,162 @@ static int cpu_get_info(struct per_cpu *cpu_data, unsigned long cpu_id,
 }
 
 /**
- * Handle hypercall invoked by a cell.
- * @param code		Hypercall code.
- * @param arg1		First hypercall argument.
- * @param arg2		Seconds hypercall argument.
+ * Copy the VM exit latency histograms of a CPU to the calling cell.
+ * @param cpu_data	Data structure of the calling CPU.
+ * @param cpu_id	ID of the CPU to be queried.
+ * @param latency_ptr	Guest-physical address of a struct
+ * 			jailhouse_exit_latency in the calling cell.
  *
- * @return Value that shall be passed to the caller of the hypercall on return.
+ * The CPU keeps on updating its histograms meanwhile, so the copy is not an
+ * atomic snapshot.
  *
- * @note If @c arg1 and @c arg2 are valid depends on the hypercall code.
+ * @return 0 on success, negative error code otherwise.
  */
-long hypercall(unsigned long code, unsigned long arg1, unsigned long arg2)
+static int cpu_get_exit_latency(struct per_cpu *cpu_data, unsigned long cpu_id,
+				unsigned long latency_ptr)
 {
-	struct per_cpu *cpu_data = this_cpu_data();
+	struct jailhouse_exit_latency *latency;
 
-	cpu_data->public.stats[JAILHOUSE_CPU_STAT_VMEXITS_HYPERCALL]++;
+	if (!cpu_id_valid(cpu_id))
+		return -EINVAL;
+
+	/* No explicit synchronization with cell_destroy needed, see above. */
+	if (cpu_data->public.cell != &root_cell &&
+	    !cell_owns_cpu(cpu_data->public.cell, cpu_id))
+		return -EPERM;
 
+	latency = hypercall_get_params(latency_ptr, sizeof(*latency),
+				       PAGE_DEFAULT_FLAGS);
+	if (!latency)
+		return -ENOMEM;
+
+	latency->ticks_hz = arch_get_ticks_hz();
+	memcpy(latency->kinds, public_per_cpu(cpu_id)->exit_latency,
+	       sizeof(latency->kinds));
+
+	return 0;
+}
+
+/**
+ * Register the hypercall parameter page of the calling cell.
+ * @param cpu_data	Data structure of the calling CPU.
+ * @param address	Guest-physical address of the page.
+ *
+ * The page is mapped once into the hypervisor and stays there until the cell
+ * is destroyed or, for the root cell, until the memory backing it is handed
+ * over to another cell. It has to be readable and writable RAM the cell
+ * currently owns. Registering the same page again succeeds, so that the root
+ * cell can find out whether its page was dropped meanwhile.
+ *
+ * @return 0 on success, negative error code otherwise.
+ */
+static int param_page_register(struct per_cpu *cpu_data,
+			       unsigned long address)
+{
+	struct cell *cell = cpu_data->public.cell;
+	const struct jailhouse_memory *mem;
+	unsigned long phys;
+	unsigned int n;
+	void *page;
+
+	if (address & ~PAGE_MASK)
+		return trace_error(-EINVAL);
+
+	for_each_mem_region(mem, cell->config, n)
+		if (address >= mem->virt_start && mem->size >= PAGE_SIZE &&
+		    address - mem->virt_start <= mem->size - PAGE_SIZE)
+			break;
+	if (n == cell->config->num_memory_regions ||
+	    (mem->flags & (JAILHOUSE_MEM_READ | JAILHOUSE_MEM_WRITE)) !=
+	    (JAILHOUSE_MEM_READ | JAILHOUSE_MEM_WRITE) ||
+	    mem->flags & (JAILHOUSE_MEM_IO | JAILHOUSE_MEM_COMM_REGION |
+			  JAILHOUSE_MEM_COLORED))
+		return trace_error(-EINVAL);
+
+	/*
+	 * The configuration of the root cell still lists the memory of the
+	 * other cells, only its current mapping tells what it owns.
+	 */
+	phys = arch_paging_gphys2phys(address, PAGE_DEFAULT_FLAGS);
+	if (phys == INVALID_PHYS_ADDR)
+		return trace_error(-EINVAL);
+
+	if (cell->param_page)
+		return cell->param_page_phys == phys ? 0 : -EBUSY;
+
+	page = page_alloc(&remap_pool, 1);
+	if (!page)
+		return -ENOMEM;
+	if (paging_create(&hv_paging_structs, phys, PAGE_SIZE,
+			  (unsigned long)page, PAGE_DEFAULT_FLAGS,
+			  PAGING_NON_COHERENT | PAGING_NO_HUGE) != 0) {
+		page_free(&remap_pool, page, 1);
+		return -ENOMEM;
+	}
+
+	/*
+	 * Other CPUs of the cell may be using the page in a hypercall, so it is
+	 * never replaced.
+	 */
+	spin_lock(&param_page_lock);
+	if (cell->param_page) {
+		spin_unlock(&param_page_lock);
+		paging_destroy(&hv_paging_structs, (unsigned long)page,
+			       PAGE_SIZE, PAGING_NON_COHERENT);
+		page_free(&remap_pool, page, 1);
+		return cell->param_page_phys == phys ? 0 : -EBUSY;
+	}
+	cell->param_page_phys = phys;
+	memory_barrier();
+	cell->param_page = page;
+	spin_unlock(&param_page_lock);
+
+	return 0;
+}
+
+/**
+ * Map the parameter structure of a hypercall.
+ * @param address	Guest-physical address of the structure, or its offset
+ * 			in the parameter page of the calling cell tagged with
+ * 			JAILHOUSE_PARAM_PAGE_REF.
+ * @param size		Size of the structure.
+ * @param flags		Access flags of the temporary mapping, see
+ * 			@ref PAGE_ACCESS_FLAGS.
+ *
+ * Structures in the parameter page come without any page table work.
+ *
+ * @return Pointer to the structure or NULL on error.
+ *
+ * @note Structures outside the parameter page are mapped temporarily, see
+ * paging_get_guest_pages().
+ */
+void *hypercall_get_params(unsigned long address, unsigned long size,
+			   unsigned long flags)
+{
+	unsigned long page_offs = address & ~PAGE_MASK;
+	void *param_page = this_cell()->param_page;
+	void *mapping;
+
+	if (address & JAILHOUSE_PARAM_PAGE_REF) {
+		address &= ~JAILHOUSE_PARAM_PAGE_REF;
+		if (!param_page || size > PAGE_SIZE ||
+		    address > PAGE_SIZE - size)
+			return NULL;
+		return param_page + address;
+	}
+
+	if (size > NUM_TEMPORARY_PAGES * PAGE_SIZE)
+		return NULL;
+	mapping = paging_get_guest_pages(NULL, address,
+					 PAGES(page_offs + size), flags);
+	if (!mapping)
+		return NULL;
+	return mapping + page_offs;
+}
+
+static long dispatch_hypercall(struct per_cpu *cpu_data, unsigned long code,
+			       unsigned long arg1, unsigned long arg2)
+{
 	switch (code) {
 	case JAILHOUSE_HC_DISABLE:
 		return hypervisor_disable(cpu_data);
@@ -1152,12 +1446,24 @@ long hypercall(unsigned long code, unsigned long arg1, unsigned long arg2)
 		return cell_set_loadable(cpu_data, arg1);
 	case JAILHOUSE_HC_CELL_DESTROY:
 		return cell_destroy(cpu_data, arg1);
+	case JAILHOUSE_HC_CELL_RCPU_RESTART:
+		return cell_rcpu_restart(cpu_data, arg1, arg2);
+	case JAILHOUSE_HC_CELL_GET_BOOT_STAMP:
+		return omnv_get_boot_stamp(cpu_data, arg1, arg2);
+	case JAILHOUSE_HC_RCPU_DOORBELL:
+		return omnv_rcpu_doorbell(cpu_data, arg1);
+	case JAILHOUSE_HC_CELL_GET_MMIO_STATS:
+		return mmio_get_stats(cpu_data, arg1, arg2);
 	case JAILHOUSE_HC_HYPERVISOR_GET_INFO:
 		return hypervisor_get_info(cpu_data, arg1);
 	case JAILHOUSE_HC_CELL_GET_STATE:
 		return cell_get_state(cpu_data, arg1);
 	case JAILHOUSE_HC_CPU_GET_INFO:
 		return cpu_get_info(cpu_data, arg1, arg2);
+	case JAILHOUSE_HC_CPU_GET_EXIT_LATENCY:
+		return cpu_get_exit_latency(cpu_data, arg1, arg2);
+	case JAILHOUSE_HC_PARAM_PAGE_REGISTER:
+		return param_page_register(cpu_data, arg1);
 	case JAILHOUSE_HC_DEBUG_CONSOLE_PUTC:
 		if (!CELL_FLAGS_VIRTUAL_CONSOLE_PERMITTED(
 			cpu_data->public.cell->config->flags))
@@ -1170,8 +1476,36 @@ long hypercall(unsigned long code, unsigned long arg1, unsigned long arg2)
 	/* QoS only available on arm64 */
 	case JAILHOUSE_HC_QOS:
 		return qos_call(arg1, arg2);
+#endif
+#if defined(CONFIG_XMPU_ACTIVE) && defined(CONFIG_MACH_ZYNQMP_ZCU102)
+	case JAILHOUSE_HC_XMPU_GET_FAULTS:
+		return xmpu_get_faults(cpu_data, arg1, arg2);
 #endif
 	default:
 		return -ENOSYS;
 	}
 }
+
+/**
+ * Handle hypercall invoked by a cell.
+ * @param code		Hypercall code.
+ * @param arg1		First hypercall argument.
+ * @param arg2		Seconds hypercall argument.
+ *
+ * @return Value that shall be passed to the caller of the hypercall on return.
+ *
+ * @note If @c arg1 and @c arg2 are valid depends on the hypercall code.
+ */
+long hypercall(unsigned long code, unsigned long arg1, unsigned long arg2)
+{
+	struct per_cpu *cpu_data = this_cpu_data();
+	long ret;
+
+	cpu_data->public.stats[JAILHOUSE_CPU_STAT_VMEXITS_HYPERCALL]++;
+
+	trace_begin(JAILHOUSE_TRACE_HYPERCALL, code);
+	ret = dispatch_hypercall(cpu_data, code, arg1, arg2);
+	trace_end(JAILHOUSE_TRACE_HYPERCALL, code);
+
+	return ret;
+}
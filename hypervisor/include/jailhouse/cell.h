@@ -63,6 +63,14 @@ struct cell {
 	
 	/** True while the cell can be loaded by the root cell. */
 	bool loadable;
+	/** True between an approved rCPU restart begin and its end. */
+	bool rcpu_restarting;
+
+	/** Hypervisor mapping of the hypercall parameter page of the cell, or
+	 * NULL if none is registered. */
+	void *param_page;
+	/** Physical address of the hypercall parameter page. */
+	unsigned long param_page_phys;
 
 	/** Pointer to next cell in the system. */
 	struct cell *next;
@@ -80,6 +88,10 @@ struct cell {
 	struct mmio_region_location *mmio_locations;
 	/** MMIO region handler table. */
 	struct mmio_region_handler *mmio_handlers;
+#ifdef CONFIG_MMIO_STATS
+	/** MMIO region statistics slots, referenced by mmio_handlers. */
+	struct mmio_region_stats *mmio_stats;
+#endif
 	/** Number of MMIO regions in use. */
 	unsigned int num_mmio_regions;
 	/** Maximum number of MMIO regions. */
@@ -169,6 +169,9 @@ void config_commit(struct cell *cell_added_removed);
 
 long hypercall(unsigned long code, unsigned long arg1, unsigned long arg2);
 
+void *hypercall_get_params(unsigned long address, unsigned long size,
+			   unsigned long flags);
+
 void shutdown(void);
 
 /**
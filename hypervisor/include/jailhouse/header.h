@@ -70,6 +70,13 @@ struct jailhouse_header {
 	/** Offset of the console page inside the hypervisor memory
 	 * @note Filled at build time. */
 	unsigned long console_page;
+	/** Offset of the statistics page inside the per-CPU data
+	 * @note Filled at build time. */
+	unsigned long percpu_stats_page;
+	/** Offset of the event trace ring inside the per-CPU data, 0 if the
+	 * hypervisor was built without CONFIG_TRACE_EVENTS
+	 * @note Filled at build time. */
+	unsigned long percpu_trace_page;
 	/** Pointer to the first struct gcov_info
 	 * @note Filled at build time */
 	void *gcov_info_head;
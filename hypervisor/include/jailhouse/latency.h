@@ -0,0 +1,53 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor: VM exit latency histograms
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef _JAILHOUSE_LATENCY_H
+#define _JAILHOUSE_LATENCY_H
+
+#include <jailhouse/percpu.h>
+#include <asm/ticks.h>
+
+/**
+ * Start measuring the latency of a VM exit.
+ *
+ * @return Start stamp, to be passed to exit_latency_account().
+ */
+static inline u64 exit_latency_start(void)
+{
+	return arch_get_ticks();
+}
+
+/**
+ * Account a VM exit in the latency histogram of the current CPU.
+ * @param kind		Kind of the exit (JAILHOUSE_EXIT_*).
+ * @param start		Stamp returned by exit_latency_start().
+ *
+ * @note Counters are updated without atomics, a concurrent reader may miss
+ * the last exits.
+ */
+static inline void exit_latency_account(unsigned int kind, u64 start)
+{
+	struct jailhouse_exit_histogram *hist =
+		&this_cpu_public()->exit_latency[kind];
+	u64 ticks = arch_get_ticks() - start;
+	unsigned int bucket = ticks ? 63 - __builtin_clzll(ticks) : 0;
+
+	if (bucket >= JAILHOUSE_EXIT_LATENCY_BUCKETS)
+		bucket = JAILHOUSE_EXIT_LATENCY_BUCKETS - 1;
+	hist->buckets[bucket]++;
+	if (ticks > hist->max)
+		hist->max = ticks;
+}
+
+#endif /* !_JAILHOUSE_LATENCY_H */
@@ -166,14 +166,53 @@ struct mmio_region_location {
 	unsigned long size;
 };
 
+/** MMIO region access statistics. */
+struct mmio_region_stats {
+	/** True while the slot is assigned to a registered region. */
+	bool used;
+	/** Number of read accesses. */
+	u64 reads;
+	/** Number of write accesses. */
+	u64 writes;
+	/** Architectural counter ticks spent in the access handler. */
+	u64 ticks;
+};
+
 /** MMIO region access handler description. */
 struct mmio_region_handler {
 	/** Access handling function. */
 	mmio_handler function;
 	/** Argument to pass to the function. */
 	void *arg;
+#ifdef CONFIG_MMIO_STATS
+	/** Statistics slot of the region, follows the handler when the
+	 * region table is reordered. */
+	struct mmio_region_stats *stats;
+#endif
 };
 
+/** Number of entries of the per-CPU MMIO dispatch cache. */
+#define MMIO_CACHE_ENTRIES	4
+
+/** Recently hit MMIO region, valid while the cell generation is unchanged. */
+struct mmio_cache_entry {
+	/** Region coordinates. */
+	struct mmio_region_location location;
+	/** Region handler. */
+	struct mmio_region_handler handler;
+	/** Value of cell::mmio_generation the entry was looked up with. */
+	unsigned long generation;
+};
+
+/** Per-CPU MMIO dispatch cache. */
+struct mmio_cache {
+	struct mmio_cache_entry entry[MMIO_CACHE_ENTRIES];
+	/** Entry to replace on the next miss. */
+	unsigned int next;
+};
+
+struct per_cpu;
+
 int mmio_cell_init(struct cell *cell);
 
 void mmio_region_register(struct cell *cell, unsigned long start,
@@ -183,6 +222,11 @@ void mmio_region_unregister(struct cell *cell, unsigned long start);
 
 enum mmio_result mmio_handle_access(struct mmio_access *mmio);
 
+void mmio_cache_flush(struct per_cpu *cpu_data);
+
+long mmio_get_stats(struct per_cpu *cpu_data, unsigned long id,
+		    unsigned long stats_ptr);
+
 void mmio_cell_exit(struct cell *cell);
 
 void mmio_perform_access(void *base, struct mmio_access *mmio);
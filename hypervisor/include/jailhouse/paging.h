@@ -66,8 +66,16 @@ struct page_pool {
 	unsigned long used_pages;
 	/** Base address for bitmap of used pages. */
 	unsigned long *used_bitmap;
+	/** Summary of @c used_bitmap: a bit is set if the corresponding
+	 * bitmap word has all pages in use. */
+	unsigned long *full_bitmap;
 	/** Set @c PAGE_SCRUB_ON_FREE to zero-out pages on release. */
 	unsigned long flags;
+	/** Bitmap of released pages still to be zeroed, see page_scrub().
+	 * These pages remain marked in @c used_bitmap. */
+	unsigned long *dirty_bitmap;
+	/** Number of pages in @c dirty_bitmap, included in used_pages. */
+	unsigned long dirty_pages;
 };
 
 /**
@@ -214,6 +222,7 @@ unsigned long paging_get_phys_invalid(pt_entry_t pte, unsigned long virt);
 void *page_alloc(struct page_pool *pool, unsigned int num);
 void *page_alloc_aligned(struct page_pool *pool, unsigned int num);
 void page_free(struct page_pool *pool, void *first_page, unsigned int num);
+unsigned long page_scrub(struct page_pool *pool, unsigned long max_pages);
 
 /**
  * Translate virtual hypervisor address to physical address.
@@ -360,9 +369,21 @@ void paging_dump_stats(const char *when);
  * Flush TLBs related to the specified page.
  * @param page_addr Virtual page address.
  *
+ * @see arch_paging_flush_range_tlbs
  * @see arch_paging_flush_cpu_caches
  */
 
+/**
+ * @fn void arch_paging_flush_range_tlbs(unsigned long virt, unsigned long size)
+ * Flush TLBs related to the specified range of the hypervisor address space.
+ * Architectures may fall back to flushing all hypervisor TLB entries if the
+ * range is large.
+ * @param virt Virtual start address of the range.
+ * @param size Size of the range.
+ *
+ * @see arch_paging_flush_page_tlbs
+ */
+
 /**
  * @fn void arch_paging_flush_cpu_caches(void *addr, long size)
  * Flush caches related to the specified region.
@@ -372,6 +393,13 @@ void paging_dump_stats(const char *when);
  * @see arch_paging_flush_page_tlbs
  */
 
+/**
+ * @fn void arch_paging_zero_page(void *page)
+ * Zero a page of the hypervisor address space, using the fastest method the
+ * architecture provides.
+ * @param page Page-aligned pointer to the page.
+ */
+
 #endif /* !__ASSEMBLY__ */
 
 /** @} */
@@ -22,6 +22,7 @@
 #include <jailhouse/paging.h>
 #include <jailhouse/cell.h>
 #include <jailhouse/memguard-data.h>
+#include <jailhouse/trace-common.h>
 #include <asm/percpu.h>
 
 /**
@@ -35,14 +36,33 @@ struct public_per_cpu {
 	 *  page walks at any time. */
 	u8 root_table_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
 
+	/**
+	 * Statistics page, mapped read-only into the root cell. Its layout is
+	 * struct jailhouse_cpu_stats_page.
+	 */
+	struct {
+		/** Odd while the counters are being reset. */
+		u32 stats_seq;
+		u32 stats_version;
+		u32 stats_num;
+		u32 stats_padding;
+		/** Statistic counters. */
+		u32 stats[JAILHOUSE_NUM_CPU_STATS];
+	} __attribute__((aligned(PAGE_SIZE)));
+
+#ifdef CONFIG_TRACE_EVENTS
+	/** Event trace ring, mapped read-only into the root cell. Padded to
+	 *  full pages so that nothing else is exposed along with it. */
+	struct {
+		struct jailhouse_trace_ring trace;
+	} __attribute__((aligned(PAGE_SIZE)));
+#endif
+
 	/** Logical CPU ID (same as Linux). */
 	unsigned int cpu_id;
 	/** Owning cell. */
 	struct cell *cell;
 
-	/** Statistic counters. */
-	u32 stats[JAILHOUSE_NUM_CPU_STATS];
-
 	/** State of the shutdown process. Possible values:
 	 * @li SHUTDOWN_NONE: no shutdown in progress
 	 * @li SHUTDOWN_STARTED: shutdown in progress
@@ -65,6 +85,9 @@ struct public_per_cpu {
 
 	struct memguard memguard;
 
+	/** VM exit latency histograms, by kind (JAILHOUSE_EXIT_*). */
+	struct jailhouse_exit_histogram exit_latency[JAILHOUSE_NUM_EXIT_KINDS];
+
 	ARCH_PUBLIC_PERCPU_FIELDS;
 } __attribute__((aligned(PAGE_SIZE)));
 
@@ -84,6 +107,9 @@ struct per_cpu {
 	/** Per-CPU paging structures. */
 	struct paging_structures pg_structs;
 
+	/** MMIO regions of the owning cell recently hit by this CPU. */
+	struct mmio_cache mmio_cache;
+
 	ARCH_PERCPU_FIELDS;
 
 	/* Must be last field! */
@@ -0,0 +1,96 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor: hypervisor event tracing
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef _JAILHOUSE_TRACE_H
+#define _JAILHOUSE_TRACE_H
+
+#include <jailhouse/percpu.h>
+#include <asm/ticks.h>
+
+/**
+ * @defgroup Trace Event Tracing
+ *
+ * Static tracepoints that stamp hypervisor events into the trace ring of the
+ * current CPU, see include/jailhouse/trace-common.h. Without
+ * CONFIG_TRACE_EVENTS, they compile to nothing.
+ *
+ * @{
+ */
+
+#ifdef CONFIG_TRACE_EVENTS
+/**
+ * Record an event in the trace ring of the current CPU.
+ * @param event		Event code (JAILHOUSE_TRACE_*).
+ * @param phase		JAILHOUSE_TRACE_INSTANT, _BEGIN or _END.
+ * @param arg		Event argument.
+ *
+ * @note Only called from hypervisor context, which is never preempted, so the
+ * CPU is the only writer of its ring.
+ */
+static inline void trace_event(unsigned int event, unsigned int phase,
+			       u32 arg)
+{
+	struct jailhouse_trace_ring *ring = &this_cpu_public()->trace;
+	u32 head = ring->head;
+	struct jailhouse_trace_entry *entry =
+		&ring->entries[head & (JAILHOUSE_TRACE_ENTRIES - 1)];
+
+	entry->stamp = arch_get_ticks();
+	entry->event = event;
+	entry->phase = phase;
+	entry->arg = arg;
+
+	/* The reader must find the entry complete once it sees the head. */
+	memory_barrier();
+	ring->head = head + 1;
+}
+
+/**
+ * Prepare the trace ring of a CPU.
+ * @param cpu_public	Public per-CPU data of the CPU.
+ */
+static inline void trace_cpu_init(struct public_per_cpu *cpu_public)
+{
+	cpu_public->trace.ticks_hz = arch_get_ticks_hz();
+	memory_barrier();
+	cpu_public->trace.version = JAILHOUSE_TRACE_VERSION;
+}
+#else /* !CONFIG_TRACE_EVENTS */
+static inline void trace_event(unsigned int event, unsigned int phase,
+			       u32 arg)
+{
+}
+
+static inline void trace_cpu_init(struct public_per_cpu *cpu_public)
+{
+}
+#endif /* !CONFIG_TRACE_EVENTS */
+
+static inline void trace_begin(unsigned int event, u32 arg)
+{
+	trace_event(event, JAILHOUSE_TRACE_BEGIN, arg);
+}
+
+static inline void trace_end(unsigned int event, u32 arg)
+{
+	trace_event(event, JAILHOUSE_TRACE_END, arg);
+}
+
+static inline void trace_instant(unsigned int event, u32 arg)
+{
+	trace_event(event, JAILHOUSE_TRACE_INSTANT, arg);
+}
+
+/** @} */
+#endif /* !_JAILHOUSE_TRACE_H */
@@ -15,8 +15,26 @@
 #include <jailhouse/mmio.h>
 #include <jailhouse/paging.h>
 #include <jailhouse/printk.h>
+#include <jailhouse/string.h>
+#include <jailhouse/trace.h>
 #include <jailhouse/unit.h>
 #include <jailhouse/percpu.h>
+#include <jailhouse/utils.h>
+#include <asm/ticks.h>
+
+#ifdef CONFIG_MMIO_STATS
+#define MMIO_STATS_SIZE		sizeof(struct mmio_region_stats)
+#else
+#define MMIO_STATS_SIZE		0
+#endif
+
+/* Pages of the region tables of a cell */
+static unsigned int mmio_table_pages(struct cell *cell)
+{
+	return PAGES(cell->max_mmio_regions *
+		     (sizeof(struct mmio_region_location) +
+		      sizeof(struct mmio_region_handler) + MMIO_STATS_SIZE));
+}
 
 /**
  * Perform MMIO-specific initialization for a new cell.
@@ -41,16 +59,17 @@ int mmio_cell_init(struct cell *cell)
 		if (JAILHOUSE_MEMORY_IS_SUBPAGE(mem))
 			cell->max_mmio_regions++;
 
-	pages = page_alloc(&mem_pool,
-			   PAGES(cell->max_mmio_regions *
-				 (sizeof(struct mmio_region_location) +
-				  sizeof(struct mmio_region_handler))));
+	pages = page_alloc(&mem_pool, mmio_table_pages(cell));
 	if (!pages)
 		return -ENOMEM;
 
 	cell->mmio_locations = pages;
 	cell->mmio_handlers = pages +
 		cell->max_mmio_regions * sizeof(struct mmio_region_location);
+#ifdef CONFIG_MMIO_STATS
+	cell->mmio_stats = (void *)(cell->mmio_handlers +
+				    cell->max_mmio_regions);
+#endif
 
 	return 0;
 }
@@ -105,6 +124,14 @@ void mmio_region_register(struct cell *cell, unsigned long start,
 	cell->mmio_locations[index].size = size;
 	cell->mmio_handlers[index].function = handler;
 	cell->mmio_handlers[index].arg = handler_arg;
+#ifdef CONFIG_MMIO_STATS
+	/* There is a free slot as long as there is a free table entry. */
+	for (n = 0; cell->mmio_stats[n].used; n++)
+		;
+	memset(&cell->mmio_stats[n], 0, sizeof(cell->mmio_stats[n]));
+	cell->mmio_stats[n].used = true;
+	cell->mmio_handlers[index].stats = &cell->mmio_stats[n];
+#endif
 
 	cell->num_mmio_regions++;
 
@@ -116,8 +143,10 @@ void mmio_region_register(struct cell *cell, unsigned long start,
 }
 
 static int find_region(struct cell *cell, unsigned long address,
-		       unsigned int size, unsigned long *region_base,
-		       struct mmio_region_handler *handler)
+		       unsigned int size,
+		       struct mmio_region_location *location,
+		       struct mmio_region_handler *handler,
+		       unsigned long *region_generation)
 {
 	unsigned int range_start, range_size, index;
 	struct mmio_region_location region;
@@ -164,9 +193,10 @@ restart:
 			range_size -= index + 1 - range_start;
 			range_start = index + 1;
 		} else {
-			if (region_base != NULL) {
-				*region_base = region.start;
+			if (location != NULL) {
+				*location = region;
 				*handler = cell->mmio_handlers[index];
+				*region_generation = generation;
 			}
 
 			/*
@@ -199,7 +229,7 @@ void mmio_region_unregister(struct cell *cell, unsigned long start)
 
 	spin_lock(&cell->mmio_region_lock);
 
-	index = find_region(cell, start, 1, NULL, NULL);
+	index = find_region(cell, start, 1, NULL, NULL, NULL);
 	if (index >= 0) {
 		/*
 		 * Advance the generation to odd value, indicating that
@@ -209,6 +239,9 @@ void mmio_region_unregister(struct cell *cell, unsigned long start)
 		cell->mmio_generation++;
 		memory_barrier();
 
+#ifdef CONFIG_MMIO_STATS
+		cell->mmio_handlers[index].stats->used = false;
+#endif
 		for (/* empty */; (u32)index < cell->num_mmio_regions; index++)
 			copy_region(cell, index + 1, index);
 
@@ -224,6 +257,78 @@ void mmio_region_unregister(struct cell *cell, unsigned long start)
 	spin_unlock(&cell->mmio_region_lock);
 }
 
+static enum mmio_result dispatch(const struct mmio_region_handler *handler,
+				 struct mmio_access *mmio)
+{
+#ifdef CONFIG_MMIO_STATS
+	struct mmio_region_stats *stats = handler->stats;
+	u64 start = arch_get_ticks();
+	enum mmio_result result;
+
+	result = handler->function(handler->arg, mmio);
+
+	/*
+	 * Not atomic: concurrent accesses of several CPUs to the same region
+	 * may get lost, which is fine for a profile.
+	 */
+	if (mmio->is_write)
+		stats->writes++;
+	else
+		stats->reads++;
+	stats->ticks += arch_get_ticks() - start;
+
+	return result;
+#else
+	return handler->function(handler->arg, mmio);
+#endif
+}
+
+static enum mmio_result handle_access(struct mmio_access *mmio)
+{
+	struct mmio_cache *cache = &this_cpu_data()->mmio_cache;
+	u32 *stats = this_cpu_public()->stats;
+	struct mmio_region_location location;
+	struct mmio_region_handler handler;
+	struct cell *cell = this_cell();
+	struct mmio_cache_entry *entry;
+	unsigned long generation;
+	unsigned int n;
+
+	/*
+	 * A cached region is valid as long as the generation it was looked up
+	 * with is current: any change of the region table advances it.
+	 */
+	generation = cell->mmio_generation;
+	memory_load_barrier();
+
+	for (n = 0; n < MMIO_CACHE_ENTRIES; n++) {
+		entry = &cache->entry[n];
+		if (entry->generation == generation &&
+		    mmio->address >= entry->location.start &&
+		    mmio->address + mmio->size <=
+		    entry->location.start + entry->location.size) {
+			stats[JAILHOUSE_CPU_STAT_MMIO_CACHE_HITS]++;
+			mmio->address -= entry->location.start;
+			return dispatch(&entry->handler, mmio);
+		}
+	}
+
+	stats[JAILHOUSE_CPU_STAT_MMIO_CACHE_MISSES]++;
+
+	if (find_region(cell, mmio->address, mmio->size, &location, &handler,
+			&generation) < 0)
+		return MMIO_UNHANDLED;
+
+	entry = &cache->entry[cache->next];
+	cache->next = (cache->next + 1) % MMIO_CACHE_ENTRIES;
+	entry->location = location;
+	entry->handler = handler;
+	entry->generation = generation;
+
+	mmio->address -= location.start;
+	return dispatch(&handler, mmio);
+}
+
 /**
  * Dispatch MMIO access of a cell CPU.
  * @param mmio		MMIO access description. @a mmio->value will receive the
@@ -239,15 +344,27 @@ void mmio_region_unregister(struct cell *cell, unsigned long start)
  */
 enum mmio_result mmio_handle_access(struct mmio_access *mmio)
 {
-	struct mmio_region_handler handler;
-	unsigned long region_base;
+	u32 address = mmio->address;
+	enum mmio_result result;
 
-	if (find_region(this_cell(), mmio->address, mmio->size, &region_base,
-			&handler) < 0)
-		return MMIO_UNHANDLED;
+	trace_begin(JAILHOUSE_TRACE_MMIO, address);
+	result = handle_access(mmio);
+	trace_end(JAILHOUSE_TRACE_MMIO, address);
 
-	mmio->address -= region_base;
-	return handler.function(handler.arg, mmio);
+	return result;
+}
+
+/**
+ * Drop all MMIO regions cached by a CPU.
+ * @param cpu_data	Per-CPU data of a CPU that does not run guest code, e.g.
+ * 			while it is parked to be moved to another cell.
+ *
+ * Generations are only comparable within a cell, so the cache must be flushed
+ * whenever the CPU changes its cell.
+ */
+void mmio_cache_flush(struct per_cpu *cpu_data)
+{
+	memset(&cpu_data->mmio_cache, 0, sizeof(cpu_data->mmio_cache));
 }
 
 /**
@@ -258,10 +375,73 @@ enum mmio_result mmio_handle_access(struct mmio_access *mmio)
  */
 void mmio_cell_exit(struct cell *cell)
 {
-	page_free(&mem_pool, cell->mmio_locations,
-		  PAGES(cell->max_mmio_regions *
-			(sizeof(struct mmio_region_location) +
-			 sizeof(struct mmio_region_handler))));
+	page_free(&mem_pool, cell->mmio_locations, mmio_table_pages(cell));
+}
+
+/**
+ * Copy the access statistics of the MMIO regions of a cell to the root cell.
+ * @param cpu_data	Data structure of the calling CPU.
+ * @param id		ID of the cell to be queried.
+ * @param stats_ptr	Guest-physical address of a struct jailhouse_mmio_stats
+ * 			in the root cell.
+ *
+ * Regions are reported in ascending address order, at most
+ * JAILHOUSE_MMIO_STATS_MAX_REGIONS of them.
+ *
+ * @return Number of regions of the cell, which may exceed the number of
+ * reported ones, or negative error code.
+ */
+long mmio_get_stats(struct per_cpu *cpu_data, unsigned long id,
+		    unsigned long stats_ptr)
+{
+#ifdef CONFIG_MMIO_STATS
+	struct jailhouse_mmio_region_stats *region;
+	struct jailhouse_mmio_stats *stats;
+	struct mmio_region_stats *slot;
+	unsigned int n, count;
+	struct cell *cell;
+	long ret;
+
+	if (cpu_data->public.cell != &root_cell)
+		return -EPERM;
+
+	/*
+	 * No explicit synchronization with cell_create/destroy needed, see
+	 * cell_get_state.
+	 */
+	for_each_cell(cell)
+		if (cell->config->id == id)
+			break;
+	if (!cell)
+		return -ENOENT;
+
+	stats = hypercall_get_params(stats_ptr, sizeof(*stats),
+				     PAGE_DEFAULT_FLAGS);
+	if (!stats)
+		return -ENOMEM;
+
+	spin_lock(&cell->mmio_region_lock);
+
+	ret = cell->num_mmio_regions;
+	count = MIN(cell->num_mmio_regions, JAILHOUSE_MMIO_STATS_MAX_REGIONS);
+	stats->num_regions = count;
+	for (n = 0; n < count; n++) {
+		region = &stats->regions[n];
+		slot = cell->mmio_handlers[n].stats;
+
+		region->start = cell->mmio_locations[n].start;
+		region->size = cell->mmio_locations[n].size;
+		region->reads = slot->reads;
+		region->writes = slot->writes;
+		region->ticks = slot->ticks;
+	}
+
+	spin_unlock(&cell->mmio_region_lock);
+
+	return ret;
+#else
+	return -ENOSYS;
+#endif
 }
 
 void mmio_perform_access(void *base, struct mmio_access *mmio)
@@ -14,13 +14,30 @@
 #include <jailhouse/printk.h>
 #include <jailhouse/string.h>
 #include <jailhouse/control.h>
+#include <jailhouse/utils.h>
+#include <asm/spinlock.h>
+#ifdef CONFIG_PAGE_POOL_BENCH
+#include <asm/ticks.h>
+#endif
 
 #define BITS_PER_PAGE		(PAGE_SIZE * 8)
 
+/* Bitmap words needed to track the given number of bits */
+#define BITMAP_WORDS(bits)	(((bits) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+/* Bitmap words of the used and the full bitmap of a pool */
+#define POOL_BITMAP_WORDS(pages) \
+	(BITMAP_WORDS(pages) + BITMAP_WORDS(BITMAP_WORDS(pages)))
+/* Bitmap words of a pool that also tracks released pages to be zeroed */
+#define SCRUB_POOL_BITMAP_WORDS(pages) \
+	(POOL_BITMAP_WORDS(pages) + BITMAP_WORDS(pages))
+
+#define REMAP_POOL_PAGES	(BITS_PER_PAGE * NUM_REMAP_BITMAP_PAGES)
+
 #define INVALID_PAGE_NR		(~0UL)
 
 #define PAGE_SCRUB_ON_FREE	0x1
 
+
 /**
  * Offset between virtual and physical hypervisor addresses.
  *
@@ -35,9 +52,15 @@ struct page_pool mem_pool;
 /** Page pool containing virtual pages for remappings by the hypervisor. */
 struct page_pool remap_pool = {
 	.base_address = (void *)REMAP_BASE,
-	.pages = BITS_PER_PAGE * NUM_REMAP_BITMAP_PAGES,
+	.pages = REMAP_POOL_PAGES,
 };
 
+static unsigned long remap_full_bitmap[BITMAP_WORDS(BITMAP_WORDS(
+						REMAP_POOL_PAGES))];
+
+/* Protects the bitmaps and the dirty page counts of all page pools */
+static spinlock_t pool_lock;
+
 /** Descriptor of the hypervisor paging structures. */
 struct paging_structures hv_paging_structs;
 
@@ -58,51 +81,119 @@ unsigned long paging_get_phys_invalid(pt_entry_t pte, unsigned long virt)
 	return INVALID_PHYS_ADDR;
 }
 
+/* Mask of the bits below @p bit in its bitmap word */
+static inline unsigned long below_mask(unsigned long bit)
+{
+	if (bit % BITS_PER_LONG == 0)
+		return 0;
+	return ~0UL >> (BITS_PER_LONG - (bit % BITS_PER_LONG));
+}
+
+static void mark_page_used(struct page_pool *pool, unsigned long page_nr)
+{
+	unsigned long bmp_pos = page_nr / BITS_PER_LONG;
+
+	set_bit(page_nr, pool->used_bitmap);
+	if (pool->used_bitmap[bmp_pos] == ~0UL)
+		set_bit(bmp_pos, pool->full_bitmap);
+}
+
+static void mark_page_free(struct page_pool *pool, unsigned long page_nr)
+{
+	clear_bit(page_nr, pool->used_bitmap);
+	clear_bit(page_nr / BITS_PER_LONG, pool->full_bitmap);
+}
+
+/*
+ * Set up the full bitmap of a pool whose used bitmap is clear, and mark the
+ * pages beyond the end of the pool in the last bitmap word as used.
+ */
+static void page_pool_init_bitmaps(struct page_pool *pool,
+				   unsigned long *full_bitmap)
+{
+	unsigned long words = BITMAP_WORDS(pool->pages);
+	unsigned long n;
+
+	pool->full_bitmap = full_bitmap;
+	for (n = pool->pages; n < words * BITS_PER_LONG; n++)
+		mark_page_used(pool, n);
+	/* Words beyond the end of the bitmap are never free either. */
+	for (n = words; n < BITMAP_WORDS(words) * BITS_PER_LONG; n++)
+		set_bit(n, pool->full_bitmap);
+}
+
+/*
+ * Look up the first free page at or after @p start. The full bitmap lets the
+ * search skip BITS_PER_LONG fully used bitmap words with a single test, so
+ * the cost no longer grows with the number of allocated pages in front of
+ * the first free one.
+ */
 static unsigned long find_next_free_page(struct page_pool *pool,
 					 unsigned long start)
 {
-	unsigned long bmp_pos, bmp_val, page_nr;
-	unsigned long start_mask = 0;
+	unsigned long words = BITMAP_WORDS(pool->pages);
+	unsigned long bmp_pos, bmp_val, full_pos, full_val;
 
 	if (start >= pool->pages)
 		return INVALID_PAGE_NR;
 
 	/*
-	 * If we don't start on the beginning of a bitmap word, create a mask
-	 * to mark the pages before the start page as (virtually) used.
+	 * The pages before the start page in its bitmap word are (virtually)
+	 * used.
 	 */
-	if (start % BITS_PER_LONG > 0)
-		start_mask = ~0UL >> (BITS_PER_LONG - (start % BITS_PER_LONG));
-
-	for (bmp_pos = start / BITS_PER_LONG;
-	     bmp_pos < pool->pages / BITS_PER_LONG; bmp_pos++) {
-		bmp_val = pool->used_bitmap[bmp_pos] | start_mask;
-		start_mask = 0;
-		if (bmp_val != ~0UL) {
-			page_nr = ffzl(bmp_val) + bmp_pos * BITS_PER_LONG;
-			if (page_nr >= pool->pages)
-				break;
-			return page_nr;
+	bmp_pos = start / BITS_PER_LONG;
+	bmp_val = pool->used_bitmap[bmp_pos] | below_mask(start);
+	if (bmp_val != ~0UL)
+		return ffzl(bmp_val) + bmp_pos * BITS_PER_LONG;
+
+	for (bmp_pos++; bmp_pos < words;
+	     bmp_pos = (full_pos + 1) * BITS_PER_LONG) {
+		full_pos = bmp_pos / BITS_PER_LONG;
+		full_val = pool->full_bitmap[full_pos] | below_mask(bmp_pos);
+		if (full_val != ~0UL) {
+			bmp_pos = ffzl(full_val) + full_pos * BITS_PER_LONG;
+			return ffzl(pool->used_bitmap[bmp_pos]) +
+				bmp_pos * BITS_PER_LONG;
 		}
 	}
 
 	return INVALID_PAGE_NR;
 }
 
-/**
- * Allocate consecutive pages from the specified pool.
- * @param pool		Page pool to allocate from.
- * @param num		Number of pages.
- * @param align_mask	Choose start so that start_page_no & align_mask == 0.
- *
- * @return Pointer to first page or NULL if allocation failed.
+/*
+ * Look up the first used page in [@p start, @p end). Pages are tested a bitmap
+ * word at a time, so checking a run of free pages costs one test per
+ * BITS_PER_LONG pages.
+ */
+static unsigned long find_next_used_page(struct page_pool *pool,
+					 unsigned long start, unsigned long end)
+{
+	unsigned long bmp_pos, bmp_val, page_nr;
+
+	while (start < end) {
+		bmp_pos = start / BITS_PER_LONG;
+		bmp_val = pool->used_bitmap[bmp_pos] & ~below_mask(start);
+		if (bmp_val) {
+			page_nr = ffsl(bmp_val) + bmp_pos * BITS_PER_LONG;
+			return page_nr < end ? page_nr : INVALID_PAGE_NR;
+		}
+		start = (bmp_pos + 1) * BITS_PER_LONG;
+	}
+
+	return INVALID_PAGE_NR;
+}
+
+/*
+ * Caller must hold pool_lock.
  *
- * @see page_free
+ * Candidate start pages come from find_next_free_page(), which skips fully
+ * used bitmap words via the full bitmap. If the candidate run hits a used
+ * page, the search resumes behind it.
  */
-static void *page_alloc_internal(struct page_pool *pool, unsigned int num,
-				 unsigned long align_mask)
+static void *page_alloc_range(struct page_pool *pool, unsigned int num,
+			      unsigned long align_mask)
 {
-	unsigned long aligned_start, pool_start, next, start, last;
+	unsigned long aligned_start, pool_start, next, start, used;
 	unsigned int allocated;
 
 	pool_start = (unsigned long)pool->base_address >> PAGE_SHIFT;
@@ -124,23 +215,59 @@ restart:
 	if ((start - aligned_start) & align_mask)
 		goto restart;
 
-	for (allocated = 1, last = start; allocated < num;
-	     allocated++, last = next) {
-		next = find_next_free_page(pool, last + 1);
-		if (next == INVALID_PAGE_NR)
-			return NULL;
-		if (next != last + 1)
-			goto restart;	/* not consecutive */
+	if (start + num > pool->pages)
+		return NULL;
+
+	used = find_next_used_page(pool, start + 1, start + num);
+	if (used != INVALID_PAGE_NR) {
+		next = used + 1;
+		goto restart;	/* not consecutive */
 	}
 
 	for (allocated = 0; allocated < num; allocated++)
-		set_bit(start + allocated, pool->used_bitmap);
+		mark_page_used(pool, start + allocated);
 
 	pool->used_pages += num;
 
 	return pool->base_address + start * PAGE_SIZE;
 }
 
+/**
+ * Allocate consecutive pages from the specified pool.
+ * @param pool		Page pool to allocate from.
+ * @param num		Number of pages.
+ * @param align_mask	Choose start so that start_page_no & align_mask == 0.
+ *
+ * @return Pointer to first page or NULL if allocation failed.
+ *
+ * @see page_free
+ */
+static void *page_alloc_internal(struct page_pool *pool, unsigned int num,
+				 unsigned long align_mask)
+{
+	void *pages;
+
+	/*
+	 * Released pages are zeroed at the pace of the allocations, so that
+	 * neither the release nor a single allocation pays for all of them.
+	 */
+	if (pool->dirty_pages > 0)
+		page_scrub(pool, num);
+
+	spin_lock(&pool_lock);
+	pages = page_alloc_range(pool, num, align_mask);
+	spin_unlock(&pool_lock);
+
+	/* Out of clean pages: zero the released ones now and retry. */
+	if (!pages && pool->dirty_pages > 0 && page_scrub(pool, ~0UL) > 0) {
+		spin_lock(&pool_lock);
+		pages = page_alloc_range(pool, num, align_mask);
+		spin_unlock(&pool_lock);
+	}
+
+	return pages;
+}
+
 /**
  * Allocate consecutive pages from the specified pool.
  * @param pool	Page pool to allocate from.
@@ -175,23 +302,110 @@ void *page_alloc_aligned(struct page_pool *pool, unsigned int num)
  * @param page	Address of first page.
  * @param num	Number of pages.
  *
+ * Pages of a pool with @c PAGE_SCRUB_ON_FREE are only queued for zeroing. They
+ * become available again via page_scrub(), which later allocations from the
+ * pool call.
+ *
  * @see page_alloc
  */
 void page_free(struct page_pool *pool, void *page, unsigned int num)
 {
 	unsigned long page_nr;
 
-	if (!page)
+	if (!page || num == 0)
 		return;
 
-	while (num-- > 0) {
-		if (pool->flags & PAGE_SCRUB_ON_FREE)
-			memset(page, 0, PAGE_SIZE);
-		page_nr = (page - pool->base_address) / PAGE_SIZE;
-		clear_bit(page_nr, pool->used_bitmap);
-		pool->used_pages--;
-		page += PAGE_SIZE;
+	page_nr = (page - pool->base_address) / PAGE_SIZE;
+
+	spin_lock(&pool_lock);
+
+	/*
+	 * Nothing is written into the released pages: they may have held page
+	 * tables that stale TLB or walk-cache entries still point to, and
+	 * zeros never form a valid descriptor.
+	 */
+	if (pool->flags & PAGE_SCRUB_ON_FREE) {
+		pool->dirty_pages += num;
+		while (num-- > 0)
+			set_bit(page_nr++, pool->dirty_bitmap);
+	} else {
+		while (num-- > 0) {
+			mark_page_free(pool, page_nr++);
+			pool->used_pages--;
+		}
+	}
+
+	spin_unlock(&pool_lock);
+}
+
+/**
+ * Zero released pages of the specified pool and make them available again.
+ * @param pool		Page pool to scrub.
+ * @param max_pages	Maximum number of pages to zero, ~0UL for all.
+ *
+ * Pages are taken from the dirty bitmap one bitmap word at a time and zeroed
+ * without holding the pool lock, so allocations on other CPUs are only
+ * delayed by the bookkeeping.
+ *
+ * @return Number of pages that were zeroed.
+ *
+ * @see page_free
+ */
+unsigned long page_scrub(struct page_pool *pool, unsigned long max_pages)
+{
+	unsigned long words = BITMAP_WORDS(pool->pages);
+	unsigned long scrubbed = 0, pos = 0;
+	unsigned long claimed, page_nr, n;
+	unsigned int num;
+
+	while (scrubbed < max_pages) {
+		spin_lock(&pool_lock);
+
+		if (pool->dirty_pages == 0) {
+			spin_unlock(&pool_lock);
+			break;
+		}
+
+		while (pos < words && pool->dirty_bitmap[pos] == 0)
+			pos++;
+		if (pos == words) {
+			spin_unlock(&pool_lock);
+			break;
+		}
+
+		/* Claim the dirty pages of this word, up to max_pages. */
+		claimed = 0;
+		num = 0;
+		for (n = 0; n < BITS_PER_LONG && scrubbed + num < max_pages;
+		     n++)
+			if (pool->dirty_bitmap[pos] & (1UL << n)) {
+				claimed |= 1UL << n;
+				num++;
+			}
+		pool->dirty_bitmap[pos] &= ~claimed;
+
+		spin_unlock(&pool_lock);
+
+		page_nr = pos * BITS_PER_LONG;
+		for (n = 0; n < BITS_PER_LONG; n++)
+			if (claimed & (1UL << n))
+				arch_paging_zero_page(pool->base_address +
+						      (page_nr + n) * PAGE_SIZE);
+
+		spin_lock(&pool_lock);
+
+		for (n = 0; n < BITS_PER_LONG; n++)
+			if (claimed & (1UL << n))
+				mark_page_free(pool, page_nr + n);
+		pool->used_pages -= num;
+		pool->dirty_pages -= num;
+
+		spin_unlock(&pool_lock);
+
+		scrubbed += num;
 	}
+
+	return scrubbed;
 }
 
 /**
@@ -286,16 +500,19 @@ int paging_create(const struct paging_structures *pg_structs,
 		  unsigned long phys, unsigned long size, unsigned long virt,
 		  unsigned long access_flags, unsigned long paging_flags)
 {
+	unsigned long flush_start;
+	int err = 0;
+
 	phys &= PAGE_MASK;
 	virt &= PAGE_MASK;
 	size = PAGE_ALIGN(size);
+	flush_start = virt;
 
 	while (size > 0) {
 		const struct paging *paging = pg_structs->root_paging;
 		page_table_t pt = pg_structs->root_table;
 		struct paging_structures sub_structs;
 		pt_entry_t pte;
-		int err;
 
 		while (1) {
 			pte = paging->get_entry(pt, virt);
@@ -328,27 +545,32 @@ int paging_create(const struct paging_structures *pg_structs,
 						     paging, pte, virt,
 						     paging_flags);
 				if (err)
-					return err;
+					goto out;
 				pt = paging_phys2hvirt(
 						paging->get_next_pt(pte));
 			} else {
 				pt = page_alloc(&mem_pool, 1);
-				if (!pt)
-					return -ENOMEM;
+				if (!pt) {
+					err = -ENOMEM;
+					goto out;
+				}
 				paging->set_next_pt(pte,
 						    paging_hvirt2phys(pt));
 				flush_pt_entry(pte, paging_flags);
 			}
 			paging++;
 		}
-		if (pg_structs->hv_paging)
-			arch_paging_flush_page_tlbs(virt);
 
 		phys += paging->page_size;
 		virt += paging->page_size;
 		size -= paging->page_size;
 	}
-	return 0;
+
+out:
+	/* Invalidate what was mapped at once, not page by page. */
+	if (pg_structs->hv_paging)
+		arch_paging_flush_range_tlbs(flush_start, virt - flush_start);
+	return err;
 }
 
 /**
@@ -371,6 +593,9 @@ int paging_destroy(const struct paging_structures *pg_structs,
 		   unsigned long virt, unsigned long size,
 		   unsigned long paging_flags)
 {
+	unsigned long flush_start = virt;
+	int err = 0;
+
 	size = PAGE_ALIGN(size);
 
 	while (size > 0) {
@@ -379,7 +604,6 @@ int paging_destroy(const struct paging_structures *pg_structs,
 		unsigned long page_size;
 		pt_entry_t pte;
 		int n = 0;
-		int err;
 
 		/* walk down the page table, saving intermediate tables */
 		pt[0] = pg_structs->root_table;
@@ -420,7 +644,7 @@ int paging_destroy(const struct paging_structures *pg_structs,
 						     paging, pte, virt,
 						     paging_flags);
 				if (err)
-					return err;
+					goto out;
 			}
 			pt[++n] = paging_phys2hvirt(paging->get_next_pt(pte));
 			paging++;
@@ -438,15 +662,19 @@ int paging_destroy(const struct paging_structures *pg_structs,
 			paging--;
 			pte = paging->get_entry(pt[--n], virt);
 		}
-		if (pg_structs->hv_paging)
-			arch_paging_flush_page_tlbs(virt);
 
-		if (page_size > size)
+		if (page_size > size) {
+			virt += size;
 			break;
+		}
 		virt += page_size;
 		size -= page_size;
 	}
-	return 0;
+
+out:
+	if (pg_structs->hv_paging)
+		arch_paging_flush_range_tlbs(flush_start, virt - flush_start);
+	return err;
 }
 
 static unsigned long
@@ -626,6 +854,59 @@ int paging_map_all_per_cpu(unsigned int cpu, bool enable)
 			PAGING_NON_COHERENT | PAGING_HUGE);
 }
 
+#ifdef CONFIG_PAGE_POOL_BENCH
+#define PAGE_POOL_BENCH_PAGES	(PAGE_SIZE / sizeof(void *))
+#define PAGE_POOL_BENCH_RUNS	16
+#define PAGE_POOL_BENCH_RUN_PAGES	16
+
+/*
+ * Time the allocator on the fresh mem_pool: single pages, then aligned
+ * multi-page runs behind a range in which every other page is used.
+ */
+static void page_pool_bench(void)
+{
+	void *runs[PAGE_POOL_BENCH_RUNS];
+	unsigned long n, allocated;
+	u64 start, single, aligned;
+	void **pages;
+
+	pages = page_alloc(&mem_pool, 1);
+	if (!pages)
+		return;
+
+	start = arch_get_ticks();
+	for (allocated = 0; allocated < PAGE_POOL_BENCH_PAGES; allocated++) {
+		pages[allocated] = page_alloc(&mem_pool, 1);
+		if (!pages[allocated])
+			break;
+	}
+	single = arch_get_ticks() - start;
+
+	for (n = 0; n < allocated; n += 2)
+		page_free(&mem_pool, pages[n], 1);
+	/* Only the search is timed, not the zeroing of released pages. */
+	page_scrub(&mem_pool, ~0UL);
+
+	start = arch_get_ticks();
+	for (n = 0; n < PAGE_POOL_BENCH_RUNS; n++)
+		runs[n] = page_alloc_aligned(&mem_pool,
+					     PAGE_POOL_BENCH_RUN_PAGES);
+	aligned = arch_get_ticks() - start;
+
+	for (n = 0; n < PAGE_POOL_BENCH_RUNS; n++)
+		page_free(&mem_pool, runs[n], PAGE_POOL_BENCH_RUN_PAGES);
+	for (n = 1; n < allocated; n += 2)
+		page_free(&mem_pool, pages[n], 1);
+	page_free(&mem_pool, pages, 1);
+	page_scrub(&mem_pool, ~0UL);
+
+	printk("Page pool bench: %lu single pages in %llu ticks, "
+	       "%u aligned runs of %u pages in %llu ticks (%llu Hz)\n",
+	       allocated, single, PAGE_POOL_BENCH_RUNS,
+	       PAGE_POOL_BENCH_RUN_PAGES, aligned, arch_get_ticks_hz());
+}
+#endif
+
 /**
  * Initialize the page mapping subsystem.
  *
@@ -647,7 +928,8 @@ int paging_init(void)
 
 	mem_pool.pages = (system_config->hypervisor_memory.size -
 		(__page_pool - (u8 *)&hypervisor_header)) / PAGE_SIZE;
-	bitmap_pages = (mem_pool.pages + BITS_PER_PAGE - 1) / BITS_PER_PAGE;
+	bitmap_pages = PAGES(SCRUB_POOL_BITMAP_WORDS(mem_pool.pages) *
+			     sizeof(unsigned long));
 
 	if (mem_pool.pages <= per_cpu_pages + config_pages + bitmap_pages)
 		return -ENOMEM;
@@ -656,12 +938,17 @@ int paging_init(void)
 	mem_pool.used_bitmap =
 		(unsigned long *)(__page_pool + per_cpu_pages * PAGE_SIZE +
 				  config_pages * PAGE_SIZE);
+	page_pool_init_bitmaps(&mem_pool, mem_pool.used_bitmap +
+			       BITMAP_WORDS(mem_pool.pages));
+	mem_pool.dirty_bitmap = mem_pool.used_bitmap +
+		POOL_BITMAP_WORDS(mem_pool.pages);
 	mem_pool.used_pages = per_cpu_pages + config_pages + bitmap_pages;
 	for (n = 0; n < mem_pool.used_pages; n++)
-		set_bit(n, mem_pool.used_bitmap);
+		mark_page_used(&mem_pool, n);
 	mem_pool.flags = PAGE_SCRUB_ON_FREE;
 
 	remap_pool.used_bitmap = page_alloc(&mem_pool, NUM_REMAP_BITMAP_PAGES);
+	page_pool_init_bitmaps(&remap_pool, remap_full_bitmap);
 
 	hv_paging_structs.hv_paging = true;
 	hv_paging_structs.root_table =
@@ -713,6 +1000,10 @@ int paging_init(void)
 			return err;
 	}
 
+#ifdef CONFIG_PAGE_POOL_BENCH
+	page_pool_bench();
+#endif
+
 	return 0;
 }
 
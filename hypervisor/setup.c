@@ -18,6 +18,7 @@
 #include <jailhouse/paging.h>
 #include <jailhouse/control.h>
 #include <jailhouse/string.h>
+#include <jailhouse/trace.h>
 #include <jailhouse/unit.h>
 #include <generated/version.h>
 #include <asm/spinlock.h>
@@ -32,6 +33,30 @@ static unsigned int master_cpu_id = INVALID_CPU_ID;
 static volatile unsigned int entered_cpus, initialized_cpus;
 static volatile int error;
 
+/*
+ * Tell if the page at @p phys is the statistics page or a page of the trace
+ * ring of one of the CPUs
+ */
+static bool is_cpu_export_page(unsigned long phys)
+{
+	unsigned long offs = phys - paging_hvirt2phys(per_cpu(0));
+
+	if (offs >= sizeof(struct per_cpu) * hypervisor_header.max_cpus)
+		return false;
+
+	offs %= sizeof(struct per_cpu);
+	if (offs == hypervisor_header.percpu_stats_page)
+		return true;
+
+#ifdef CONFIG_TRACE_EVENTS
+	return offs >= hypervisor_header.percpu_trace_page &&
+		offs < hypervisor_header.percpu_trace_page +
+		PAGE_ALIGN(sizeof(struct jailhouse_trace_ring));
+#else
+	return false;
+#endif
+}
+
 static void init_early(unsigned int cpu_id)
 {
 	unsigned long core_and_percpu_size = hypervisor_header.core_size +
@@ -74,7 +99,8 @@ static void init_early(unsigned int cpu_id)
 	 * Linux' page table before shutdown without triggering violations.
 	 *
 	 * Allow read access to the console page, if the hypervisor has the
-	 * debug console flag JAILHOUSE_SYS_VIRTUAL_DEBUG_CONSOLE set.
+	 * debug console flag JAILHOUSE_SYS_VIRTUAL_DEBUG_CONSOLE set, and to
+	 * the statistics pages and trace rings of the CPUs.
 	 */
 	hyp_phys_start = system_config->hypervisor_memory.phys_start;
 	hyp_phys_end = hyp_phys_start + system_config->hypervisor_memory.size;
@@ -86,6 +112,8 @@ static void init_early(unsigned int cpu_id)
 		if (virtual_console &&
 		    hv_page.virt_start == paging_hvirt2phys(&console))
 			hv_page.phys_start = paging_hvirt2phys(&console);
+		else if (is_cpu_export_page(hv_page.virt_start))
+			hv_page.phys_start = hv_page.virt_start;
 		else
 			hv_page.phys_start = paging_hvirt2phys(empty_page);
 		error = arch_map_memory_region(&root_cell, &hv_page);
@@ -108,6 +136,9 @@ static void cpu_init(struct per_cpu *cpu_data)
 		goto failed;
 
 	cpu_data->public.cell = &root_cell;
+	cpu_data->public.stats_version = JAILHOUSE_CPU_STATS_VERSION;
+	cpu_data->public.stats_num = JAILHOUSE_NUM_CPU_STATS;
+	trace_cpu_init(&cpu_data->public);
 
 	/* set up per-CPU page table */
 	cpu_data->pg_structs.hv_paging = true;
@@ -289,4 +320,8 @@ hypervisor_header = {
 	.percpu_size = sizeof(struct per_cpu),
 	.entry = arch_entry - JAILHOUSE_BASE,
 	.console_page = (unsigned long)&console - JAILHOUSE_BASE,
+	.percpu_stats_page = __builtin_offsetof(struct per_cpu, public.stats_seq),
+#ifdef CONFIG_TRACE_EVENTS
+	.percpu_trace_page = __builtin_offsetof(struct per_cpu, public.trace),
+#endif
 };
@@ -43,7 +43,13 @@
 #define JAILHOUSE_CALL_CLOBBERED	"x3"
 
 /* CPU statistics, arm64-specific part */
-#define JAILHOUSE_NUM_CPU_STATS			JAILHOUSE_GENERIC_CPU_STATS + 5
+#define JAILHOUSE_CPU_STAT_SMC_PASSTHROUGH	JAILHOUSE_GENERIC_CPU_STATS + 5
+#define JAILHOUSE_CPU_STAT_SMC_INTERCEPTED	JAILHOUSE_GENERIC_CPU_STATS + 6
+#define JAILHOUSE_CPU_STAT_SMC_DENIED		JAILHOUSE_GENERIC_CPU_STATS + 7
+#define JAILHOUSE_CPU_STAT_SMC_SIP_TIME_US	JAILHOUSE_GENERIC_CPU_STATS + 8
+#define JAILHOUSE_CPU_STAT_TLBI_RANGES		JAILHOUSE_GENERIC_CPU_STATS + 9
+#define JAILHOUSE_CPU_STAT_TLBI_VMID		JAILHOUSE_GENERIC_CPU_STATS + 10
+#define JAILHOUSE_NUM_CPU_STATS			JAILHOUSE_GENERIC_CPU_STATS + 11
 
 #ifndef __ASSEMBLY__
 typedef __u64 __jh_arg;
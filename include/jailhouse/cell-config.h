@@ -68,13 +68,15 @@
  * Incremented on any layout or semantic change of system or cell config.
  * Also update formats and HEADER_REVISION in pyjailhouse/config_parser.py.
  */
-#define JAILHOUSE_CONFIG_REVISION	14
+#define JAILHOUSE_CONFIG_REVISION	16
 
 #define JAILHOUSE_CELL_NAME_MAXLEN	31
 
 #define JAILHOUSE_CELL_PASSIVE_COMMREG	0x00000001
 #define JAILHOUSE_CELL_TEST_DEVICE	0x00000002
 #define JAILHOUSE_CELL_AARCH32		0x00000004
+/* Put the cell into failed state on the first XMPU violation of its masters */
+#define JAILHOUSE_CELL_XMPU_FAULT_FAIL	0x00000008
 
 /*
  * The flag JAILHOUSE_CELL_VIRTUAL_CONSOLE_PERMITTED allows inmates to invoke
@@ -143,6 +145,10 @@ struct jailhouse_cell_desc {
 #define JAILHOUSE_MEM_COLORED_NO_COPY	0x0400
 /* Set internally for remap_to/unmap_from root ops */
 #define JAILHOUSE_MEM_TMP_ROOT_REMAP	0x0800
+/* APU <-> rCPU channel, see include/jailhouse/rcpu-channel-common.h */
+#define JAILHOUSE_MEM_RCPU_CHANNEL	0x1000
+/* rCPU health telemetry, see include/jailhouse/rcpu-telemetry-common.h */
+#define JAILHOUSE_MEM_RCPU_TELEMETRY	0x2000
 #define JAILHOUSE_MEM_IO_UNALIGNED	0x8000
 #define JAILHOUSE_MEM_IO_WIDTH_SHIFT	16 /* uses bits 16..19 */
 #define JAILHOUSE_MEM_IO_8		(1 << JAILHOUSE_MEM_IO_WIDTH_SHIFT)
@@ -402,6 +408,21 @@ struct jailhouse_rcpu_device {
 	__u32 rcpu_id;
 	char name[JAILHOUSE_RCPU_IMAGE_NAMELEN];
 	char compatible[JAILHOUSE_RCPU_IMAGE_NAMELEN];
+	/*
+	 * AXI ID and mask of a soft-core on its HP/HPC port, used to program
+	 * the XMPU. Ignored for hard cores, axi_mask = 0 leaves the soft-core
+	 * unprotected.
+	 */
+	__u16 axi_id;
+	__u16 axi_mask;
+	/*
+	 * Doorbell of a soft-core for the rCPU channel: the hypervisor writes
+	 * doorbell_value to doorbell_address (e.g. an AXI interrupt controller
+	 * or a GPIO in the PL). Ignored for hard cores, which are signaled
+	 * through the IPI, doorbell_address = 0 disables the doorbell.
+	 */
+	__u64 doorbell_address;
+	__u32 doorbell_value;
 } __attribute__((packed));
 
 /* add more flags for encrypted, compressed, authenticated ?*/
@@ -52,6 +52,32 @@
 #define JAILHOUSE_HC_DEBUG_CONSOLE_PUTC		8
 #define JAILHOUSE_HC_MEMGUARD_SET		9
 #define JAILHOUSE_HC_QOS			10
+#define JAILHOUSE_HC_XMPU_GET_FAULTS		11
+#define JAILHOUSE_HC_CELL_RCPU_RESTART		12
+#define JAILHOUSE_HC_CELL_GET_BOOT_STAMP	13
+#define JAILHOUSE_HC_RCPU_DOORBELL		14
+#define JAILHOUSE_HC_CELL_GET_MMIO_STATS	15
+#define JAILHOUSE_HC_CPU_GET_EXIT_LATENCY	16
+#define JAILHOUSE_HC_PARAM_PAGE_REGISTER	17
+
+/*
+ * Structure pointers passed to the memguard, QoS and statistics hypercalls
+ * can instead be offsets in the parameter page of the calling cell, tagged
+ * with this bit.
+ */
+#define JAILHOUSE_PARAM_PAGE_REF	(1UL << (sizeof(unsigned long) * 8 - 1))
+
+/* rCPU warm restart phases */
+#define JAILHOUSE_RCPU_RESTART_BEGIN		0
+#define JAILHOUSE_RCPU_RESTART_BEGIN_RELOAD	1
+#define JAILHOUSE_RCPU_RESTART_END		2
+#define JAILHOUSE_RCPU_RESTART_END_FAILED	3
+
+/* rCPU cell boot time stamps, in ticks of the system counter */
+#define JAILHOUSE_BOOT_STAMP_XMPU_BEGIN		0
+#define JAILHOUSE_BOOT_STAMP_XMPU_END		1
+#define JAILHOUSE_BOOT_STAMP_RCPU_WAKEUP	2
+#define JAILHOUSE_NUM_BOOT_STAMPS		3
 
 /* Hypervisor information type */
 #define JAILHOUSE_INFO_MEM_POOL_SIZE		0
@@ -73,7 +99,102 @@
 #define JAILHOUSE_CPU_STAT_VMEXITS_MMIO		1
 #define JAILHOUSE_CPU_STAT_VMEXITS_MANAGEMENT	2
 #define JAILHOUSE_CPU_STAT_VMEXITS_HYPERCALL	3
-#define JAILHOUSE_GENERIC_CPU_STATS		4
+#define JAILHOUSE_CPU_STAT_MMIO_CACHE_HITS	4
+#define JAILHOUSE_CPU_STAT_MMIO_CACHE_MISSES	5
+#define JAILHOUSE_GENERIC_CPU_STATS		6
+
+/* XMPU violation types, as reported by the XMPU ISR register */
+#define JAILHOUSE_XMPU_FAULT_INV_APB		0x01
+#define JAILHOUSE_XMPU_FAULT_READ		0x02
+#define JAILHOUSE_XMPU_FAULT_WRITE		0x04
+#define JAILHOUSE_XMPU_FAULT_SECURITY		0x08
+
+#define JAILHOUSE_XMPU_FAULT_LOG_SIZE		16
+
+struct jailhouse_xmpu_fault {
+	/** Address of the offending access. */
+	__u64 addr;
+	/** ID of the cell owning the master, -1 if unknown. */
+	__s32 cell_id;
+	/** AXI master ID of the offending access. */
+	__u16 master_id;
+	/** XMPU channel (0-5 DDR, 6 FPD, 7 OCM). */
+	__u8 channel;
+	/** Violation type (JAILHOUSE_XMPU_FAULT_*). */
+	__u8 type;
+} __attribute__((packed));
+
+struct jailhouse_xmpu_fault_log {
+	/** Number of faults recorded since hypervisor enable. The most recent
+	 *  entry is at (count - 1) % JAILHOUSE_XMPU_FAULT_LOG_SIZE. */
+	__u32 count;
+	__u32 padding;
+	struct jailhouse_xmpu_fault entries[JAILHOUSE_XMPU_FAULT_LOG_SIZE];
+} __attribute__((packed));
+
+#define JAILHOUSE_CPU_STATS_VERSION		1
+
+/*
+ * Page with the statistic counters of a CPU, readable by the root cell
+ * through mmap on /dev/jailhouse. seq is odd while the hypervisor resets the
+ * counters, each counter on its own is always consistent.
+ */
+struct jailhouse_cpu_stats_page {
+	__u32 seq;
+	__u32 version;
+	/** Number of entries in stats (JAILHOUSE_NUM_CPU_STATS). */
+	__u32 num_stats;
+	__u32 padding;
+	__u32 stats[];
+};
+
+#define JAILHOUSE_MMIO_STATS_MAX_REGIONS	64
+
+struct jailhouse_mmio_region_stats {
+	/** Start address of the region in the cell address space. */
+	__u64 start;
+	/** Region size. */
+	__u64 size;
+	/** Number of read accesses. */
+	__u64 reads;
+	/** Number of write accesses. */
+	__u64 writes;
+	/** Architectural counter ticks spent in the hypervisor handler. */
+	__u64 ticks;
+} __attribute__((packed));
+
+struct jailhouse_mmio_stats {
+	/** Number of valid entries in regions. */
+	__u32 num_regions;
+	__u32 padding;
+	struct jailhouse_mmio_region_stats
+		regions[JAILHOUSE_MMIO_STATS_MAX_REGIONS];
+} __attribute__((packed));
+
+/* Kinds of VM exits with a latency histogram */
+#define JAILHOUSE_EXIT_MMIO			0
+#define JAILHOUSE_EXIT_HYPERCALL		1
+#define JAILHOUSE_EXIT_MANAGEMENT		2
+#define JAILHOUSE_EXIT_IRQ			3
+#define JAILHOUSE_EXIT_SMC			4
+#define JAILHOUSE_EXIT_SYSREG			5
+#define JAILHOUSE_NUM_EXIT_KINDS		6
+
+/* Bucket n counts exits of 2^n up to 2^(n+1) - 1 ticks, the last one more */
+#define JAILHOUSE_EXIT_LATENCY_BUCKETS		32
+
+struct jailhouse_exit_histogram {
+	/** Longest exit observed, in ticks. */
+	__u64 max;
+	__u32 buckets[JAILHOUSE_EXIT_LATENCY_BUCKETS];
+};
+
+struct jailhouse_exit_latency {
+	/** Frequency of the architectural counter the latencies are taken
+	 *  with. */
+	__u64 ticks_hz;
+	struct jailhouse_exit_histogram kinds[JAILHOUSE_NUM_EXIT_KINDS];
+} __attribute__((packed));
 
 #define JAILHOUSE_MSG_NONE			0
 
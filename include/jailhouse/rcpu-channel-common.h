@@ -0,0 +1,211 @@
+/*
+ * Omnivisor Support for Jailhouse
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * APU <-> rCPU channel: two single-producer single-consumer rings in a memory
+ * region shared between an APU cell and an rCPU cell (JAILHOUSE_MEM_RCPU_CHANNEL).
+ * Payloads are exchanged by descriptor: the producer reserves a slot, builds
+ * the payload in place and commits it, the consumer gets a pointer to the
+ * payload and releases the slot when done. Nothing is copied.
+ *
+ * Used from the APU inmate library and the armr5 BSP, so only plain types and
+ * no includes. The region must be mapped uncached on both sides.
+ *
+ * Layout:
+ *   struct rcpu_channel_header
+ *   struct rcpu_channel_desc [RCPU_CHANNEL_DIRS][num_slots]
+ *   payload slots [RCPU_CHANNEL_DIRS][num_slots][slot_size]
+ */
+
+#ifndef _JAILHOUSE_RCPU_CHANNEL_COMMON_H
+#define _JAILHOUSE_RCPU_CHANNEL_COMMON_H
+
+#define RCPU_CHANNEL_MAGIC		0x4f4d4348	/* "OMCH" */
+#define RCPU_CHANNEL_VERSION		1
+#define RCPU_CHANNEL_ALIGN		64
+
+/* Ring directions */
+#define RCPU_CHANNEL_TO_RCPU		0
+#define RCPU_CHANNEL_FROM_RCPU		1
+#define RCPU_CHANNEL_DIRS		2
+
+struct rcpu_channel_desc {
+	/* Offset of the payload from the start of the channel */
+	unsigned int offset;
+	unsigned int len;
+};
+
+/* Producer and consumer index on separate cache lines */
+struct rcpu_channel_ring {
+	unsigned int head;
+	unsigned int pad0[RCPU_CHANNEL_ALIGN / 4 - 1];
+	unsigned int tail;
+	unsigned int pad1[RCPU_CHANNEL_ALIGN / 4 - 1];
+};
+
+struct rcpu_channel_header {
+	unsigned int magic;
+	unsigned int version;
+	/* Power of two */
+	unsigned int num_slots;
+	/* Multiple of RCPU_CHANNEL_ALIGN */
+	unsigned int slot_size;
+	unsigned int size;
+	unsigned int pad[RCPU_CHANNEL_ALIGN / 4 - 5];
+	struct rcpu_channel_ring ring[RCPU_CHANNEL_DIRS];
+};
+
+static inline unsigned int rcpu_channel_desc_size(unsigned int num_slots)
+{
+	unsigned int size = RCPU_CHANNEL_DIRS * num_slots *
+		sizeof(struct rcpu_channel_desc);
+
+	return (size + RCPU_CHANNEL_ALIGN - 1) & ~(RCPU_CHANNEL_ALIGN - 1);
+}
+
+/* Size of a channel, to be compared with the shared memory region */
+static inline unsigned long rcpu_channel_size(unsigned int num_slots,
+					      unsigned int slot_size)
+{
+	return sizeof(struct rcpu_channel_header) +
+		rcpu_channel_desc_size(num_slots) +
+		(unsigned long)RCPU_CHANNEL_DIRS * num_slots * slot_size;
+}
+
+static inline struct rcpu_channel_desc *
+rcpu_channel_desc(struct rcpu_channel_header *ch, unsigned int dir,
+		  unsigned int idx)
+{
+	struct rcpu_channel_desc *desc = (struct rcpu_channel_desc *)(ch + 1);
+
+	return &desc[dir * ch->num_slots + (idx & (ch->num_slots - 1))];
+}
+
+static inline void *rcpu_channel_slot(struct rcpu_channel_header *ch,
+				      unsigned int dir, unsigned int idx)
+{
+	return (char *)(ch + 1) + rcpu_channel_desc_size(ch->num_slots) +
+		(dir * ch->num_slots + (idx & (ch->num_slots - 1))) *
+		ch->slot_size;
+}
+
+/**
+ * Initializes the channel. Done by one side only (the APU), the other side
+ * waits for rcpu_channel_ready().
+ *
+ * @return 0 on success, -1 if the geometry is invalid or does not fit.
+ */
+static inline int rcpu_channel_init(void *base, unsigned long size,
+				    unsigned int num_slots,
+				    unsigned int slot_size)
+{
+	struct rcpu_channel_header *ch = base;
+	unsigned int n;
+
+	if (num_slots == 0 || (num_slots & (num_slots - 1)) ||
+	    slot_size == 0 || (slot_size & (RCPU_CHANNEL_ALIGN - 1)) ||
+	    rcpu_channel_size(num_slots, slot_size) > size)
+		return -1;
+
+	__atomic_store_n(&ch->magic, 0, __ATOMIC_RELAXED);
+	ch->version = RCPU_CHANNEL_VERSION;
+	ch->num_slots = num_slots;
+	ch->slot_size = slot_size;
+	ch->size = rcpu_channel_size(num_slots, slot_size);
+	for (n = 0; n < RCPU_CHANNEL_DIRS; n++) {
+		ch->ring[n].head = 0;
+		ch->ring[n].tail = 0;
+	}
+	__atomic_store_n(&ch->magic, RCPU_CHANNEL_MAGIC, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static inline int rcpu_channel_ready(struct rcpu_channel_header *ch)
+{
+	return __atomic_load_n(&ch->magic, __ATOMIC_ACQUIRE) ==
+		RCPU_CHANNEL_MAGIC && ch->version == RCPU_CHANNEL_VERSION;
+}
+
+/**
+ * Reserves the next free slot of a ring for the producer.
+ *
+ * @return Pointer to the payload slot (slot_size bytes), NULL if the ring is
+ *	   full.
+ */
+static inline void *rcpu_channel_reserve(struct rcpu_channel_header *ch,
+					 unsigned int dir)
+{
+	struct rcpu_channel_ring *ring = &ch->ring[dir];
+	unsigned int head = ring->head;
+
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+	    ch->num_slots)
+		return (void *)0;
+
+	return rcpu_channel_slot(ch, dir, head);
+}
+
+/**
+ * Publishes a payload to the consumer. @p payload is normally the slot
+ * returned by rcpu_channel_reserve(), but may point anywhere in the channel,
+ * e.g. into a slot of the opposite ring that is forwarded without copying.
+ */
+static inline void rcpu_channel_commit(struct rcpu_channel_header *ch,
+				       unsigned int dir, void *payload,
+				       unsigned int len)
+{
+	struct rcpu_channel_ring *ring = &ch->ring[dir];
+	unsigned int head = ring->head;
+	struct rcpu_channel_desc *desc = rcpu_channel_desc(ch, dir, head);
+
+	desc->offset = (char *)payload - (char *)ch;
+	desc->len = len;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Returns the oldest payload of a ring without consuming it.
+ *
+ * @return Pointer to the payload, NULL if the ring is empty or the descriptor
+ *	   points outside of the channel.
+ */
+static inline void *rcpu_channel_peek(struct rcpu_channel_header *ch,
+				      unsigned int dir, unsigned int *len)
+{
+	struct rcpu_channel_ring *ring = &ch->ring[dir];
+	unsigned int tail = ring->tail;
+	struct rcpu_channel_desc *desc;
+	unsigned int offset;
+
+	if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+		return (void *)0;
+
+	desc = rcpu_channel_desc(ch, dir, tail);
+	offset = desc->offset;
+	*len = desc->len;
+	if (offset > ch->size || *len > ch->size - offset)
+		return (void *)0;
+
+	return (char *)ch + offset;
+}
+
+/* Hands the oldest payload of a ring back to the producer */
+static inline void rcpu_channel_release(struct rcpu_channel_header *ch,
+					unsigned int dir)
+{
+	struct rcpu_channel_ring *ring = &ch->ring[dir];
+
+	__atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* _JAILHOUSE_RCPU_CHANNEL_COMMON_H */
@@ -0,0 +1,267 @@
+/*
+ * Omnivisor Support for Jailhouse
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * rCPU health telemetry: a page in a memory region shared between an rCPU cell
+ * and the root cell (JAILHOUSE_MEM_RCPU_TELEMETRY). The rCPU firmware is the
+ * only writer, the driver reads it and exposes it in sysfs. Updates are
+ * bracketed by an odd sequence count, so the reader can retry on a torn copy
+ * without ever blocking the writer.
+ *
+ * The page also carries the message words of the Jailhouse comm region, which
+ * the rCPUs cannot reach, and a ring of scheduler events. Both are optional
+ * and announced in flags by the firmware.
+ *
+ * All times are in ticks of the global system counter, shared by the APU and
+ * the rCPUs. Used from the armr5 BSP and the RISC-V demos, so only plain types
+ * and no includes. The region must be mapped uncached on the rCPU side.
+ */
+
+#ifndef _JAILHOUSE_RCPU_TELEMETRY_COMMON_H
+#define _JAILHOUSE_RCPU_TELEMETRY_COMMON_H
+
+#define RCPU_TELEMETRY_MAGIC		0x4f4d544c	/* "OMTL" */
+#define RCPU_TELEMETRY_VERSION		2
+#define RCPU_TELEMETRY_MAX_TASKS	32
+#define RCPU_TELEMETRY_TASK_NAMELEN	16
+/* Power of two */
+#define RCPU_TELEMETRY_TRACE_ENTRIES	64
+
+/* The firmware answers messages, the trace ring is written */
+#define RCPU_TELEMETRY_FLAG_MSG		0x1
+#define RCPU_TELEMETRY_FLAG_TRACE	0x2
+
+/* Same values as the JAILHOUSE_MSG_* and JAILHOUSE_CELL_* codes */
+#define RCPU_TELEMETRY_MSG_NONE			0
+#define RCPU_TELEMETRY_MSG_SHUTDOWN_REQUEST	1
+
+#define RCPU_TELEMETRY_MSG_UNKNOWN		1
+#define RCPU_TELEMETRY_MSG_REQUEST_DENIED	2
+#define RCPU_TELEMETRY_MSG_REQUEST_APPROVED	3
+
+#define RCPU_TELEMETRY_RUNNING			0
+#define RCPU_TELEMETRY_SHUT_DOWN		2
+
+/* Trace events: a task was switched in, the rCPU went to sleep, woke up */
+#define RCPU_TELEMETRY_TRACE_SWITCH	0
+#define RCPU_TELEMETRY_TRACE_SLEEP	1
+#define RCPU_TELEMETRY_TRACE_WAKE	2
+
+/* Trace task of events not tied to a registered task */
+#define RCPU_TELEMETRY_TRACE_NO_TASK	0xffffffff
+
+/* Missed heartbeat periods after which the rCPU is reported as stalled */
+#define RCPU_TELEMETRY_STALL_PERIODS	3
+
+struct rcpu_telemetry_task {
+	char name[RCPU_TELEMETRY_TASK_NAMELEN];
+	/* Lowest amount of stack never used so far, in bytes */
+	unsigned int stack_free;
+	unsigned int pad;
+	unsigned long long runs;
+	/* Longest execution of a single run observed so far */
+	unsigned long long wcet;
+};
+
+struct rcpu_telemetry_trace {
+	unsigned long long stamp;
+	/* Index in the task table, or RCPU_TELEMETRY_TRACE_NO_TASK */
+	unsigned int task;
+	unsigned int event;
+};
+
+struct rcpu_telemetry {
+	unsigned int magic;
+	unsigned int version;
+	/* Odd while the firmware is updating the page */
+	unsigned int seq;
+	unsigned int num_tasks;
+	/* Expected time between two heartbeats */
+	unsigned long long heartbeat_period;
+	unsigned long long heartbeat;
+	/* System counter at the last heartbeat */
+	unsigned long long heartbeat_stamp;
+	/* Time spent outside of the idle loop, and total time, since boot */
+	unsigned long long busy;
+	unsigned long long total;
+	unsigned int flags;
+	/*
+	 * Written by the driver, cleared by the firmware once it has taken the
+	 * message, not covered by the sequence count.
+	 */
+	unsigned int msg_to_rcpu;
+	unsigned int reply_from_rcpu;
+	unsigned int rcpu_state;
+	struct rcpu_telemetry_task task[RCPU_TELEMETRY_MAX_TASKS];
+	/* Free running, the entry at trace_head - 1 is the newest */
+	unsigned int trace_head;
+	unsigned int pad;
+	struct rcpu_telemetry_trace trace[RCPU_TELEMETRY_TRACE_ENTRIES];
+};
+
+static inline void rcpu_telemetry_begin(struct rcpu_telemetry *t)
+{
+	__atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void rcpu_telemetry_end(struct rcpu_telemetry *t)
+{
+	__atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Initializes the telemetry page. Called once by the rCPU firmware at boot.
+ *
+ * @param t		Telemetry page.
+ * @param heartbeat_period	Time between two heartbeats.
+ */
+static inline void rcpu_telemetry_init(struct rcpu_telemetry *t,
+				       unsigned long long heartbeat_period)
+{
+	char *p = (char *)t;
+	unsigned int n;
+
+	__atomic_store_n(&t->magic, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for (n = 0; n < sizeof(*t); n++)
+		p[n] = 0;
+	t->version = RCPU_TELEMETRY_VERSION;
+	t->heartbeat_period = heartbeat_period;
+	__atomic_store_n(&t->magic, RCPU_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+}
+
+static inline void rcpu_telemetry_heartbeat(struct rcpu_telemetry *t,
+					    unsigned long long now)
+{
+	rcpu_telemetry_begin(t);
+	t->heartbeat++;
+	t->heartbeat_stamp = now;
+	rcpu_telemetry_end(t);
+}
+
+/* Updates the load counters with the totals since boot */
+static inline void rcpu_telemetry_load(struct rcpu_telemetry *t,
+				       unsigned long long busy,
+				       unsigned long long total)
+{
+	rcpu_telemetry_begin(t);
+	t->busy = busy;
+	t->total = total;
+	rcpu_telemetry_end(t);
+}
+
+/**
+ * Registers a task.
+ *
+ * @return Index of the task, -1 if the page is full.
+ */
+static inline int rcpu_telemetry_add_task(struct rcpu_telemetry *t,
+					  const char *name)
+{
+	struct rcpu_telemetry_task *task;
+	unsigned int n;
+
+	if (t->num_tasks >= RCPU_TELEMETRY_MAX_TASKS)
+		return -1;
+
+	rcpu_telemetry_begin(t);
+	task = &t->task[t->num_tasks];
+	for (n = 0; n < RCPU_TELEMETRY_TASK_NAMELEN - 1 && name[n]; n++)
+		task->name[n] = name[n];
+	task->name[n] = 0;
+	task->stack_free = ~0U;
+	task->runs = 0;
+	task->wcet = 0;
+	t->num_tasks++;
+	rcpu_telemetry_end(t);
+
+	return t->num_tasks - 1;
+}
+
+/* Accounts one run of a task that took @p exec ticks */
+static inline void rcpu_telemetry_task_run(struct rcpu_telemetry *t,
+					   int idx, unsigned long long exec)
+{
+	struct rcpu_telemetry_task *task = &t->task[idx];
+
+	rcpu_telemetry_begin(t);
+	task->runs++;
+	if (exec > task->wcet)
+		task->wcet = exec;
+	rcpu_telemetry_end(t);
+}
+
+/* Records the stack high-water mark of a task, as bytes never used */
+static inline void rcpu_telemetry_task_stack(struct rcpu_telemetry *t,
+					     int idx, unsigned int stack_free)
+{
+	struct rcpu_telemetry_task *task = &t->task[idx];
+
+	if (stack_free >= task->stack_free)
+		return;
+
+	rcpu_telemetry_begin(t);
+	task->stack_free = stack_free;
+	rcpu_telemetry_end(t);
+}
+
+/* Announces optional parts of the page, see RCPU_TELEMETRY_FLAG_* */
+static inline void rcpu_telemetry_set_flags(struct rcpu_telemetry *t,
+					    unsigned int flags)
+{
+	__atomic_store_n(&t->flags, t->flags | flags, __ATOMIC_RELEASE);
+}
+
+/**
+ * Takes the pending message for the firmware, if any.
+ *
+ * @return Message code, RCPU_TELEMETRY_MSG_NONE if there is none.
+ */
+static inline unsigned int rcpu_telemetry_get_msg(struct rcpu_telemetry *t)
+{
+	unsigned int msg = __atomic_load_n(&t->msg_to_rcpu, __ATOMIC_ACQUIRE);
+
+	if (msg != RCPU_TELEMETRY_MSG_NONE)
+		__atomic_store_n(&t->msg_to_rcpu, RCPU_TELEMETRY_MSG_NONE,
+				 __ATOMIC_RELAXED);
+	return msg;
+}
+
+static inline void rcpu_telemetry_reply(struct rcpu_telemetry *t,
+					unsigned int reply)
+{
+	__atomic_store_n(&t->reply_from_rcpu, reply, __ATOMIC_RELEASE);
+}
+
+static inline void rcpu_telemetry_set_state(struct rcpu_telemetry *t,
+					    unsigned int state)
+{
+	__atomic_store_n(&t->rcpu_state, state, __ATOMIC_RELEASE);
+}
+
+/* Appends an event to the trace ring, overwriting the oldest one */
+static inline void rcpu_telemetry_trace(struct rcpu_telemetry *t,
+					unsigned long long now,
+					unsigned int event, unsigned int task)
+{
+	unsigned int head = t->trace_head;
+	struct rcpu_telemetry_trace *entry =
+		&t->trace[head & (RCPU_TELEMETRY_TRACE_ENTRIES - 1)];
+
+	entry->stamp = now;
+	entry->task = task;
+	entry->event = event;
+	__atomic_store_n(&t->trace_head, head + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* _JAILHOUSE_RCPU_TELEMETRY_COMMON_H */
@@ -0,0 +1,66 @@
+/*
+ * Omnivisor Support for Jailhouse
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * Hypervisor event trace: one ring per CPU in the hypervisor memory, written
+ * only by its CPU from hypervisor context and mapped read-only into the root
+ * cell. The writer never waits for the reader, the oldest entries are
+ * overwritten. A reader copies the entries below head and rereads head
+ * afterwards: entries that the writer may have reached meanwhile, i.e. below
+ * the new head minus JAILHOUSE_TRACE_ENTRIES plus one, are to be discarded.
+ *
+ * Stamps are ticks of the architectural counter (CNTPCT on ARM, TSC on x86).
+ * Used from the hypervisor, the driver and the jailhouse tool, so only plain
+ * types and no includes.
+ */
+
+#ifndef _JAILHOUSE_TRACE_COMMON_H
+#define _JAILHOUSE_TRACE_COMMON_H
+
+#define JAILHOUSE_TRACE_VERSION		1
+/* Power of two */
+#define JAILHOUSE_TRACE_ENTRIES		1024
+
+/* Trace events, the argument of the entries in brackets */
+#define JAILHOUSE_TRACE_TRAP		0	/* exception class */
+#define JAILHOUSE_TRACE_IRQ		1	/* interrupt number */
+#define JAILHOUSE_TRACE_MMIO		2	/* address, lower 32 bits */
+#define JAILHOUSE_TRACE_HYPERCALL	3	/* hypercall code */
+#define JAILHOUSE_TRACE_MEMGUARD_TIMER	4	/* memory budget */
+#define JAILHOUSE_TRACE_MEMGUARD_PMU	5	/* none */
+#define JAILHOUSE_TRACE_MEMGUARD_BLOCK	6	/* none */
+#define JAILHOUSE_TRACE_CELL_SUSPEND	7	/* cell ID */
+#define JAILHOUSE_TRACE_CELL_RESUME	8	/* cell ID */
+
+/* Phases: a single event, or the begin and the end of a nested span */
+#define JAILHOUSE_TRACE_INSTANT		0
+#define JAILHOUSE_TRACE_BEGIN		1
+#define JAILHOUSE_TRACE_END		2
+
+struct jailhouse_trace_entry {
+	unsigned long long stamp;
+	unsigned short event;
+	unsigned short phase;
+	unsigned int arg;
+};
+
+struct jailhouse_trace_ring {
+	/* 0 until the CPU was brought up */
+	unsigned int version;
+	/* Free running, the entry at head - 1 is the newest */
+	unsigned int head;
+	/* Frequency of the counter the entries are stamped with */
+	unsigned long long ticks_hz;
+	struct jailhouse_trace_entry entries[JAILHOUSE_TRACE_ENTRIES];
+};
+
+#endif /* _JAILHOUSE_TRACE_COMMON_H */
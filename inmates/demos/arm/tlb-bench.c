@@ -0,0 +1,101 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Stage-2 TLB benchmark bare-metal Jailhouse inmate (AArch64 only)
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * Walks the buffer of a memory bomb cell with a fixed stride and reports the
+ * CPU cycles and the L1 data TLB refills counted by the PMU per access. Every
+ * refill of the walk needs a stage-2 translation as well, so running it once
+ * in a colored and once in a plain memory bomb cell shows what the stage-2
+ * block and contiguous mappings save.
+ *
+ * Command line: stride=<bytes> (default 4096), passes=<n> (default 16)
+ *
+ * The event counter 0 is used, the hypervisor only reserves the upper ones
+ * (MDCR_EL2.HPMN) for memguard.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+#include <inmate.h>
+#include <asm/sysregs.h>
+#include <jailhouse/mem-bomb.h>
+
+#define PMCR_E			(1 << 0)
+#define PMCR_P			(1 << 1)
+#define PMCR_C			(1 << 2)
+#define PMCNTEN_EVT0		(1UL << 0)
+#define PMCNTEN_CYCLES		(1UL << 31)
+
+/* Architectural event, implemented by all ARMv8-A cores */
+#define PMU_EVT_L1D_TLB_REFILL	0x05
+
+static void pmu_setup(void)
+{
+	arm_write_sysreg(PMEVTYPER0_EL0, PMU_EVT_L1D_TLB_REFILL);
+	arm_write_sysreg(PMCNTENSET_EL0, PMCNTEN_EVT0 | PMCNTEN_CYCLES);
+	arm_write_sysreg(PMCR_EL0, PMCR_E | PMCR_P | PMCR_C);
+	asm volatile("isb" : : : "memory");
+}
+
+static void tlb_walk(unsigned long stride, unsigned int passes,
+		     u64 *cycles, u64 *refills)
+{
+	volatile unsigned char *buffer =
+		(volatile unsigned char *)MEM_VIRT_START;
+	u64 cycles0, cycles1, refills0, refills1;
+	unsigned int pass;
+	unsigned long off;
+
+	asm volatile("isb" : : : "memory");
+	arm_read_sysreg(PMCCNTR_EL0, cycles0);
+	arm_read_sysreg(PMEVCNTR0_EL0, refills0);
+
+	for (pass = 0; pass < passes; pass++)
+		for (off = 0; off < MEM_SIZE; off += stride)
+			(void)buffer[off];
+
+	asm volatile("isb" : : : "memory");
+	arm_read_sysreg(PMCCNTR_EL0, cycles1);
+	arm_read_sysreg(PMEVCNTR0_EL0, refills1);
+
+	*cycles = cycles1 - cycles0;
+	/* Event counters are 32 bits wide */
+	*refills = (u32)(refills1 - refills0);
+}
+
+void inmate_main(void)
+{
+	unsigned long stride = cmdline_parse_int("stride", PAGE_SIZE);
+	unsigned int passes = cmdline_parse_int("passes", 16);
+	u64 cycles, refills, accesses;
+
+	map_range((void *)CONFIG_INMATE_BASE + 0x10000, MAIN_SIZE - 0x10000,
+		  MAP_CACHED);
+	map_range((void *)MEM_VIRT_START, MEM_SIZE, MAP_CACHED);
+	asm volatile("isb" : : : "memory");
+
+	if (stride == 0 || stride > MEM_SIZE || passes == 0) {
+		printk("TLB bench: invalid stride or passes\n");
+		halt();
+	}
+
+	pmu_setup();
+
+	/* Fault in and warm up the caches, then measure */
+	tlb_walk(stride, 1, &cycles, &refills);
+	tlb_walk(stride, passes, &cycles, &refills);
+
+	accesses = (u64)passes * (MEM_SIZE / stride);
+	printk("TLB bench: %llu accesses, stride %lu: %llu cycles/access, "
+	       "%llu L1D TLB refills per 1000 accesses\n",
+	       accesses, stride, cycles / accesses,
+	       refills * 1000 / accesses);
+
+	halt();
+}
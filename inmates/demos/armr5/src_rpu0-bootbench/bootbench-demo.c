@@ -0,0 +1,82 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor demo RPU: boot latency benchmark.
+ *
+ * Stamps the entry of the firmware and its first heartbeat with the global
+ * system counter, shared with the APU, so that "jailhouse cell bench" can put
+ * them on the same time line as the driver and hypervisor stamps.
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#include "platform.h"
+#include "xil_cache.h"
+
+#define SYSTEM_COUNTER_LO  ((volatile u32 *)0xFF250000)
+#define SYSTEM_COUNTER_HI  ((volatile u32 *)0xFF250004)
+#define SHM_BASE           ((volatile u32 *)0x46d00000)
+
+/* Layout of the boot record, shared with tools/jailhouse-cell-bench */
+#define BOOT_MAGIC         0x424f4f54  /* "BOOT" */
+#define REC_MAGIC          0
+#define REC_HEARTBEATS     1
+#define REC_ENTRY_LO       2
+#define REC_ENTRY_HI       3
+#define REC_HEARTBEAT_LO   4
+#define REC_HEARTBEAT_HI   5
+
+#define HEARTBEAT_TICKS    100000  /* 1 ms at 100 MHz */
+
+static inline u64 read_system_counter(void)
+{
+  u32 hi, lo;
+
+  do {
+    hi = *SYSTEM_COUNTER_HI;
+    lo = *SYSTEM_COUNTER_LO;
+  } while (hi != *SYSTEM_COUNTER_HI);
+
+  return ((u64)hi << 32) | lo;
+}
+
+int main()
+{
+  // Entry Time: taken before anything else
+  u64 entry = read_system_counter();
+  u64 now, last;
+  u32 heartbeats = 0;
+
+  // Initialize the Plaftorm and disable caches
+  init_platform();
+  Xil_DCacheDisable();
+  Xil_ICacheDisable();
+
+  // First heartbeat: the firmware is up and running
+  last = read_system_counter();
+  SHM_BASE[REC_ENTRY_LO] = (u32)entry;
+  SHM_BASE[REC_ENTRY_HI] = (u32)(entry >> 32);
+  SHM_BASE[REC_HEARTBEAT_LO] = (u32)last;
+  SHM_BASE[REC_HEARTBEAT_HI] = (u32)(last >> 32);
+  SHM_BASE[REC_HEARTBEATS] = ++heartbeats;
+  __asm__ volatile("dsb" ::: "memory");
+  SHM_BASE[REC_MAGIC] = BOOT_MAGIC;
+
+  while (1) {
+    now = read_system_counter();
+    if (now - last >= HEARTBEAT_TICKS) {
+      SHM_BASE[REC_HEARTBEATS] = ++heartbeats;
+      last = now;
+    }
+  }
+
+  // Cleanup the Platform
+  cleanup_platform();
+  return 0;
+}
@@ -24,6 +24,9 @@
 #define DELAY_10_SECONDS	10000UL
 #define DELAY_1_SECOND		1000UL
 #define TIMER_CHECK_THRESHOLD	9
+/* Telemetry page of the cell, placed by the linker script */
+extern char _jailhouse_telemetry_start[];
+extern char _jailhouse_telemetry_size[];
 /*-----------------------------------------------------------*/
 
 /* The Tx and Rx tasks as described at the top of this file. */
@@ -58,6 +61,13 @@ int main( void )
 
 	xil_printf( "Hello from Freertos example main!\r\n" );
 
+	/* Answer the shutdown requests of Jailhouse and report the health and
+	the context switches of the tasks, with a heartbeat every second. */
+	if( xJailhouseAttach( _jailhouse_telemetry_start, ( unsigned long ) _jailhouse_telemetry_size, pdMS_TO_TICKS( DELAY_1_SECOND ) ) != 0 )
+	{
+		xil_printf( "Jailhouse telemetry page not available\r\n" );
+	}
+
 #if ( configSUPPORT_STATIC_ALLOCATION == 0 ) /* Normal or standard use case */
 	/* Create the two tasks.  The Tx task is given a lower priority than the
 	Rx task, so the Rx task will leave the Blocked state and pre-empt the Tx
@@ -16,6 +16,7 @@
  * the COPYING file in the top-level directory.
  */
 #include <stdint.h>
+#include <jailhouse/rcpu-telemetry-common.h>
 
 #define NPAGES 1024
 #define DIM (12 * NPAGES)   // 12*1024 = 12288
@@ -26,17 +27,35 @@
 #define SHM_BASE       ((volatile uint32_t *)0x46d01000)
 #define MEM_ARRAY	   ((uint32_t *)0x70FF0000)
 #define SYSTEM_COUNTER ((volatile uint32_t *)0xFF250000)
+#define SYSTEM_COUNTER_HI ((volatile uint32_t *)0xFF250004)
 #define COUNT          128
 #define WRITE_PTR_IDX  COUNT
 #define READ_PTR_IDX   (COUNT + 1)
 #define SHARED_MEM_SIZE 1024
 #define FLAG_INDEX (SHARED_MEM_SIZE - 1)
 
+/* Telemetry page, see rcpu_telemetry in the cell sysfs directory */
+#define TELEMETRY      ((struct rcpu_telemetry *)0x46d0f000)
+
+static inline uint64_t read_system_counter(void)
+{
+	uint32_t hi, lo;
+
+	do {
+		hi = *SYSTEM_COUNTER_HI;
+		lo = *SYSTEM_COUNTER;
+	} while (hi != *SYSTEM_COUNTER_HI);
+
+	return ((uint64_t)hi << 32) | lo;
+}
 
 void main(void){
 	uint32_t *mem_array = MEM_ARRAY; // Memory array base address
 	volatile uint32_t* system_counter = SYSTEM_COUNTER;
 	volatile uint32_t *shared_memory = SHM_BASE;
+	struct rcpu_telemetry *telemetry = TELEMETRY;
+	uint64_t busy = 0, total = 0;
+	int task;
 
 	uint32_t start, end, diff;
 	uint32_t readsum = 0;
@@ -48,6 +67,10 @@ void main(void){
 		mem_array[i] = i;
 	}
 
+	// One heartbeat per period
+	rcpu_telemetry_init(telemetry, (uint64_t)PERIOD * FREQUENCY);
+	task = rcpu_telemetry_add_task(telemetry, "membench");
+
 	while (1) {
 		// Perform memory read workload
 		start = *system_counter;
@@ -60,6 +83,8 @@ void main(void){
 		
 		diff = end - start;
 		time_us = diff / FREQUENCY;
+		busy += diff;
+		rcpu_telemetry_task_run(telemetry, task, diff);
 
 		// --- Ring buffer write ---
 		uint32_t write_ptr = shared_memory[WRITE_PTR_IDX];
@@ -78,5 +103,8 @@ void main(void){
 			diff = end - start;
 			time_us = diff / FREQUENCY;
 		}
+		total += diff;
+		rcpu_telemetry_load(telemetry, busy, total);
+		rcpu_telemetry_heartbeat(telemetry, read_system_counter());
 	}
 }
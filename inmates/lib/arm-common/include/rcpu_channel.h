@@ -0,0 +1,57 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef _JAILHOUSE_INMATES_RCPU_CHANNEL_H
+#define _JAILHOUSE_INMATES_RCPU_CHANNEL_H
+
+#include <inmate.h>
+#include <jailhouse/rcpu-channel-common.h>
+
+struct rcpu_channel {
+	struct rcpu_channel_header *hdr;
+	unsigned int rcpu;
+};
+
+int rcpu_channel_open(struct rcpu_channel *chan, void *base,
+		      unsigned long size, unsigned int rcpu,
+		      unsigned int num_slots, unsigned int slot_size);
+int rcpu_channel_kick(struct rcpu_channel *chan);
+int rcpu_channel_send(struct rcpu_channel *chan, void *payload,
+		      unsigned int len);
+
+/* Slot for the next message to the rCPU, NULL if the ring is full */
+static inline void *rcpu_channel_get_tx(struct rcpu_channel *chan)
+{
+	return rcpu_channel_reserve(chan->hdr, RCPU_CHANNEL_TO_RCPU);
+}
+
+/* Queues a message without ringing the doorbell, see rcpu_channel_kick */
+static inline void rcpu_channel_post(struct rcpu_channel *chan, void *payload,
+				     unsigned int len)
+{
+	rcpu_channel_commit(chan->hdr, RCPU_CHANNEL_TO_RCPU, payload, len);
+}
+
+/* Oldest message from the rCPU, NULL if there is none */
+static inline void *rcpu_channel_recv(struct rcpu_channel *chan,
+				      unsigned int *len)
+{
+	return rcpu_channel_peek(chan->hdr, RCPU_CHANNEL_FROM_RCPU, len);
+}
+
+/* Returns the message obtained by rcpu_channel_recv to the rCPU */
+static inline void rcpu_channel_done(struct rcpu_channel *chan)
+{
+	rcpu_channel_release(chan->hdr, RCPU_CHANNEL_FROM_RCPU);
+}
+
+#endif /* !_JAILHOUSE_INMATES_RCPU_CHANNEL_H */
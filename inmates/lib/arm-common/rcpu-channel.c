@@ -0,0 +1,45 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *  Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#include <rcpu_channel.h>
+
+/*
+ * Maps the channel region uncached, the rCPUs are not coherent with the APU
+ * caches, and lays out the rings. The rCPU side waits for the magic.
+ */
+int rcpu_channel_open(struct rcpu_channel *chan, void *base,
+		      unsigned long size, unsigned int rcpu,
+		      unsigned int num_slots, unsigned int slot_size)
+{
+	map_range(base, size, MAP_UNCACHED);
+
+	if (rcpu_channel_init(base, size, num_slots, slot_size))
+		return -1;
+
+	chan->hdr = base;
+	chan->rcpu = rcpu;
+
+	return 0;
+}
+
+/* Signals the rCPU through the hypervisor (IPI or soft-core doorbell) */
+int rcpu_channel_kick(struct rcpu_channel *chan)
+{
+	return jailhouse_call_arg1(JAILHOUSE_HC_RCPU_DOORBELL, chan->rcpu);
+}
+
+int rcpu_channel_send(struct rcpu_channel *chan, void *payload,
+		      unsigned int len)
+{
+	rcpu_channel_post(chan, payload, len);
+	return rcpu_channel_kick(chan);
+}
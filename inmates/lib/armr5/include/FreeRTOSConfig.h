@@ -116,7 +116,7 @@
 
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION 1
 
-#define configUSE_TICKLESS_IDLE	0
+#define configUSE_TICKLESS_IDLE	1
 #define configTASK_RETURN_ADDRESS    prvTaskExitError
 #define INCLUDE_vTaskPrioritySet             1
 #define INCLUDE_uxTaskPriorityGet            1
@@ -129,6 +129,7 @@
 #define INCLUDE_xTimerPendFunctionCall       1
 #define INCLUDE_pcTaskGetTaskName            1
 #define INCLUDE_xTaskGetHandle               1
+#define INCLUDE_uxTaskGetStackHighWaterMark  1
 #define portPOINTER_SIZE_TYPE	uint32_t
 #define portTICK_TYPE_IS_ATOMIC 0
 #define configMESSAGE_BUFFER_LENGTH_TYPE uint32_t
@@ -166,4 +167,6 @@ void FreeRTOS_ClearTickInterrupt( void );
 #include "FreeRTOSSTMTrace.h"
 #endif /* FREERTOS_ENABLE_TRACE */
 
+#include "FreeRTOSJailhouse.h"
+
 #endif
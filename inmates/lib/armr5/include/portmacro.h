@@ -118,6 +118,12 @@ macros is used. */
 handler for whichever peripheral is used to generate the RTOS tick. */
 void FreeRTOS_Tick_Handler( void );
 
+/* Tickless idle, implemented with the tick timer in portZynqUltrascale.c. */
+#if ( configUSE_TICKLESS_IDLE == 1 )
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#endif
+
 /*
  * Installs pxHandler as the interrupt handler for the peripheral specified by
  * the ucInterruptID parameter.
@@ -0,0 +1,59 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor rCPU channel, R5 side.
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef RCPU_CHANNEL_H
+#define RCPU_CHANNEL_H
+
+#include "xil_types.h"
+#include "rcpu-channel-common.h"
+
+/* IPI channels of the RPUs, the doorbell of the APU comes from channel 0 */
+#define RCPU_CHANNEL_IPI_RPU0_BASE  0xFF310000U
+#define RCPU_CHANNEL_IPI_RPU1_BASE  0xFF320000U
+#define RCPU_CHANNEL_IPI_RPU0_IRQ   65U
+#define RCPU_CHANNEL_IPI_RPU1_IRQ   66U
+#define RCPU_CHANNEL_IPI_APU_MASK   0x00000001U
+
+typedef struct {
+  struct rcpu_channel_header *hdr;
+  u32 ipi_base;
+  /* IPI mask of the APU doorbell on send, 0 if the APU polls */
+  u32 apu_mask;
+} rcpu_channel_t;
+
+int rcpu_channel_attach(rcpu_channel_t *chan, void *base, u32 size,
+                        u32 ipi_base, u32 apu_mask);
+void rcpu_channel_enable_irq(rcpu_channel_t *chan);
+int rcpu_channel_ack(rcpu_channel_t *chan);
+void rcpu_channel_send(rcpu_channel_t *chan, void *payload, u32 len);
+
+/* Oldest message from the APU, NULL if there is none */
+static inline void *rcpu_channel_recv(rcpu_channel_t *chan, u32 *len)
+{
+  return rcpu_channel_peek(chan->hdr, RCPU_CHANNEL_TO_RCPU, len);
+}
+
+/* Returns the message obtained by rcpu_channel_recv to the APU */
+static inline void rcpu_channel_done(rcpu_channel_t *chan)
+{
+  rcpu_channel_release(chan->hdr, RCPU_CHANNEL_TO_RCPU);
+}
+
+/* Slot for the next message to the APU, NULL if the ring is full */
+static inline void *rcpu_channel_get_tx(rcpu_channel_t *chan)
+{
+  return rcpu_channel_reserve(chan->hdr, RCPU_CHANNEL_FROM_RCPU);
+}
+
+#endif /* RCPU_CHANNEL_H */
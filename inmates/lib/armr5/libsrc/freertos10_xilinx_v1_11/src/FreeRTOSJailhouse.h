@@ -0,0 +1,60 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor: Jailhouse support of the FreeRTOS R5 port.
+ *
+ * The R5 cannot reach the comm region of its cell, the driver exchanges the
+ * Jailhouse messages through the telemetry page instead. Attaching to that
+ * page makes the kernel answer JAILHOUSE_MSG_SHUTDOWN_REQUEST, publish its
+ * health and log the context switches into the trace ring of the page.
+ *
+ * Included at the end of FreeRTOSConfig.h, so only plain types here.
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef FREERTOS_JAILHOUSE_H
+#define FREERTOS_JAILHOUSE_H
+
+/* Frequency of the global system counter the telemetry is stamped with */
+#ifndef configJAILHOUSE_COUNTER_HZ
+#define configJAILHOUSE_COUNTER_HZ	100000000ULL
+#endif
+
+/* Called before vTaskStartScheduler(), returns 0 on success */
+int xJailhouseAttach( void *pvPage, unsigned long ulSize, unsigned long ulHeartbeat );
+
+/* Called on a shutdown request, returns 0 to deny it. Approved by default. */
+void vJailhouseSetShutdownHook( int ( *pxHook )( void ) );
+
+/* Reports the cell as shut down and parks the R5 until it is stopped */
+void vJailhouseShutdown( void ) __attribute__((noreturn));
+
+/* Kernel and port hooks */
+void vJailhouseTaskCreated( void *pvTask );
+void vJailhouseTaskDeleted( void *pvTask );
+void vJailhouseTaskSwitchedIn( void *pvTask, int xIsIdle );
+void vJailhouseTaskSwitchedOut( void *pvTask, int xIsIdle );
+void vJailhouseTickFromISR( void );
+unsigned long ulJailhouseSleepLimit( unsigned long ulTicks );
+void vJailhouseSleep( void );
+void vJailhouseWake( void );
+
+/*
+ * Expanded in tasks.c, where pxCurrentTCB and xIdleTaskHandle are visible.
+ * The STM trace owns these macros when enabled, tasks are then not reported.
+ */
+#ifndef FREERTOS_ENABLE_TRACE
+#define traceTASK_CREATE( pxNewTCB )	vJailhouseTaskCreated( pxNewTCB )
+#define traceTASK_DELETE( pxTCB )	vJailhouseTaskDeleted( pxTCB )
+#define traceTASK_SWITCHED_IN()		vJailhouseTaskSwitchedIn( pxCurrentTCB, pxCurrentTCB == xIdleTaskHandle )
+#define traceTASK_SWITCHED_OUT()	vJailhouseTaskSwitchedOut( pxCurrentTCB, pxCurrentTCB == xIdleTaskHandle )
+#endif
+
+#endif /* FREERTOS_JAILHOUSE_H */
@@ -0,0 +1,299 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor: Jailhouse support of the FreeRTOS R5 port.
+ *
+ * All hooks do nothing until xJailhouseAttach() was called. They run from the
+ * tick interrupt or from the context switch, both with interrupts masked, so
+ * the writers of the telemetry page never nest.
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+/* Xilinx includes. */
+#include "xil_mpu.h"
+#include "xreg_cortexr5.h"
+#include "xstatus.h"
+
+#include "rcpu_telemetry.h"
+
+/* Task number of a task that did not fit in the telemetry page */
+#define jailhouseNO_SLOT	( RCPU_TELEMETRY_MAX_TASKS + 1 )
+
+static rcpu_telemetry_t xTelemetry;
+static struct rcpu_telemetry *pxPage = NULL;
+static unsigned long ulHeartbeatTicks;
+static int ( *pxShutdownHook )( void ) = NULL;
+
+/* Registered tasks, for the stack sampling */
+static TaskHandle_t xTasks[ RCPU_TELEMETRY_MAX_TASKS ];
+static UBaseType_t uxNextStackSample = 0;
+static unsigned long long ullLastHeartbeat = 0;
+
+/* Start of the slice of the running task */
+static u64 ullSwitchedIn;
+/*-----------------------------------------------------------*/
+
+int xJailhouseAttach( void *pvPage, unsigned long ulSize, unsigned long ulHeartbeat )
+{
+	/* The driver reads the page at any time, keep it out of the caches. */
+	if( Xil_SetMPURegion( ( INTPTR ) pvPage, ulSize, NORM_SHARED_NCACHE | PRIV_RW_USER_RW ) != XST_SUCCESS )
+	{
+		return -1;
+	}
+
+	if( rcpu_telemetry_attach( &xTelemetry, pvPage, ulSize,
+			( u64 ) ulHeartbeat * ( configJAILHOUSE_COUNTER_HZ / configTICK_RATE_HZ ) ) != 0 )
+	{
+		return -1;
+	}
+
+	ulHeartbeatTicks = ulHeartbeat;
+	rcpu_telemetry_set_state( xTelemetry.page, RCPU_TELEMETRY_RUNNING );
+	rcpu_telemetry_set_flags( xTelemetry.page, RCPU_TELEMETRY_FLAG_MSG | RCPU_TELEMETRY_FLAG_TRACE );
+	pxPage = xTelemetry.page;
+
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseSetShutdownHook( int ( *pxHook )( void ) )
+{
+	pxShutdownHook = pxHook;
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseShutdown( void )
+{
+	__asm volatile ( "CPSID i" ::: "memory" );
+
+	if( pxPage != NULL )
+	{
+		rcpu_telemetry_set_state( pxPage, RCPU_TELEMETRY_SHUT_DOWN );
+	}
+
+	/* The driver stops the R5 once it sees the new state. */
+	for( ;; )
+	{
+		__asm volatile ( "DSB\n"
+						 "WFI" ::: "memory" );
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* Runs in the timer service task, off the tick interrupt. */
+static void prvHandleMessage( void *pvParameter, uint32_t ulMsg )
+{
+	( void ) pvParameter;
+
+	if( ulMsg != RCPU_TELEMETRY_MSG_SHUTDOWN_REQUEST )
+	{
+		rcpu_telemetry_reply( pxPage, RCPU_TELEMETRY_MSG_UNKNOWN );
+		return;
+	}
+
+	if( pxShutdownHook != NULL && pxShutdownHook() == 0 )
+	{
+		rcpu_telemetry_reply( pxPage, RCPU_TELEMETRY_MSG_REQUEST_DENIED );
+		return;
+	}
+
+	/* The driver stops the R5 once the hypervisor accepted the request as
+	well. Keep running until then, the request may still fail. */
+	rcpu_telemetry_reply( pxPage, RCPU_TELEMETRY_MSG_REQUEST_APPROVED );
+}
+/*-----------------------------------------------------------*/
+
+/* Index of the task in the telemetry page, registered on its first run */
+static UBaseType_t prvTaskIndex( TaskHandle_t xTask )
+{
+UBaseType_t uxNumber = uxTaskGetTaskNumber( xTask );
+int iIndex;
+
+	if( uxNumber == 0 )
+	{
+		iIndex = rcpu_telemetry_task( &xTelemetry, pcTaskGetName( xTask ) );
+		if( iIndex < 0 )
+		{
+			uxNumber = jailhouseNO_SLOT;
+		}
+		else
+		{
+			xTasks[ iIndex ] = xTask;
+			uxNumber = ( UBaseType_t ) iIndex + 1;
+		}
+		vTaskSetTaskNumber( xTask, uxNumber );
+	}
+
+	return uxNumber - 1;
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseTaskCreated( void *pvTask )
+{
+	/* The task number of a new TCB is not initialised by the kernel. */
+	vTaskSetTaskNumber( ( TaskHandle_t ) pvTask, 0 );
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseTaskDeleted( void *pvTask )
+{
+UBaseType_t uxNumber = uxTaskGetTaskNumber( ( TaskHandle_t ) pvTask );
+
+	/* The slot keeps the statistics of the deleted task. */
+	if( uxNumber != 0 && uxNumber != jailhouseNO_SLOT )
+	{
+		xTasks[ uxNumber - 1 ] = NULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseTaskSwitchedIn( void *pvTask, int xIsIdle )
+{
+UBaseType_t uxIndex;
+
+	if( pxPage == NULL )
+	{
+		return;
+	}
+
+	ullSwitchedIn = rcpu_telemetry_now();
+	uxIndex = prvTaskIndex( ( TaskHandle_t ) pvTask );
+	if( xIsIdle )
+	{
+		rcpu_telemetry_idle_enter( &xTelemetry );
+	}
+
+	rcpu_telemetry_trace( pxPage, ullSwitchedIn, RCPU_TELEMETRY_TRACE_SWITCH,
+			uxIndex < RCPU_TELEMETRY_MAX_TASKS ? uxIndex : RCPU_TELEMETRY_TRACE_NO_TASK );
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseTaskSwitchedOut( void *pvTask, int xIsIdle )
+{
+UBaseType_t uxIndex;
+
+	if( pxPage == NULL )
+	{
+		return;
+	}
+
+	if( xIsIdle )
+	{
+		rcpu_telemetry_idle_exit( &xTelemetry );
+		return;
+	}
+
+	/* A run is one slice, from switch in to switch out. */
+	uxIndex = prvTaskIndex( ( TaskHandle_t ) pvTask );
+	if( uxIndex < RCPU_TELEMETRY_MAX_TASKS )
+	{
+		rcpu_telemetry_task_run( pxPage, uxIndex, rcpu_telemetry_now() - ullSwitchedIn );
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* Samples the stack high-water mark of one task per heartbeat */
+static void prvSampleStack( void )
+{
+UBaseType_t uxTasks = pxPage->num_tasks;
+UBaseType_t uxIndex;
+UBaseType_t uxFree;
+
+	for( uxIndex = 0; uxIndex < uxTasks; uxIndex++ )
+	{
+		TaskHandle_t xTask = xTasks[ uxNextStackSample ];
+		UBaseType_t uxSample = uxNextStackSample;
+
+		uxNextStackSample = ( uxNextStackSample + 1 ) % uxTasks;
+		if( xTask != NULL )
+		{
+			uxFree = uxTaskGetStackHighWaterMark( xTask ) * sizeof( StackType_t );
+			rcpu_telemetry_task_stack( pxPage, uxSample, uxFree );
+			return;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseTickFromISR( void )
+{
+BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+uint32_t ulMsg;
+
+	if( pxPage == NULL )
+	{
+		return;
+	}
+
+	/* Account the idle phase in progress, the tick may preempt the idle task. */
+	if( xTelemetry.idle_since != 0 )
+	{
+		rcpu_telemetry_idle_exit( &xTelemetry );
+		rcpu_telemetry_idle_enter( &xTelemetry );
+	}
+
+	rcpu_telemetry_poll( &xTelemetry );
+	if( pxPage->heartbeat != ullLastHeartbeat )
+	{
+		ullLastHeartbeat = pxPage->heartbeat;
+		prvSampleStack();
+	}
+
+	ulMsg = rcpu_telemetry_get_msg( pxPage );
+	if( ulMsg == RCPU_TELEMETRY_MSG_NONE )
+	{
+		return;
+	}
+
+	/* The hook of the application may block, defer it to a task. */
+	if( xTimerPendFunctionCallFromISR( prvHandleMessage, NULL, ulMsg, &xHigherPriorityTaskWoken ) != pdPASS )
+	{
+		/* Timer queue full, take the message again on the next tick. */
+		pxPage->msg_to_rcpu = ulMsg;
+	}
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+/*-----------------------------------------------------------*/
+
+/* A sleep must not outlast a heartbeat period, nor delay a message further. */
+unsigned long ulJailhouseSleepLimit( unsigned long ulTicks )
+{
+	if( pxPage != NULL && ulHeartbeatTicks != 0 && ulTicks > ulHeartbeatTicks )
+	{
+		return ulHeartbeatTicks;
+	}
+
+	return ulTicks;
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseSleep( void )
+{
+	if( pxPage != NULL )
+	{
+		rcpu_telemetry_trace( pxPage, rcpu_telemetry_now(), RCPU_TELEMETRY_TRACE_SLEEP,
+				RCPU_TELEMETRY_TRACE_NO_TASK );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vJailhouseWake( void )
+{
+	if( pxPage != NULL )
+	{
+		rcpu_telemetry_trace( pxPage, rcpu_telemetry_now(), RCPU_TELEMETRY_TRACE_WAKE,
+				RCPU_TELEMETRY_TRACE_NO_TASK );
+	}
+}
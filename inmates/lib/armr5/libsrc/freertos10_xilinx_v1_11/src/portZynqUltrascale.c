@@ -73,6 +73,17 @@ void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer,
 /* Timer used to generate the tick interrupt. */
 static XTtcPs xTimerInstance;
 XScuGic xInterruptController;
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+	#error Tickless idle needs the tick timer at the tick rate
+#endif
+/* Timer counts per tick, and the longest sleep the interval register allows. */
+static XInterval xTickInterval;
+static TickType_t xMaxSuppressedTicks;
+/* Set while the interval is shortened to realign the tick after a sleep. */
+static volatile BaseType_t xTickRealign = pdFALSE;
+#endif
 #else
 extern uintptr_t IntrControllerAddr;
 #endif
@@ -135,6 +146,10 @@ XScuGic_Config *pxInterruptControllerConfig;
 #endif
 	XTtcPs_SetInterval( &xTimerInstance, usInterval );
 	XTtcPs_SetPrescaler( &xTimerInstance, ucPrescaler );
+#if ( configUSE_TICKLESS_IDLE == 1 )
+	xTickInterval = usInterval;
+	xMaxSuppressedTicks = XTTCPS_MAX_INTERVAL_COUNT / usInterval;
+#endif
 	/* Enable the interrupt for timer. */
 	XScuGic_EnableIntr( configINTERRUPT_CONTROLLER_BASE_ADDRESS, configTIMER_INTERRUPT_ID );
 	XTtcPs_EnableInterrupts( &xTimerInstance, XTTCPS_IXR_INTERVAL_MASK );
@@ -178,10 +193,120 @@ void FreeRTOS_ClearTickInterrupt( void )
 {
 #ifndef XPAR_XILTIMER_ENABLED
 	XTtcPs_ClearInterruptStatus( &xTimerInstance, XTtcPs_GetInterruptStatus( &xTimerInstance ) );
+#if ( configUSE_TICKLESS_IDLE == 1 )
+	/* The tick is aligned again, back to the normal period. */
+	if( xTickRealign != pdFALSE )
+	{
+		XTtcPs_SetInterval( &xTimerInstance, xTickInterval );
+		xTickRealign = pdFALSE;
+	}
+#endif
 #else
 	XTimer_ClearTickInterrupt();
 #endif
+	vJailhouseTickFromISR();
+}
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+#ifndef XPAR_XILTIMER_ENABLED
+/* Whether the tick interrupt is pending in the distributor. */
+static BaseType_t prvTickPending( void )
+{
+	return ( Xil_In32( configINTERRUPT_CONTROLLER_BASE_ADDRESS + XSCUGIC_PENDING_SET_OFFSET +
+					   ( ( configTIMER_INTERRUPT_ID / 32U ) * 4U ) ) &
+			 ( 1UL << ( configTIMER_INTERRUPT_ID % 32U ) ) ) != 0;
 }
+
+/*
+ * Stretches the tick period over the expected idle time and waits for an
+ * interrupt. The time the timer is stopped to be reprogrammed is lost, a few
+ * timer counts per sleep.
+ */
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+uint32_t ulElapsed, ulCount;
+TickType_t xCompleteTicks;
+
+	xExpectedIdleTime = ( TickType_t ) ulJailhouseSleepLimit( xExpectedIdleTime );
+	if( xExpectedIdleTime > xMaxSuppressedTicks )
+	{
+		xExpectedIdleTime = xMaxSuppressedTicks;
+	}
+
+	__asm volatile ( "CPSID i" ::: "memory" );
+	XTtcPs_Stop( &xTimerInstance );
+	ulElapsed = XTtcPs_GetCounterValue( &xTimerInstance );
+
+	/* A task became ready or the tick is due, do not sleep. */
+	if( eTaskConfirmSleepModeStatus() == eAbortSleep || prvTickPending() ||
+		ulElapsed >= xTickInterval )
+	{
+		XTtcPs_Start( &xTimerInstance );
+		__asm volatile ( "CPSIE i" ::: "memory" );
+		return;
+	}
+
+	XTtcPs_SetInterval( &xTimerInstance, ( uint32_t ) xTickInterval * xExpectedIdleTime - ulElapsed );
+	XTtcPs_ResetCounterValue( &xTimerInstance );
+	XTtcPs_Start( &xTimerInstance );
+
+	vJailhouseSleep();
+	configPRE_SLEEP_PROCESSING( xExpectedIdleTime );
+	if( xExpectedIdleTime > 0 )
+	{
+		__asm volatile ( "DSB\n"
+						 "WFI\n"
+						 "ISB" ::: "memory" );
+	}
+	configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+	vJailhouseWake();
+
+	XTtcPs_Stop( &xTimerInstance );
+	ulCount = XTtcPs_GetCounterValue( &xTimerInstance );
+
+	if( prvTickPending() )
+	{
+		/* The sleep ran out, the pending tick interrupt accounts for the
+		last tick. */
+		xCompleteTicks = xExpectedIdleTime - 1;
+		XTtcPs_SetInterval( &xTimerInstance, xTickInterval );
+		xTickRealign = pdFALSE;
+	}
+	else
+	{
+		/* Woken up early by another interrupt, the next tick is due at the
+		next multiple of the tick period. */
+		ulElapsed += ulCount;
+		xCompleteTicks = ulElapsed / xTickInterval;
+		XTtcPs_SetInterval( &xTimerInstance, xTickInterval - ( ulElapsed % xTickInterval ) );
+		xTickRealign = pdTRUE;
+	}
+	XTtcPs_ResetCounterValue( &xTimerInstance );
+	XTtcPs_Start( &xTimerInstance );
+
+	vTaskStepTick( xCompleteTicks );
+	__asm volatile ( "CPSIE i" ::: "memory" );
+}
+#else
+/* The tick timer is owned by xiltimer, only wait for the next interrupt. */
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+	__asm volatile ( "CPSID i" ::: "memory" );
+	if( eTaskConfirmSleepModeStatus() != eAbortSleep )
+	{
+		vJailhouseSleep();
+		configPRE_SLEEP_PROCESSING( xExpectedIdleTime );
+		__asm volatile ( "DSB\n"
+						 "WFI\n"
+						 "ISB" ::: "memory" );
+		configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+		vJailhouseWake();
+	}
+	__asm volatile ( "CPSIE i" ::: "memory" );
+}
+#endif
+#endif /* configUSE_TICKLESS_IDLE */
 /*-----------------------------------------------------------*/
 
 void vApplicationIRQHandler( uint32_t ulICCIAR )
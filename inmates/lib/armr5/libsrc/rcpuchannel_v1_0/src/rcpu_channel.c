@@ -0,0 +1,68 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor rCPU channel, R5 side.
+ *
+ * The channel is laid out by the APU, the R5 attaches to it once the magic is
+ * set. The region must be uncached on the R5 as well (caches disabled or an
+ * MPU region of normal non-cacheable or device memory).
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#include "xil_io.h"
+#include "rcpu_channel.h"
+
+#define IPI_TRIG  0x00U
+#define IPI_ISR   0x10U
+#define IPI_IER   0x18U
+
+/*
+ * Returns 0 once the channel is usable, -1 if the APU has not laid it out yet
+ * or its geometry does not fit the region.
+ */
+int rcpu_channel_attach(rcpu_channel_t *chan, void *base, u32 size,
+                        u32 ipi_base, u32 apu_mask)
+{
+  struct rcpu_channel_header *hdr = base;
+
+  if (!rcpu_channel_ready(hdr) || hdr->size > size ||
+      rcpu_channel_size(hdr->num_slots, hdr->slot_size) != hdr->size)
+    return -1;
+
+  chan->hdr = hdr;
+  chan->ipi_base = ipi_base;
+  chan->apu_mask = apu_mask;
+
+  return 0;
+}
+
+/* Raise the IPI interrupt of the R5 on the doorbell from the APU */
+void rcpu_channel_enable_irq(rcpu_channel_t *chan)
+{
+  Xil_Out32(chan->ipi_base + IPI_IER, RCPU_CHANNEL_IPI_APU_MASK);
+}
+
+/* Returns 1 and clears the doorbell if the APU rang it, 0 otherwise */
+int rcpu_channel_ack(rcpu_channel_t *chan)
+{
+  if (!(Xil_In32(chan->ipi_base + IPI_ISR) & RCPU_CHANNEL_IPI_APU_MASK))
+    return 0;
+
+  Xil_Out32(chan->ipi_base + IPI_ISR, RCPU_CHANNEL_IPI_APU_MASK);
+  return 1;
+}
+
+void rcpu_channel_send(rcpu_channel_t *chan, void *payload, u32 len)
+{
+  rcpu_channel_commit(chan->hdr, RCPU_CHANNEL_FROM_RCPU, payload, len);
+
+  if (chan->apu_mask)
+    Xil_Out32(chan->ipi_base + IPI_TRIG, chan->apu_mask);
+}
@@ -0,0 +1,80 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor rCPU telemetry, R5 side.
+ *
+ * The R5 owns the telemetry page and lays it out at attach time. The page
+ * must be uncached on the R5 (caches disabled or an MPU region of normal
+ * non-cacheable or device memory), the driver reads it at any time.
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#include "xil_io.h"
+#include "rcpu_telemetry.h"
+
+u64 rcpu_telemetry_now(void)
+{
+  u32 hi, lo;
+
+  do {
+    hi = Xil_In32(RCPU_TELEMETRY_COUNTER_HI);
+    lo = Xil_In32(RCPU_TELEMETRY_COUNTER_LO);
+  } while (hi != Xil_In32(RCPU_TELEMETRY_COUNTER_HI));
+
+  return ((u64)hi << 32) | lo;
+}
+
+/* Returns 0 on success, -1 if the region cannot hold the telemetry page */
+int rcpu_telemetry_attach(rcpu_telemetry_t *tel, void *base, u32 size,
+                          u64 heartbeat_period)
+{
+  if (size < sizeof(struct rcpu_telemetry) || ((UINTPTR)base & 7))
+    return -1;
+
+  tel->page = base;
+  tel->boot = rcpu_telemetry_now();
+  tel->next_heartbeat = tel->boot;
+  tel->idle = 0;
+  tel->idle_since = 0;
+  rcpu_telemetry_init(tel->page, heartbeat_period);
+
+  return 0;
+}
+
+void rcpu_telemetry_idle_enter(rcpu_telemetry_t *tel)
+{
+  tel->idle_since = rcpu_telemetry_now();
+}
+
+void rcpu_telemetry_idle_exit(rcpu_telemetry_t *tel)
+{
+  if (tel->idle_since == 0)
+    return;
+
+  tel->idle += rcpu_telemetry_now() - tel->idle_since;
+  tel->idle_since = 0;
+}
+
+/*
+ * Publishes the load and, once per heartbeat period, a heartbeat. Called from
+ * a periodic context, e.g. the tick or a low priority task, never while idle.
+ */
+void rcpu_telemetry_poll(rcpu_telemetry_t *tel)
+{
+  u64 now = rcpu_telemetry_now();
+  u64 total = now - tel->boot;
+
+  if (now < tel->next_heartbeat)
+    return;
+
+  rcpu_telemetry_load(tel->page, total - tel->idle, total);
+  rcpu_telemetry_heartbeat(tel->page, now);
+  tel->next_heartbeat = now + tel->page->heartbeat_period;
+}
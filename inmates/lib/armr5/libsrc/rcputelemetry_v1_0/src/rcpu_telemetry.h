@@ -0,0 +1,47 @@
+/*
+ * Jailhouse, a Linux-based partitioning hypervisor
+ *
+ * Omnivisor rCPU telemetry, R5 side.
+ *
+ * Copyright (c) Daniele Ottaviano, 2024
+ *
+ * Authors:
+ *   Daniele Ottaviano <danieleottaviano97@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.  See
+ * the COPYING file in the top-level directory.
+ */
+
+#ifndef RCPU_TELEMETRY_H
+#define RCPU_TELEMETRY_H
+
+#include "xil_types.h"
+#include "rcpu-telemetry-common.h"
+
+/* Global system counter, shared with the APU */
+#define RCPU_TELEMETRY_COUNTER_LO  0xFF250000U
+#define RCPU_TELEMETRY_COUNTER_HI  0xFF250004U
+
+typedef struct {
+  struct rcpu_telemetry *page;
+  u64 boot;
+  u64 next_heartbeat;
+  /* Time spent idle, and start of the current idle phase (0 if busy) */
+  u64 idle;
+  u64 idle_since;
+} rcpu_telemetry_t;
+
+u64 rcpu_telemetry_now(void);
+int rcpu_telemetry_attach(rcpu_telemetry_t *tel, void *base, u32 size,
+                          u64 heartbeat_period);
+void rcpu_telemetry_idle_enter(rcpu_telemetry_t *tel);
+void rcpu_telemetry_idle_exit(rcpu_telemetry_t *tel);
+void rcpu_telemetry_poll(rcpu_telemetry_t *tel);
+
+/* Registers a task, returns its index or -1 if the page is full */
+static inline int rcpu_telemetry_task(rcpu_telemetry_t *tel, const char *name)
+{
+  return rcpu_telemetry_add_task(tel->page, name);
+}
+
+#endif /* RCPU_TELEMETRY_H */
@@ -19,7 +19,7 @@ import struct
 from .extendedenum import ExtendedEnum
 
 # Keep the whole file in sync with include/jailhouse/cell-config.h.
-_CONFIG_REVISION = 14
+_CONFIG_REVISION = 16
 JAILHOUSE_X86 = 0
 JAILHOUSE_ARM = 1
 JAILHOUSE_ARM64 = 2
@@ -57,6 +57,8 @@ class JAILHOUSE_MEM(ExtendedEnum, int):
         'LOADABLE':     0x00040,
         'ROOTSHARED':   0x00080,
         'NO_HUGEPAGES': 0x00100,
+        'RCPU_CHANNEL': 0x01000,
+        'RCPU_TELEMETRY': 0x02000,
         'IO_UNALIGNED': 0x08000,
         'IO_8':         0x10000,
         'IO_16':        0x20000,
@@ -26,6 +26,7 @@
 #include <libgen.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 //DELETE
 #include <sys/time.h>
@@ -59,6 +60,8 @@ static const struct extension extensions[] = {
 	  "              [-a ARCH] [-k FACTOR]\n"
 	  "              CELLCONFIG KERNEL" },
 	{ "cell", "stats", "{ ID | [--name] NAME }" },
+	{ "cell", "bench", "[-n N] [-c] [-o CSV] [--raw CSV] CELLCONFIG\n"
+	  "              -r RCPU_IMAGE_NAME RCPU [-r ...]" },
 	{ "config", "create", "[-h] [-g] [-r ROOT] [-t TEMPLATE_DIR]"
 	  " [-c CONSOLE]\n"
 	  "                 [--mem-inmates MEM_INMATES] [--mem-hv MEM_HV]\n"
@@ -78,13 +81,22 @@ static void __attribute__((noreturn)) help(char *prog, int exit_status)
 	       "   enable SYSCONFIG\n"
 	       "   disable\n"
 	       "   console [-f | --follow]\n"
+	       "   trace [-o | --output FILE]\n"
 	       "   memguard { CPU ID } period_us budget_mem event_type\n"
+	       "   firmware cache RCPU_IMAGE_NAME ...\n"
+	       "   firmware invalidate [RCPU_IMAGE_NAME]\n"
+	       "   fpga cache { BITSTREAM | OVERLAY } ...\n"
+	       "   fpga evict [BITSTREAM | OVERLAY]\n"
 	       "   cell create CELLCONFIG\n"
 	       "   cell list\n"
 	       "   cell load { ID | [--name] NAME } { IMAGE | { -s | --string } \"STRING\" }\n"
 		   "             [-a | --address ADDRESS] ...\n" 
 		   "             [-r | --rcpu RCPU_IMAGE_NAME RCPU_MASK] ...\n"
 	       "   cell start { ID | [--name] NAME }\n"
+	       "   cell stage { ID | [--name] NAME } "
+	       "{ -r | --rcpu RCPU_IMAGE_NAME RCPU_ID } ...\n"
+	       "   cell restart { ID | [--name] NAME } [-d | --reload-data] "
+	       "[-s | --switch]\n"
 	       "   cell shutdown { ID | [--name] NAME }\n"
 	       "   cell destroy { ID | [--name] NAME }\n",
 	       basename(prog));
@@ -567,6 +579,81 @@ static int cell_simple_cmd(int argc, char *argv[], unsigned int command)
 	return err;
 }
 
+static int cell_restart(int argc, char *argv[])
+{
+	struct jailhouse_cell_restart restart;
+	int id_args, err, fd;
+
+	memset(&restart, 0, sizeof(restart));
+
+	id_args = parse_cell_id(&restart.cell_id, argc - 3, &argv[3]);
+	if (id_args == 0)
+		help(argv[0], 1);
+
+	for (; 3 + id_args < argc; id_args++) {
+		if (match_opt(argv[3 + id_args], "-d", "--reload-data"))
+			restart.flags |= JAILHOUSE_CELL_RESTART_RELOAD_DATA;
+		else if (match_opt(argv[3 + id_args], "-s", "--switch"))
+			restart.flags |= JAILHOUSE_CELL_RESTART_SWITCH_IMAGE;
+		else
+			break;
+	}
+	if (3 + id_args != argc)
+		help(argv[0], 1);
+
+	fd = open_dev();
+
+	err = ioctl(fd, JAILHOUSE_CELL_RESTART, &restart);
+	if (err)
+		perror("JAILHOUSE_CELL_RESTART");
+
+	close(fd);
+
+	return err;
+}
+
+static int cell_stage(int argc, char *argv[])
+{
+	struct jailhouse_preload_rcpu_image *rcpu_image;
+	struct jailhouse_cell_stage stage;
+	int id_args, arg_num, err, fd;
+	unsigned int n;
+
+	memset(&stage, 0, sizeof(stage));
+
+	id_args = parse_cell_id(&stage.cell_id, argc - 3, &argv[3]);
+	arg_num = 3 + id_args;
+	if (id_args == 0 || arg_num == argc || (argc - arg_num) % 3 != 0)
+		help(argv[0], 1);
+
+	stage.num_rcpu_images = (argc - arg_num) / 3;
+	stage.rcpu_image = calloc(stage.num_rcpu_images, sizeof(*rcpu_image));
+	if (!stage.rcpu_image) {
+		fprintf(stderr, "insufficient memory\n");
+		exit(1);
+	}
+
+	for (n = 0, rcpu_image = stage.rcpu_image; n < stage.num_rcpu_images;
+	     n++, rcpu_image++) {
+		if (!match_opt(argv[arg_num++], "-r", "--rcpu"))
+			help(argv[0], 1);
+		strncpy(rcpu_image->name, argv[arg_num++],
+			JAILHOUSE_RCPU_IMAGE_NAMELEN);
+		rcpu_image->rcpu_id = atoi(argv[arg_num++]);
+	}
+
+	fd = open_dev();
+
+	err = ioctl(fd, JAILHOUSE_CELL_STAGE, &stage);
+	if (err)
+		perror("JAILHOUSE_CELL_STAGE");
+
+	close(fd);
+	free(stage.rcpu_image);
+
+	return err;
+}
+
 static int qos_cmd(int argc, char *argv[], unsigned int command)
 {
 	/* The format of a command to set qos parameters is the
@@ -707,6 +794,10 @@ static int cell_management(int argc, char *argv[])
 		err = cell_shutdown_load(argc, argv, LOAD);
 	} else if (strcmp(argv[2], "start") == 0) {
 		err = cell_simple_cmd(argc, argv, JAILHOUSE_CELL_START);
+	} else if (strcmp(argv[2], "stage") == 0) {
+		err = cell_stage(argc, argv);
+	} else if (strcmp(argv[2], "restart") == 0) {
+		err = cell_restart(argc, argv);
 	} else if (strcmp(argv[2], "shutdown") == 0) {
 		err = cell_shutdown_load(argc, argv, SHUTDOWN);
 	} else if (strcmp(argv[2], "destroy") == 0) {
@@ -751,6 +842,73 @@ static int memguard_cmd(int argc, char *argv[], unsigned int command)
 	return err;
 }
 
+static int firmware_cmd(int argc, char *argv[])
+{
+	struct jailhouse_rcpu_fw_cache req;
+	int err = 0, fd, arg_num;
+
+	if (argc < 3)
+		help(argv[0], 1);
+
+	memset(&req, 0, sizeof(req));
+	if (strcmp(argv[2], "cache") == 0 && argc > 3)
+		req.cmd = JAILHOUSE_RCPU_FW_CACHE_PREWARM;
+	else if (strcmp(argv[2], "invalidate") == 0 && argc <= 4)
+		req.cmd = JAILHOUSE_RCPU_FW_CACHE_INVALIDATE;
+	else
+		help(argv[0], 1);
+
+	fd = open_dev();
+
+	/* invalidate without a name drops the whole cache */
+	if (argc == 3)
+		err = ioctl(fd, JAILHOUSE_RCPU_FW_CACHE, &req);
+
+	for (arg_num = 3; arg_num < argc && !err; arg_num++) {
+		strncpy(req.name, argv[arg_num], JAILHOUSE_RCPU_IMAGE_NAMELEN);
+		err = ioctl(fd, JAILHOUSE_RCPU_FW_CACHE, &req);
+	}
+	if (err)
+		perror("JAILHOUSE_RCPU_FW_CACHE");
+
+	close(fd);
+
+	return err;
+}
+
+static int fpga_cmd(int argc, char *argv[])
+{
+	struct jailhouse_fpga_cache req;
+	int err = 0, fd, arg_num;
+
+	if (argc < 3)
+		help(argv[0], 1);
+
+	memset(&req, 0, sizeof(req));
+	if (strcmp(argv[2], "cache") == 0 && argc > 3)
+		req.cmd = JAILHOUSE_FPGA_CACHE_PRELOAD;
+	else if (strcmp(argv[2], "evict") == 0 && argc <= 4)
+		req.cmd = JAILHOUSE_FPGA_CACHE_EVICT;
+	else
+		help(argv[0], 1);
+
+	fd = open_dev();
+
+	/* evict without a name drops the whole cache */
+	if (argc == 3)
+		err = ioctl(fd, JAILHOUSE_FPGA_CACHE, &req);
+
+	for (arg_num = 3; arg_num < argc && !err; arg_num++) {
+		strncpy(req.name, argv[arg_num], FPGA_BITSTREAM_NAMELEN);
+		err = ioctl(fd, JAILHOUSE_FPGA_CACHE, &req);
+	}
+	if (err)
+		perror("JAILHOUSE_FPGA_CACHE");
+
+	close(fd);
+
+	return err;
+}
 
 static int console(int argc, char *argv[])
 {
@@ -791,6 +949,138 @@ out:
 	return ret;
 }
 
+static const char *trace_event_names[] = {
+	[JAILHOUSE_TRACE_TRAP] = "trap",
+	[JAILHOUSE_TRACE_IRQ] = "irq",
+	[JAILHOUSE_TRACE_MMIO] = "mmio",
+	[JAILHOUSE_TRACE_HYPERCALL] = "hypercall",
+	[JAILHOUSE_TRACE_MEMGUARD_TIMER] = "memguard_timer",
+	[JAILHOUSE_TRACE_MEMGUARD_PMU] = "memguard_pmu",
+	[JAILHOUSE_TRACE_MEMGUARD_BLOCK] = "memguard_block",
+	[JAILHOUSE_TRACE_CELL_SUSPEND] = "cell_suspend",
+	[JAILHOUSE_TRACE_CELL_RESUME] = "cell_resume",
+};
+
+static const char *trace_phases[] = {
+	[JAILHOUSE_TRACE_INSTANT] = "\"ph\": \"i\", \"s\": \"t\"",
+	[JAILHOUSE_TRACE_BEGIN] = "\"ph\": \"B\"",
+	[JAILHOUSE_TRACE_END] = "\"ph\": \"E\"",
+};
+
+/*
+ * Copies the valid entries of a trace ring, returns the index of the oldest
+ * one. Entries the hypervisor may have overwritten while copying are dropped.
+ */
+static unsigned int trace_snapshot(const struct jailhouse_trace_ring *ring,
+				   struct jailhouse_trace_entry *entries,
+				   unsigned int *head)
+{
+	unsigned int valid;
+	int overrun;
+
+	*head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	memcpy(entries, ring->entries, sizeof(ring->entries));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	overrun = __atomic_load_n(&ring->head, __ATOMIC_RELAXED) - *head;
+
+	if (overrun >= JAILHOUSE_TRACE_ENTRIES - 1)
+		return *head;
+	valid = JAILHOUSE_TRACE_ENTRIES - 1 - overrun;
+	if (valid > *head)
+		valid = *head;
+
+	return *head - valid;
+}
+
+/* Dumps the trace rings of all CPUs in the Chrome trace event format */
+static int trace(int argc, char *argv[])
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t ring_size = (sizeof(struct jailhouse_trace_ring) + page_size - 1) &
+		~(page_size - 1);
+	const struct jailhouse_trace_entry *entry;
+	struct jailhouse_trace_entry *entries;
+	struct jailhouse_trace_ring *ring;
+	unsigned int cpu, first, head;
+	const char *sep = "";
+	FILE *out = stdout;
+	const char *name;
+	off_t offset;
+	int fd, err = 0;
+
+	if (argc == 4 && match_opt(argv[2], "-o", "--output")) {
+		out = fopen(argv[3], "w");
+		if (!out) {
+			fprintf(stderr, "opening %s: %s\n", argv[3],
+				strerror(errno));
+			return 1;
+		}
+	} else if (argc != 2) {
+		help(argv[0], 1);
+	}
+
+	entries = malloc(sizeof(ring->entries));
+	if (!entries) {
+		fprintf(stderr, "insufficient memory\n");
+		exit(1);
+	}
+
+	fd = open_dev();
+
+	fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+	for (cpu = 0; ; cpu++) {
+		offset = (JAILHOUSE_MMAP_TRACE * page_size) + cpu * ring_size;
+		ring = mmap(NULL, ring_size, PROT_READ, MAP_SHARED, fd, offset);
+		if (ring == MAP_FAILED) {
+			/* Past the last CPU, or no trace support at all */
+			if (cpu == 0) {
+				perror("mmap(trace)");
+				err = 1;
+			}
+			break;
+		}
+
+		/* Not brought up */
+		if (ring->version != JAILHOUSE_TRACE_VERSION) {
+			munmap(ring, ring_size);
+			continue;
+		}
+
+		fprintf(out, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", "
+			"\"pid\": 0, \"tid\": %u, "
+			"\"args\": {\"name\": \"CPU %u\"}}", sep, cpu, cpu);
+		sep = ",";
+
+		for (first = trace_snapshot(ring, entries, &head);
+		     first != head; first++) {
+			entry = &entries[first & (JAILHOUSE_TRACE_ENTRIES - 1)];
+			if (entry->phase > JAILHOUSE_TRACE_END)
+				continue;
+			name = entry->event < sizeof(trace_event_names) /
+				sizeof(trace_event_names[0]) ?
+				trace_event_names[entry->event] : NULL;
+
+			fprintf(out, ",\n{\"name\": \"%s\", %s, \"ts\": %.3f, "
+				"\"pid\": 0, \"tid\": %u, "
+				"\"args\": {\"arg\": %u}}",
+				name ? name : "unknown",
+				trace_phases[entry->phase],
+				entry->stamp * 1e6 / ring->ticks_hz, cpu,
+				entry->arg);
+		}
+
+		munmap(ring, ring_size);
+	}
+	fprintf(out, "\n]}\n");
+
+	close(fd);
+	free(entries);
+	if (out != stdout)
+		fclose(out);
+
+	return err;
+}
+
 int main(int argc, char *argv[])
 {
 	int fd;
@@ -809,10 +1099,16 @@ int main(int argc, char *argv[])
 		close(fd);
 	} else if (strcmp(argv[1], "memguard") == 0) {
 	    err = memguard_cmd(argc, argv, JAILHOUSE_MEMGUARD);
+	} else if (strcmp(argv[1], "firmware") == 0) {
+		err = firmware_cmd(argc, argv);
+	} else if (strcmp(argv[1], "fpga") == 0) {
+		err = fpga_cmd(argc, argv);
 	} else if (strcmp(argv[1], "cell") == 0) {
 		err = cell_management(argc, argv);
 	} else if (strcmp(argv[1], "console") == 0) {
 		err = console(argc, argv);
+	} else if (strcmp(argv[1], "trace") == 0) {
+		err = trace(argc, argv);
 	} else if (strcmp(argv[1], "config") == 0 ||
 		   strcmp(argv[1], "hardware") == 0) {
 		call_extension_script(argv[1], argc, argv);